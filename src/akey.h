@@ -38,6 +38,7 @@
 #ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
 #define AKEY_KEYB                  -32
 #endif
+#define AKEY_REWIND                -33
 #ifdef DIRECTX
 	/* special menu directives */
 	#define AKEY32_MENU_SAVE_CONFIG     -107
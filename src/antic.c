@@ -23,6 +23,7 @@
 */
 
 #include "config.h"
+#include <stddef.h>
 #include <string.h>
 #if HAVE_STDINT_H
 # include <stdint.h>
@@ -30,6 +31,7 @@
 
 #include "antic.h"
 #include "atari.h"
+#include "colours.h"
 #include "cpu.h"
 #include "gtia.h"
 #include "log.h"
@@ -47,6 +49,9 @@
 #ifdef NEW_CYCLE_EXACT
 #include "cycle_map.h"
 #endif
+#ifdef ANTIC_RENDER_THREAD
+#include <pthread.h>
+#endif
 
 #define LCHOP 3			/* do not build leftmost 0..3 characters in wide mode */
 #define RCHOP 3			/* do not build rightmost 0..3 characters in wide mode */
@@ -60,8 +65,8 @@ static void draw_partial_scanline(int l,int r);
 static void update_scanline_chbase(void);
 static void update_scanline_invert(void);
 static void update_scanline_blank(void);
-const int *ANTIC_cpu2antic_ptr;
-const int *ANTIC_antic2cpu_ptr;
+const SBYTE *ANTIC_cpu2antic_ptr;
+const SBYTE *ANTIC_antic2cpu_ptr;
 int ANTIC_delayed_wsync = 0;
 static int dmactl_changed = 0;
 static UBYTE delayed_DMACTL;
@@ -184,11 +189,22 @@ static UBYTE *scratchFillLimit;
 void ANTIC_VideoMemset(UBYTE *ptr, UBYTE val, ULONG size)
 {
 	FILL_VIDEO(ptr, val, size);
+#ifdef ANTIC_LINE_CACHE
+	if (size > 0)
+		ANTIC_RedrawLines((int) ((ptr - (UBYTE *) Screen_atari) / Screen_WIDTH),
+		                  (int) ((ptr + size - 1 - (UBYTE *) Screen_atari) / Screen_WIDTH));
+#endif
 }
 
 void ANTIC_VideoPutByte(UBYTE *ptr, UBYTE val)
 {
 	WRITE_VIDEO_BYTE(ptr, val);
+#ifdef ANTIC_LINE_CACHE
+	{
+		int y = (int) ((ptr - (UBYTE *) Screen_atari) / Screen_WIDTH);
+		ANTIC_RedrawLines(y, y);
+	}
+#endif
 }
 
 
@@ -647,6 +663,45 @@ UWORD ANTIC_cl[128];
 
 #endif /* WORDS_UNALIGNED_OK */
 
+/* Four pixels at once
+   Character modes 2, 4 and 5 draw the four 2-bit pixels of a font byte
+   with two longs, each looked up by four bits of the byte in a table of
+   pixel pairs set up at the beginning of the scanline. On platforms that
+   don't allow unaligned long access they draw four words, as before.
+   pixel(x) is the word for a 2-bit pixel x. */
+
+#ifdef WORDS_UNALIGNED_OK
+
+#ifdef WORDS_BIGENDIAN
+#define PIXEL_PAIR(left, right)	(((ULONG) (left) << 16) | (right))
+#else
+#define PIXEL_PAIR(left, right)	((left) | ((ULONG) (right) << 16))
+#endif
+#define DECLARE_PIXEL_PAIRS(pairs)	ULONG pairs[16];
+#define INIT_PIXEL_PAIRS(pairs, pixel) { \
+		int pair; \
+		for (pair = 0; pair < 16; pair++) \
+			(pairs)[pair] = PIXEL_PAIR(pixel(pair >> 2), pixel(pair & 3)); \
+	}
+#define DRAW_PIXEL_PAIRS(data, pairs, pixel) { \
+		WRITE_VIDEO_LONG_UNALIGNED((ULONG *) ptr, (pairs)[(data) >> 4]); \
+		WRITE_VIDEO_LONG_UNALIGNED(((ULONG *) ptr) + 1, (pairs)[(data) & 0xf]); \
+		ptr += 4; \
+	}
+
+#else
+
+#define DECLARE_PIXEL_PAIRS(pairs)
+#define INIT_PIXEL_PAIRS(pairs, pixel)
+#define DRAW_PIXEL_PAIRS(data, pairs, pixel) { \
+		WRITE_VIDEO(ptr++, pixel((data) >> 6)); \
+		WRITE_VIDEO(ptr++, pixel(((data) >> 4) & 3)); \
+		WRITE_VIDEO(ptr++, pixel(((data) >> 2) & 3)); \
+		WRITE_VIDEO(ptr++, pixel((data) & 3)); \
+	}
+
+#endif /* WORDS_UNALIGNED_OK */
+
 #define DRAW_ARTIF_NEW {\
 		WRITE_VIDEO(ptr++, art_lookup_new[(screendata_tally & 0x03f000) >> 12]); \
 		WRITE_VIDEO(ptr++, art_lookup_new[(screendata_tally & 0x00fc00) >> 10]); \
@@ -679,6 +734,8 @@ static UWORD hires_lookup_n[128];
 static UWORD hires_lookup_m[128];
 #define hires_norm(x)	hires_lookup_n[(x) >> 1]
 #define hires_mask(x)	hires_lookup_m[(x) >> 1]
+/* 2-bit hi-res pixel x for DRAW_PIXEL_PAIRS */
+#define hires_pixel(x)	hires_norm((x) << 2)
 
 #ifndef USE_COLOUR_TRANSLATION_TABLE
 int ANTIC_artif_new = FALSE; /* New type of artifacting */
@@ -877,6 +934,81 @@ static void pmg_dma(void)
 	}
 }
 
+#ifdef ANTIC_RENDER_THREAD
+
+/* Drawing state ------------------------------------------------------------
+
+   With the render thread, the scanlines are drawn from copies of the
+   registers and of the current scanline, because the emulation changes the
+   originals while a scanline is being drawn. Only one thread draws at
+   a time, so the scratch tables used by the drawing code are not copied.
+   From here to ANTIC_UpdateArtifacting, the code refers to the copies. */
+
+/* colour lookup tables and the GTIA registers they are made of */
+struct draw_colours {
+	UWORD cl[128];
+	ULONG lookup_gtia9[16];
+	ULONG lookup_gtia11[16];
+	UWORD hires_lookup_l[128];
+	const UBYTE *pm_lookup_ptr;
+	UBYTE colpf3;
+	UBYTE colbk;
+};
+
+/* a scanline to draw */
+struct render_line {
+	/* NULL for blank lines */
+	void (*draw_antic)(int nchars, const UBYTE *antic_memptr, UWORD *ptr, const ULONG *t_pm_scanline_ptr);
+	void (*draw_antic_0)(void);
+	const struct draw_colours *colours;	/* NULL if they haven't changed */
+	UWORD *scrn_ptr;
+	/* the following are only set for mode lines */
+	int nchars;
+	int x_min;
+	int ch_offset;
+	int left_border_chars;
+	int right_border_start;
+	int blank_mask;
+	UWORD chbase_20;
+	UBYTE anticmode;
+	UBYTE dctr;
+	UBYTE invert_mask;
+	/* only set for the bytes read by draw_antic on the render thread */
+	UBYTE memory[sizeof(antic_memory)];
+	UBYTE font[sizeof(antic_memory)];	/* modes 2-7: font byte of every character */
+};
+
+static struct draw_colours draw_colours;
+static const struct render_line *draw_line;
+static const UBYTE *draw_pm_scanline;
+static int draw_pm_dirty;
+static const UBYTE *draw_mem;
+static const UBYTE *draw_xe_ptr;
+
+static void render_sync(void);
+
+#define ANTIC_cl draw_colours.cl
+#define ANTIC_lookup_gtia9 draw_colours.lookup_gtia9
+#define ANTIC_lookup_gtia11 draw_colours.lookup_gtia11
+#define ANTIC_hires_lookup_l draw_colours.hires_lookup_l
+#define pm_lookup_ptr draw_colours.pm_lookup_ptr
+#define GTIA_COLPF3 draw_colours.colpf3
+#define GTIA_COLBK draw_colours.colbk
+#define scrn_ptr draw_line->scrn_ptr
+#define left_border_chars draw_line->left_border_chars
+#define right_border_start draw_line->right_border_start
+#define blank_mask draw_line->blank_mask
+#define chbase_20 draw_line->chbase_20
+#define anticmode draw_line->anticmode
+#define dctr draw_line->dctr
+#define invert_mask draw_line->invert_mask
+#define GTIA_pm_scanline draw_pm_scanline
+#define GTIA_pm_dirty draw_pm_dirty
+#define MEMORY_mem draw_mem
+#define ANTIC_xe_ptr draw_xe_ptr
+
+#endif /* ANTIC_RENDER_THREAD */
+
 /* Artifacting ------------------------------------------------------------ */
 
 int ANTIC_artif_mode;
@@ -965,9 +1097,29 @@ int ANTIC_Initialise(int *argc, char *argv[])
 			}
 			else a_m = TRUE;
 		}
+#ifdef ANTIC_LINE_CACHE
+		else if (strcmp(argv[i], "-linecache") == 0)
+			ANTIC_line_cache = TRUE;
+		else if (strcmp(argv[i], "-nolinecache") == 0)
+			ANTIC_line_cache = FALSE;
+#endif
+#ifdef ANTIC_RENDER_THREAD
+		else if (strcmp(argv[i], "-renderthread") == 0)
+			ANTIC_render_thread = TRUE;
+		else if (strcmp(argv[i], "-norenderthread") == 0)
+			ANTIC_render_thread = FALSE;
+#endif
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
 				Log_print("\t-artif <num>     Set artifacting mode 0-4 (0 = disable)");
+#ifdef ANTIC_LINE_CACHE
+				Log_print("\t-linecache       Don't redraw scanlines that haven't changed");
+				Log_print("\t-nolinecache     Redraw all scanlines in every frame (default)");
+#endif
+#ifdef ANTIC_RENDER_THREAD
+				Log_print("\t-renderthread    Draw the screen on a second thread");
+				Log_print("\t-norenderthread  Draw the screen on the emulation thread (default)");
+#endif
 			}
 			argv[j++] = argv[i];
 		}
@@ -1442,7 +1594,8 @@ static void draw_an_gtia_bug(const ULONG *t_pm_scanline_ptr)
 
 #endif /* USE_COLOUR_TRANSLATION_TABLE */
 
-#ifdef NEW_CYCLE_EXACT
+#if defined(NEW_CYCLE_EXACT) || defined(ANTIC_RENDER_THREAD)
+/* with the render thread, render_line adds them */
 #define ADD_FONT_CYCLES
 #else
 #define ADD_FONT_CYCLES ANTIC_xpos += font_cycles[md]
@@ -1479,8 +1632,10 @@ static void draw_an_gtia_bug(const ULONG *t_pm_scanline_ptr)
 static void draw_antic_2(int nchars, const UBYTE *antic_memptr, UWORD *ptr, const ULONG *t_pm_scanline_ptr)
 {
 	INIT_BACKGROUND_6
+	DECLARE_PIXEL_PAIRS(pairs)
 	INIT_ANTIC_2
 	INIT_HIRES
+	INIT_PIXEL_PAIRS(pairs, hires_pixel)
 
 	CHAR_LOOP_BEGIN
 		UBYTE screendata = *antic_memptr++;
@@ -1488,12 +1643,8 @@ static void draw_antic_2(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 
 		GET_CHDATA_ANTIC_2
 		if (IS_ZERO_ULONG(t_pm_scanline_ptr)) {
-			if (chdata) {
-				WRITE_VIDEO(ptr++, hires_norm(chdata & 0xc0));
-				WRITE_VIDEO(ptr++, hires_norm(chdata & 0x30));
-				WRITE_VIDEO(ptr++, hires_norm(chdata & 0x0c));
-				WRITE_VIDEO(ptr++, hires_norm((chdata & 0x03) << 2));
-			}
+			if (chdata)
+				DRAW_PIXEL_PAIRS(chdata, pairs, hires_pixel)
 			else
 				DRAW_BACKGROUND(C_PF2)
 		}
@@ -1799,9 +1950,14 @@ static void draw_antic_2_gtia_bug(int nchars, const UBYTE *antic_memptr, UWORD *
 	return;
 }
 
+#define mode_4_pixel(x)	lookup2[(x) << 6]
+#define mode_4_inverse_pixel(x)	lookup2[((x) << 6) + 0xf]
+
 static void draw_antic_4(int nchars, const UBYTE *antic_memptr, UWORD *ptr, const ULONG *t_pm_scanline_ptr)
 {
 	INIT_BACKGROUND_8
+	DECLARE_PIXEL_PAIRS(pairs)
+	DECLARE_PIXEL_PAIRS(pairs_inverse)
 #ifdef PAGED_MEM
 	UWORD t_chbase = ((anticmode == 4 ? dctr : dctr >> 1) ^ chbase_20) & 0xfc07;
 #else
@@ -1820,15 +1976,12 @@ static void draw_antic_4(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 	lookup2[0x80] = lookup2[0x20] = lookup2[0x08] = lookup2[0x02] = ANTIC_cl[C_PF1];
 	lookup2[0xc0] = lookup2[0x30] = lookup2[0x0c] = lookup2[0x03] = ANTIC_cl[C_PF2];
 	lookup2[0xcf] = lookup2[0x3f] = lookup2[0x1b] = lookup2[0x12] = ANTIC_cl[C_PF3];
+	INIT_PIXEL_PAIRS(pairs, mode_4_pixel)
+	INIT_PIXEL_PAIRS(pairs_inverse, mode_4_inverse_pixel)
 
 	CHAR_LOOP_BEGIN
 		UBYTE screendata = *antic_memptr++;
-		const UWORD *lookup;
 		UBYTE chdata;
-		if (screendata & 0x80)
-			lookup = lookup2 + 0xf;
-		else
-			lookup = lookup2;
 #ifdef PAGED_MEM
 		chdata = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
 #else
@@ -1836,10 +1989,10 @@ static void draw_antic_4(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 #endif
 		if (IS_ZERO_ULONG(t_pm_scanline_ptr)) {
 			if (chdata) {
-				WRITE_VIDEO(ptr++, lookup[chdata & 0xc0]);
-				WRITE_VIDEO(ptr++, lookup[chdata & 0x30]);
-				WRITE_VIDEO(ptr++, lookup[chdata & 0x0c]);
-				WRITE_VIDEO(ptr++, lookup[chdata & 0x03]);
+				if (screendata & 0x80)
+					DRAW_PIXEL_PAIRS(chdata, pairs_inverse, mode_4_inverse_pixel)
+				else
+					DRAW_PIXEL_PAIRS(chdata, pairs, mode_4_pixel)
 			}
 			else
 				DRAW_BACKGROUND(C_BAK)
@@ -2639,6 +2792,28 @@ static void draw_antic_0_dmactl_bug(int nchars, const UBYTE *antic_memptr, UWORD
 }
 #endif
 
+#ifdef ANTIC_RENDER_THREAD
+#undef ANTIC_cl
+#undef ANTIC_lookup_gtia9
+#undef ANTIC_lookup_gtia11
+#undef ANTIC_hires_lookup_l
+#undef pm_lookup_ptr
+#undef GTIA_COLPF3
+#undef GTIA_COLBK
+#undef scrn_ptr
+#undef left_border_chars
+#undef right_border_start
+#undef blank_mask
+#undef chbase_20
+#undef anticmode
+#undef dctr
+#undef invert_mask
+#undef GTIA_pm_scanline
+#undef GTIA_pm_dirty
+#undef MEMORY_mem
+#undef ANTIC_xe_ptr
+#endif /* ANTIC_RENDER_THREAD */
+
 /* Artifacting ------------------------------------------------------------ */
 
 void ANTIC_UpdateArtifacting(void)
@@ -2665,6 +2840,10 @@ void ANTIC_UpdateArtifacting(void)
 	UBYTE q;
 	UBYTE art_white;
 
+#ifdef ANTIC_RENDER_THREAD
+	/* the tables are in use until the render thread is idle */
+	render_sync();
+#endif
 	if (ANTIC_artif_mode == 0) {
 		draw_antic_table[0][2] = draw_antic_table[0][3] = draw_antic_2;
 		draw_antic_table[0][0xf] = draw_antic_f;
@@ -2838,6 +3017,665 @@ static void antic_load(void)
 #endif
 }
 
+#if !defined(BASIC) && !defined(CURSES_BASIC) && !defined(NEW_CYCLE_EXACT) && !defined(PAGED_MEM)
+
+/* ANTIC_COLLISIONS_ONLY frames are not drawn. The scanline cache and the
+   render thread are only built where these are. */
+#define COLLISION_FRAMES
+
+/* Scanline data ------------------------------------------------------------ */
+
+/* The font fetch cycles that draw_antic_ptr adds to ANTIC_xpos. */
+#define LINE_FONT_CYCLES (anticmode < 8 && draw_antic_ptr != draw_antic_2_gtia_bug ? font_cycles[md] : 0)
+
+/* Returns the font data that a scanline of mode 2-7 is drawn from, indexed
+   by (character & *chmask) << 3. These are the same addresses as in
+   draw_antic_2, draw_antic_4 and draw_antic_6. */
+static const UBYTE *line_font(const UBYTE *mem, const UBYTE *xe_ptr, int mode, int line, UWORD chbase, int *chmask)
+{
+	if (mode <= 5) {
+		UWORD chline = mode == 5 ? line >> 1 : line;
+		*chmask = 0x7f;
+		if (xe_ptr != NULL && chbase < 0x8000 && chbase >= 0x4000)
+			return xe_ptr + ((chline ^ chbase) & 0x3c07);
+		return mem + ((chline ^ chbase) & 0xfc07);
+	}
+	else {
+		UWORD chline = mode == 6 ? line & 7 : line >> 1;
+		*chmask = 0x3f;
+		if (xe_ptr != NULL && chbase < 0x8000 && chbase >= 0x4000)
+			return xe_ptr + ((chline ^ chbase) - 0x4000);
+		return mem + (chline ^ chbase);
+	}
+}
+
+#endif /* COLLISION_FRAMES */
+
+#ifdef ANTIC_LINE_CACHE
+
+/* Scanline cache ----------------------------------------------------------- */
+
+int ANTIC_line_cache = FALSE;
+
+/* Everything a scanline without PM graphics is drawn from. */
+struct line_signature {
+	draw_antic_function draw_antic;	/* NULL for blank lines */
+	void (*draw_antic_0)(void);
+	UBYTE colours[10];			/* COLPM0-3, COLPF0-3, COLBK, PRIOR */
+	/* the following are only set for mode lines */
+	int nchars;
+	int x_min;
+	int ch_offset;
+	int left_border_chars;
+	int right_border_start;
+	int blank_mask;
+	int artif_mode;
+	int artif_new;
+	UWORD chbase_20;
+	UBYTE anticmode;
+	UBYTE dctr;
+	UBYTE invert_mask;
+	/* the following are only set for the bytes read by draw_antic */
+	UBYTE memory[sizeof(antic_memory)];
+	UBYTE font[sizeof(antic_memory)];	/* modes 2-7: font byte of every character */
+};
+
+static struct line_signature line_cache[Screen_HEIGHT];
+static UBYTE line_cache_valid[Screen_HEIGHT];
+/* Screen_atari of the cached scanlines */
+static const ULONG *line_cache_screen = NULL;
+
+void ANTIC_RedrawLines(int first, int last)
+{
+	if (first < 0)
+		first = 0;
+	if (last >= Screen_HEIGHT)
+		last = Screen_HEIGHT - 1;
+	if (first <= last)
+		memset(line_cache_valid + first, FALSE, last - first + 1);
+}
+
+/* Returns the number of bytes of antic_memory read by a draw_antic
+   routine and sets *first to the first of them. */
+static int line_memory(int offset, int nchars, int *first)
+{
+	/* artifacting reads one character more */
+	int count = nchars + 1;
+	*first = ANTIC_margin + offset;
+	if (count > (int) sizeof(antic_memory) - *first)
+		count = (int) sizeof(antic_memory) - *first;
+	return count;
+}
+
+/* Returns TRUE if the current scanline is the same as in the previous frame,
+   so Screen_atari already contains it. Otherwise remembers the scanline
+   and returns FALSE. */
+static int line_unchanged(int mode_line)
+{
+	static struct line_signature sig; /* only the part before memory is used */
+	int y = ANTIC_ypos - 8;
+	struct line_signature *entry = &line_cache[y];
+	size_t size = mode_line ? offsetof(struct line_signature, memory) : offsetof(struct line_signature, nchars);
+	int unchanged;
+
+	/* Collisions are detected while drawing; PAL blending changes the screen
+	   after drawing; the YPOS BREAK FLICKER line gets overwritten */
+	if (GTIA_pm_dirty
+#ifndef NO_SIMPLE_PAL_BLENDING
+		|| ANTIC_pal_blending
+#endif
+		|| ANTIC_ypos + 1 == ANTIC_break_ypos - 1000) {
+		line_cache_valid[y] = FALSE;
+		return FALSE;
+	}
+
+	sig.draw_antic = mode_line ? draw_antic_ptr : NULL;
+	sig.draw_antic_0 = draw_antic_0_ptr;
+	sig.colours[0] = GTIA_COLPM0;
+	sig.colours[1] = GTIA_COLPM1;
+	sig.colours[2] = GTIA_COLPM2;
+	sig.colours[3] = GTIA_COLPM3;
+	sig.colours[4] = GTIA_COLPF0;
+	sig.colours[5] = GTIA_COLPF1;
+	sig.colours[6] = GTIA_COLPF2;
+	sig.colours[7] = GTIA_COLPF3;
+	sig.colours[8] = GTIA_COLBK;
+	sig.colours[9] = GTIA_PRIOR;
+	if (mode_line) {
+		sig.nchars = chars_displayed[md];
+		sig.x_min = x_min[md];
+		sig.ch_offset = ch_offset[md];
+		sig.left_border_chars = left_border_chars;
+		sig.right_border_start = right_border_start;
+		sig.blank_mask = blank_mask;
+		sig.artif_mode = ANTIC_artif_mode;
+		sig.artif_new = ANTIC_artif_new;
+		sig.chbase_20 = chbase_20;
+		sig.anticmode = anticmode;
+		sig.dctr = dctr;
+		sig.invert_mask = invert_mask;
+	}
+	unchanged = line_cache_valid[y] && memcmp(&sig, entry, size) == 0;
+	if (!unchanged)
+		memcpy(entry, &sig, size);
+
+	if (mode_line) {
+		int first;
+		int count = line_memory(ch_offset[md], chars_displayed[md], &first);
+		if (unchanged && memcmp(entry->memory + first, antic_memory + first, count) != 0)
+			unchanged = FALSE;
+		if (!unchanged)
+			memcpy(entry->memory + first, antic_memory + first, count);
+		if (anticmode <= 7) {
+			int chmask;
+			const UBYTE *chptr = line_font(MEMORY_mem, ANTIC_xe_ptr, anticmode, dctr, chbase_20, &chmask);
+			int i;
+			for (i = first; i < first + count; i++) {
+				UBYTE chdata = chptr[(antic_memory[i] & chmask) << 3];
+				if (entry->font[i] != chdata) {
+					entry->font[i] = chdata;
+					unchanged = FALSE;
+				}
+			}
+		}
+	}
+	line_cache_valid[y] = TRUE;
+	return unchanged;
+}
+
+#else /* ANTIC_LINE_CACHE */
+
+void ANTIC_RedrawLines(int first, int last)
+{
+}
+
+#endif /* ANTIC_LINE_CACHE */
+
+#ifdef ANTIC_RGB_SCREEN
+
+/* True-colour output ------------------------------------------------------- */
+
+static ULONG *rgb_surface = NULL;
+static int rgb_pitch;
+static int rgb_x;
+static int rgb_y;
+static int rgb_width;
+static int rgb_height;
+/* Colours_table the surface is drawn with */
+static int rgb_palette[256];
+
+int ANTIC_SetRGBScreen(ULONG *surface, int pitch, int x, int y, int width, int height)
+{
+	int ok = TRUE;
+	if (surface != NULL && (x < 0 || y < 0 || width <= 0 || height <= 0
+		|| x + width > Screen_WIDTH || y + height > Screen_HEIGHT || pitch < width)) {
+		surface = NULL;
+		ok = FALSE;
+	}
+	if (surface == rgb_surface && (surface == NULL || (pitch == rgb_pitch
+		&& x == rgb_x && y == rgb_y && width == rgb_width && height == rgb_height)))
+		return ok;
+	rgb_surface = surface;
+	rgb_pitch = pitch;
+	rgb_x = x;
+	rgb_y = y;
+	rgb_width = width;
+	rgb_height = height;
+	/* the scanlines in the cache have not been written to this surface */
+	ANTIC_RedrawLines(0, Screen_HEIGHT - 1);
+	return ok;
+}
+
+/* Writes the scanline of Screen_atari at ptr to the surface. */
+static void rgb_screen_line(const UWORD *ptr)
+{
+	int y = (int) (ptr - (const UWORD *) Screen_atari) / (Screen_WIDTH / 2) - rgb_y;
+	const UBYTE *src;
+	ULONG *dest;
+	int n;
+	if (y < 0 || y >= rgb_height)
+		return;
+	src = (const UBYTE *) ptr + rgb_x;
+	dest = rgb_surface + y * rgb_pitch;
+	for (n = rgb_width; n > 0; n--)
+		*dest++ = (ULONG) rgb_palette[*src++];
+}
+
+#endif /* ANTIC_RGB_SCREEN */
+
+#ifdef ANTIC_RENDER_THREAD
+
+/* Render thread ------------------------------------------------------------ */
+
+/* The emulation queues the scanlines in a ring and the render thread draws
+   them in order. ANTIC_Frame waits for the render thread to catch up at the
+   end of the frame, so at most Screen_HEIGHT scanlines and as many colour
+   sets are in the ring. The counters only grow. */
+#define RENDER_RING 256
+
+/* how many times the render thread checks for work before it sleeps */
+#define RENDER_SPIN 4000
+
+#define RENDER_LOAD(x) __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define RENDER_STORE(x, value) __atomic_store_n(&(x), (value), __ATOMIC_SEQ_CST)
+
+int ANTIC_render_thread = FALSE;
+
+static int render_started = FALSE;
+static struct render_line render_ring[RENDER_RING];
+static struct draw_colours render_colours[RENDER_RING];
+static unsigned int render_queued = 0;	/* written by the emulation */
+static unsigned int render_drawn = 0;	/* written by the render thread */
+static unsigned int render_colours_queued = 0;
+/* a scanline drawn by the emulation itself */
+static struct render_line render_inline;
+
+static pthread_mutex_t render_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_work = PTHREAD_COND_INITIALIZER;	/* render_queued has changed */
+static pthread_cond_t render_idle = PTHREAD_COND_INITIALIZER;	/* render_drawn has changed */
+static int render_sleeping = FALSE;	/* the render thread waits for render_work */
+static int render_waiting = FALSE;	/* the emulation waits for render_idle */
+
+/* COLPM0-3, COLPF0-3, COLBK and PRIOR of the last colours taken */
+static UBYTE render_registers[10];
+static int render_registers_valid = FALSE;
+
+/* the font data of the scanlines drawn on the render thread, where they
+   are in MEMORY_mem */
+static UBYTE render_font[65536];
+/* GTIA_pm_scanline of a scanline without player/missile graphics */
+static ULONG render_no_pm[sizeof(GTIA_pm_scanline) / sizeof(ULONG)];
+
+/* Returns TRUE if the colours have changed since they were last taken. */
+static int render_colours_changed(void)
+{
+	UBYTE registers[10];
+	registers[0] = GTIA_COLPM0;
+	registers[1] = GTIA_COLPM1;
+	registers[2] = GTIA_COLPM2;
+	registers[3] = GTIA_COLPM3;
+	registers[4] = GTIA_COLPF0;
+	registers[5] = GTIA_COLPF1;
+	registers[6] = GTIA_COLPF2;
+	registers[7] = GTIA_COLPF3;
+	registers[8] = GTIA_COLBK;
+	registers[9] = GTIA_PRIOR;
+	if (render_registers_valid && memcmp(registers, render_registers, sizeof(registers)) == 0)
+		return FALSE;
+	memcpy(render_registers, registers, sizeof(registers));
+	render_registers_valid = TRUE;
+	return TRUE;
+}
+
+static void render_get_colours(struct draw_colours *colours)
+{
+	memcpy(colours->cl, ANTIC_cl, sizeof(colours->cl));
+	memcpy(colours->lookup_gtia9, ANTIC_lookup_gtia9, sizeof(colours->lookup_gtia9));
+	memcpy(colours->lookup_gtia11, ANTIC_lookup_gtia11, sizeof(colours->lookup_gtia11));
+	memcpy(colours->hires_lookup_l, ANTIC_hires_lookup_l, sizeof(colours->hires_lookup_l));
+	colours->pm_lookup_ptr = pm_lookup_ptr;
+	colours->colpf3 = GTIA_COLPF3;
+	colours->colbk = GTIA_COLBK;
+}
+
+/* Draws the scanline from memory, which is antic_memory or a copy of it. */
+static void render_draw(const struct render_line *line, const UBYTE *memory)
+{
+	draw_line = line;
+	if (line->draw_antic == NULL)
+		line->draw_antic_0();
+	else
+		line->draw_antic(line->nchars, memory + ANTIC_margin + line->ch_offset,
+			line->scrn_ptr + line->x_min, (const ULONG *) &draw_pm_scanline[line->x_min]);
+}
+
+static void *render_thread(void *arg)
+{
+	unsigned int drawn = RENDER_LOAD(render_drawn);
+	for (;;) {
+		int spin = RENDER_SPIN;
+		while (RENDER_LOAD(render_queued) == drawn && --spin > 0);
+		if (spin == 0) {
+			pthread_mutex_lock(&render_mutex);
+			RENDER_STORE(render_sleeping, TRUE);
+			while (RENDER_LOAD(render_queued) == drawn)
+				pthread_cond_wait(&render_work, &render_mutex);
+			RENDER_STORE(render_sleeping, FALSE);
+			pthread_mutex_unlock(&render_mutex);
+		}
+		do {
+			const struct render_line *line = &render_ring[drawn % RENDER_RING];
+			if (line->colours != NULL)
+				draw_colours = *line->colours;
+			draw_pm_scanline = (const UBYTE *) render_no_pm;
+			draw_pm_dirty = FALSE;
+			draw_mem = render_font;
+			draw_xe_ptr = NULL;
+			if (line->draw_antic != NULL && line->anticmode <= 7) {
+				/* put the font bytes where draw_antic reads them */
+				int first;
+				int count = line_memory(line->ch_offset, line->nchars, &first);
+				int chmask;
+				UBYTE *chptr = (UBYTE *) line_font(render_font, NULL, line->anticmode, line->dctr, line->chbase_20, &chmask);
+				int i;
+				for (i = first; i < first + count; i++)
+					chptr[(line->memory[i] & chmask) << 3] = line->font[i];
+			}
+			render_draw(line, line->memory);
+			if (rgb_surface != NULL
+#ifndef NO_SIMPLE_PAL_BLENDING
+				&& !ANTIC_pal_blending
+#endif
+				)
+				rgb_screen_line(line->scrn_ptr);
+			RENDER_STORE(render_drawn, ++drawn);
+			if (RENDER_LOAD(render_waiting)) {
+				pthread_mutex_lock(&render_mutex);
+				pthread_cond_signal(&render_idle);
+				pthread_mutex_unlock(&render_mutex);
+			}
+		} while (RENDER_LOAD(render_queued) != drawn);
+	}
+	return NULL;
+}
+
+/* Waits until the render thread has drawn all the queued scanlines. */
+static void render_sync(void)
+{
+	if (RENDER_LOAD(render_drawn) == render_queued)
+		return;
+	pthread_mutex_lock(&render_mutex);
+	RENDER_STORE(render_waiting, TRUE);
+	while (RENDER_LOAD(render_drawn) != render_queued)
+		pthread_cond_wait(&render_idle, &render_mutex);
+	RENDER_STORE(render_waiting, FALSE);
+	pthread_mutex_unlock(&render_mutex);
+}
+
+static void render_atfork_child(void)
+{
+	/* only the thread that called fork runs in the child */
+	render_started = FALSE;
+	render_sleeping = FALSE;
+	render_waiting = FALSE;
+	pthread_mutex_init(&render_mutex, NULL);
+	pthread_cond_init(&render_work, NULL);
+	pthread_cond_init(&render_idle, NULL);
+}
+
+static void render_start(void)
+{
+	static int atfork = FALSE;
+	pthread_t thread;
+	if (!atfork) {
+		pthread_atfork(NULL, NULL, render_atfork_child);
+		atfork = TRUE;
+	}
+	if (pthread_create(&thread, NULL, render_thread, NULL) != 0) {
+		Log_print("Cannot start the render thread");
+		ANTIC_render_thread = FALSE;
+		return;
+	}
+	pthread_detach(thread);
+	render_started = TRUE;
+}
+
+/* Draws the current scanline, or queues it for the render thread if it has
+   no player/missile graphics. Returns TRUE if the scanline is queued. */
+static int render_line(int mode_line)
+{
+	int colours_changed = render_colours_changed();
+	int queue = render_started && ANTIC_render_thread && !GTIA_pm_dirty
+		/* the YPOS BREAK FLICKER line gets overwritten */
+		&& ANTIC_ypos + 1 != ANTIC_break_ypos - 1000;
+	struct render_line *line = queue ? &render_ring[render_queued % RENDER_RING] : &render_inline;
+	int row;
+
+	line->draw_antic = mode_line ? draw_antic_ptr : NULL;
+	line->draw_antic_0 = draw_antic_0_ptr;
+	line->scrn_ptr = scrn_ptr;
+	if (mode_line) {
+		ANTIC_xpos += LINE_FONT_CYCLES;
+		line->nchars = chars_displayed[md];
+		line->x_min = x_min[md];
+		line->ch_offset = ch_offset[md];
+		line->left_border_chars = left_border_chars;
+		line->right_border_start = right_border_start;
+		line->blank_mask = blank_mask;
+		line->chbase_20 = chbase_20;
+		line->anticmode = anticmode;
+		line->dctr = dctr;
+		line->invert_mask = invert_mask;
+	}
+
+	if (queue) {
+		line->colours = NULL;
+		if (colours_changed) {
+			struct draw_colours *colours = &render_colours[render_colours_queued++ % RENDER_RING];
+			render_get_colours(colours);
+			line->colours = colours;
+		}
+		if (mode_line) {
+			int first;
+			int count = line_memory(ch_offset[md], chars_displayed[md], &first);
+			memcpy(line->memory + first, antic_memory + first, count);
+			if (anticmode <= 7) {
+				int chmask;
+				const UBYTE *chptr = line_font(MEMORY_mem, ANTIC_xe_ptr, anticmode, dctr, chbase_20, &chmask);
+				int i;
+				for (i = first; i < first + count; i++)
+					line->font[i] = chptr[(antic_memory[i] & chmask) << 3];
+			}
+		}
+		RENDER_STORE(render_queued, render_queued + 1);
+		if (RENDER_LOAD(render_sleeping)) {
+			pthread_mutex_lock(&render_mutex);
+			pthread_cond_signal(&render_work);
+			pthread_mutex_unlock(&render_mutex);
+		}
+		return TRUE;
+	}
+
+	/* the drawing state and the scratch tables are free when the render thread is idle */
+	render_sync();
+	if (colours_changed)
+		render_get_colours(&draw_colours);
+	draw_pm_scanline = GTIA_pm_scanline;
+	draw_pm_dirty = GTIA_pm_dirty;
+	draw_mem = MEMORY_mem;
+	draw_xe_ptr = ANTIC_xe_ptr;
+	/* the collisions are detected in the colour lookup table */
+	for (row = 0; row < 128; row += 16)
+		draw_colours.cl[row | C_COLLS] = ANTIC_cl[row | C_COLLS];
+	render_draw(line, antic_memory);
+	for (row = 0; row < 128; row += 16)
+		ANTIC_cl[row | C_COLLS] = draw_colours.cl[row | C_COLLS];
+	return FALSE;
+}
+
+#endif /* ANTIC_RENDER_THREAD */
+
+#ifdef COLLISION_FRAMES
+
+/* Collisions only ---------------------------------------------------------- */
+
+/* where line_collisions draws the scanlines, aligned as Screen_atari */
+static ULONG collisions_scanline[Screen_WIDTH / 4];
+
+/* Adds the collisions of the player/missile graphics of the current mode line
+   with the playfield, exactly as draw_antic_ptr would, but without drawing.
+   Returns FALSE for the GTIA modes and artifacting, which it doesn't handle. */
+static int pf_collisions(void)
+{
+	/* playfield colour register of two bits of data, as in playfield_lookup */
+	static const UBYTE colreg_2[4] = { L_BAK, L_PF0, L_PF1, L_PF2 };
+	/* colour register of a character in modes 6 and 7 */
+	static const UBYTE colreg_6[4] = { L_PF0, L_PF1, L_PF2, L_PF3 };
+	const UBYTE *antic_memptr = antic_memory + ANTIC_margin + ch_offset[md];
+	const UBYTE *pm = &GTIA_pm_scanline[x_min[md]];
+	int nchars = chars_displayed[md];
+	const UBYTE *chptr = NULL;
+	int chmask = 0;
+	UBYTE fetch[8];
+	int k;
+
+	switch (anticmode) {
+	case 2:
+	case 3:
+		if (draw_antic_ptr != draw_antic_2)
+			return FALSE;
+		chptr = line_font(MEMORY_mem, ANTIC_xe_ptr, anticmode, dctr, chbase_20, &chmask);
+		/* blank_lookup as set by INIT_ANTIC_2 */
+		fetch[0] = fetch[1] = fetch[2] = (dctr & 0xe) != 8;
+		fetch[3] = anticmode == 2 || dctr & 0xe;
+		fetch[4] = fetch[5] = fetch[6] = fetch[7] = FALSE;
+		break;
+	case 4:
+	case 5:
+		if (draw_antic_ptr != draw_antic_4)
+			return FALSE;
+		chptr = line_font(MEMORY_mem, ANTIC_xe_ptr, anticmode, dctr, chbase_20, &chmask);
+		break;
+	case 6:
+	case 7:
+		if (draw_antic_ptr != draw_antic_6)
+			return FALSE;
+		chptr = line_font(MEMORY_mem, ANTIC_xe_ptr, anticmode, dctr, chbase_20, &chmask);
+		break;
+	case 8:
+		if (draw_antic_ptr != draw_antic_8)
+			return FALSE;
+		break;
+	case 9:
+		if (draw_antic_ptr != draw_antic_9)
+			return FALSE;
+		break;
+	case 0xa:
+		if (draw_antic_ptr != draw_antic_a)
+			return FALSE;
+		break;
+	case 0xb:
+	case 0xc:
+		if (draw_antic_ptr != draw_antic_c)
+			return FALSE;
+		break;
+	case 0xd:
+	case 0xe:
+		if (draw_antic_ptr != draw_antic_e)
+			return FALSE;
+		break;
+	default:
+		if (draw_antic_ptr != draw_antic_f)
+			return FALSE;
+		break;
+	}
+	ANTIC_xpos += LINE_FONT_CYCLES;
+
+	do {
+		UBYTE screendata = *antic_memptr++;
+		int chdata;
+		switch (anticmode) {
+		case 2:
+		case 3:
+		case 0xf:
+			/* each two hires pixels collide as PF2 */
+			if (anticmode == 0xf)
+				chdata = screendata;
+			else {
+				chdata = (screendata & invert_mask) ? 0xff : 0;
+				if (fetch[(screendata & blank_mask) >> 5])
+					chdata ^= chptr[(screendata & chmask) << 3];
+			}
+			for (k = 0; k < 4; k++, chdata <<= 2)
+				if (chdata & 0xc0)
+					PF2PM |= pm[k];
+			pm += 4;
+			break;
+		case 4:
+		case 5:
+			chdata = chptr[(screendata & chmask) << 3];
+			for (k = 0; k < 4; k++, chdata <<= 2) {
+				int data = (chdata >> 6) & 3;
+				if (data == 3 && screendata & 0x80)
+					PF3PM |= pm[k];
+				else
+					PF_COLLS(colreg_2[data]) |= pm[k];
+			}
+			pm += 4;
+			break;
+		case 6:
+		case 7:
+			chdata = chptr[(screendata & chmask) << 3];
+			for (k = 0; k < 8; k++, chdata <<= 1)
+				if (chdata & 0x80)
+					PF_COLLS(colreg_6[screendata >> 6]) |= pm[k];
+			pm += 8;
+			break;
+		case 8:
+		case 9:
+			/* draw_antic_8 and draw_antic_9 stop at the right chop */
+			for (k = 0; k < 16 && pm + (k & ~3) < GTIA_pm_scanline + 4 * (48 - RCHOP); k++) {
+				if (anticmode == 8)
+					PF_COLLS(colreg_2[(screendata >> (6 - (k >> 2 << 1))) & 3]) |= pm[k];
+				else if ((screendata << (k >> 1)) & 0x80)
+					PF0PM |= pm[k];
+			}
+			pm += 16;
+			break;
+		case 0xa:
+			for (k = 0; k < 8; k++)
+				PF_COLLS(colreg_2[(screendata >> (6 - (k >> 1 << 1))) & 3]) |= pm[k];
+			pm += 8;
+			break;
+		case 0xb:
+		case 0xc:
+			for (k = 0; k < 8; k++)
+				if ((screendata << k) & 0x80)
+					PF0PM |= pm[k];
+			pm += 8;
+			break;
+		default:
+			for (k = 0; k < 4; k++)
+				PF_COLLS(colreg_2[(screendata >> (6 - 2 * k)) & 3]) |= pm[k];
+			pm += 4;
+			break;
+		}
+	} while (--nchars);
+	return TRUE;
+}
+
+/* Adds the collisions of the current mode line with the playfield. */
+static void line_collisions(void)
+{
+	/* The routines of the GTIA modes leave the playfield in an_scanline,
+	   where the next scanlines may read it, so these are always drawn. */
+	int gtia_mode = draw_antic_ptr != draw_antic_table[0][anticmode];
+	UWORD *line_ptr;
+	if (!gtia_mode) {
+		if (!GTIA_pm_dirty) {
+			/* nothing to collide with */
+			ANTIC_xpos += LINE_FONT_CYCLES;
+			return;
+		}
+		if (pf_collisions())
+			return;
+	}
+	/* draw the scanline where it isn't seen */
+	line_ptr = scrn_ptr;
+	scrn_ptr = (UWORD *) collisions_scanline;
+#ifdef ANTIC_RENDER_THREAD
+	render_line(TRUE);
+#else
+	draw_antic_ptr(chars_displayed[md],
+		antic_memory + ANTIC_margin + ch_offset[md],
+		scrn_ptr + x_min[md],
+		(ULONG *) &GTIA_pm_scanline[x_min[md]]);
+#endif
+	scrn_ptr = line_ptr;
+}
+
+#endif /* COLLISION_FRAMES */
+
 #ifdef NEW_CYCLE_EXACT
 int ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
 #endif
@@ -2866,6 +3704,18 @@ void ANTIC_Frame(int draw_display)
 #ifdef NEW_CYCLE_EXACT
 	int cpu2antic_index;
 #endif /* NEW_CYCLE_EXACT */
+#ifdef ANTIC_LINE_CACHE
+	int line_cached = FALSE;	/* the current scanline is already in Screen_atari */
+#endif
+#ifdef COLLISION_FRAMES
+/* the scanlines are not drawn, only their collisions are added */
+#define COLLISIONS_ONLY (draw_display == ANTIC_COLLISIONS_ONLY)
+#else
+#define COLLISIONS_ONLY FALSE
+#endif
+#ifdef ANTIC_RENDER_THREAD
+	int line_queued = FALSE;	/* the render thread draws the current scanline */
+#endif
 
 	ANTIC_ypos = 0;
 	do {
@@ -2876,6 +3726,25 @@ void ANTIC_Frame(int draw_display)
 	scrn_ptr = (UWORD *) Screen_atari;
 #ifdef NEW_CYCLE_EXACT
 	ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
+#endif
+#ifdef ANTIC_LINE_CACHE
+	if (Screen_atari != line_cache_screen || !ANTIC_line_cache) {
+		/* the cached scanlines are in another buffer */
+		memset(line_cache_valid, FALSE, sizeof(line_cache_valid));
+		line_cache_screen = ANTIC_line_cache ? Screen_atari : NULL;
+	}
+#endif
+#ifdef ANTIC_RGB_SCREEN
+	if (rgb_surface != NULL && memcmp(rgb_palette, Colours_table, sizeof(rgb_palette)) != 0) {
+		/* the palette has changed, so has every scanline of the surface */
+		memcpy(rgb_palette, Colours_table, sizeof(rgb_palette));
+		ANTIC_RedrawLines(0, Screen_HEIGHT - 1);
+	}
+#endif
+#ifdef ANTIC_RENDER_THREAD
+	if (ANTIC_render_thread && !render_started)
+		render_start();
+	render_registers_valid = FALSE;
 #endif
 	need_dl = TRUE;
 	do {
@@ -2895,6 +3764,9 @@ void ANTIC_Frame(int draw_display)
 #endif
 
 		need_load = FALSE;
+#ifdef ANTIC_RENDER_THREAD
+		line_queued = FALSE;
+#endif
 		if (need_dl) {
 			if (ANTIC_DMACTL & 0x20) {
 				IR = ANTIC_GetDLByte(&ANTIC_dlist);
@@ -3074,6 +3946,30 @@ void ANTIC_Frame(int draw_display)
 #define YPOS_BREAK_FLICKER do{}while(0)
 #endif /* NO_YPOS_BREAK_FLICKER */
 
+#ifdef ANTIC_RGB_SCREEN
+#ifdef ANTIC_LINE_CACHE
+#ifdef ANTIC_RENDER_THREAD
+/* the render thread writes the queued scanlines to the surface itself */
+#define RGB_SCREEN_LINE do{if (rgb_surface != NULL && !line_cached && !line_queued && !RGB_PAL_BLENDING)\
+				rgb_screen_line(scrn_ptr);}while(0)
+#else
+#define RGB_SCREEN_LINE do{if (rgb_surface != NULL && !line_cached && !RGB_PAL_BLENDING)\
+				rgb_screen_line(scrn_ptr);}while(0)
+#endif /* ANTIC_RENDER_THREAD */
+#else
+#define RGB_SCREEN_LINE do{if (rgb_surface != NULL && !RGB_PAL_BLENDING)\
+				rgb_screen_line(scrn_ptr);}while(0)
+#endif /* ANTIC_LINE_CACHE */
+#ifndef NO_SIMPLE_PAL_BLENDING
+/* PAL blending changes the scanlines after the whole frame is drawn */
+#define RGB_PAL_BLENDING ANTIC_pal_blending
+#else
+#define RGB_PAL_BLENDING FALSE
+#endif
+#else
+#define RGB_SCREEN_LINE do{}while(0)
+#endif /* ANTIC_RGB_SCREEN */
+
 #ifdef NEW_CYCLE_EXACT
 		GTIA_NewPmScanline();
 		if (anticmode < 2 || (ANTIC_DMACTL & 3) == 0) {
@@ -3083,6 +3979,7 @@ void ANTIC_Frame(int draw_display)
 			UPDATE_GTIA_BUG;
 			ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
 			YPOS_BREAK_FLICKER;
+			RGB_SCREEN_LINE;
 			scrn_ptr += Screen_WIDTH / 2;
 			if (no_jvb) {
 				dctr++;
@@ -3107,9 +4004,23 @@ void ANTIC_Frame(int draw_display)
 		ANTIC_xpos += ANTIC_DMAR;
 
 		if (anticmode < 2 || (ANTIC_DMACTL & 3) == 0) {
-			draw_antic_0_ptr();
+			/* the background doesn't collide */
+			if (!COLLISIONS_ONLY) {
+#ifdef ANTIC_LINE_CACHE
+				line_cached = ANTIC_line_cache && line_unchanged(FALSE);
+				if (!line_cached)
+#endif
+#ifdef ANTIC_RENDER_THREAD
+					line_queued = render_line(FALSE);
+#else
+					draw_antic_0_ptr();
+#endif
+			}
 			GOEOL;
-			YPOS_BREAK_FLICKER;
+			if (!COLLISIONS_ONLY) {
+				YPOS_BREAK_FLICKER;
+				RGB_SCREEN_LINE;
+			}
 			scrn_ptr += Screen_WIDTH / 2;
 			if (no_jvb) {
 				dctr++;
@@ -3134,22 +4045,43 @@ void ANTIC_Frame(int draw_display)
 				ANTIC_xpos -= extra_cycles[md];
 		}
 
-		draw_antic_ptr(chars_displayed[md],
-			antic_memory + ANTIC_margin + ch_offset[md],
-			scrn_ptr + x_min[md],
-			(ULONG *) &GTIA_pm_scanline[x_min[md]]);
+#ifdef COLLISION_FRAMES
+		if (COLLISIONS_ONLY)
+			line_collisions();
+		else
+#endif
+#ifdef ANTIC_LINE_CACHE
+		if ((line_cached = ANTIC_line_cache && line_unchanged(TRUE)))
+			ANTIC_xpos += LINE_FONT_CYCLES;
+		else
+#endif
+#ifdef ANTIC_RENDER_THREAD
+			line_queued = render_line(TRUE);
+#else
+			draw_antic_ptr(chars_displayed[md],
+				antic_memory + ANTIC_margin + ch_offset[md],
+				scrn_ptr + x_min[md],
+				(ULONG *) &GTIA_pm_scanline[x_min[md]]);
+#endif
 
 		GOEOL;
 #endif /* NEW_CYCLE_EXACT */
-		YPOS_BREAK_FLICKER;
+		if (!COLLISIONS_ONLY) {
+			YPOS_BREAK_FLICKER;
+			RGB_SCREEN_LINE;
+		}
 		scrn_ptr += Screen_WIDTH / 2;
 		dctr++;
 		dctr &= 0xf;
 	} while (ANTIC_ypos < (Screen_HEIGHT + 8));
 
+#ifdef ANTIC_RENDER_THREAD
+	render_sync();
+#endif
+
 #ifndef NO_SIMPLE_PAL_BLENDING
 	/* Simple PAL blending, using only the base 256 color palette. */
-	if (ANTIC_pal_blending)
+	if (ANTIC_pal_blending && !COLLISIONS_ONLY)
 	{
 		int ypos = ANTIC_ypos - 1;
 		/* Start at the last screen line (248). */
@@ -3175,6 +4107,13 @@ void ANTIC_Frame(int draw_display)
 			} while (--k);
 			ptr -= 2 * (LCHOP + RCHOP); /* Move one line up */
 		} while (--ypos > 8); /* Stop after line 9 */
+#ifdef ANTIC_RGB_SCREEN
+		if (rgb_surface != NULL && draw_display) {
+			const UWORD *line = (const UWORD *) Screen_atari;
+			for (ypos = 0; ypos < Screen_HEIGHT; ypos++, line += Screen_WIDTH / 2)
+				rgb_screen_line(line);
+		}
+#endif
 	}
 #endif /* NO_SIMPLE_PAL_BLENDING */
 
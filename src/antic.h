@@ -74,6 +74,11 @@ extern UBYTE ANTIC_PENV_input;
 int ANTIC_Initialise(int *argc, char *argv[]);
 void ANTIC_Reset(void);
 void ANTIC_Frame(int draw_display);
+/* Pass as draw_display to ANTIC_Frame for a frame that isn't displayed, but
+   whose collisions of player/missile graphics with the playfield are needed.
+   The scanlines aren't drawn, Screen_atari is left as it was. In the
+   cycle-exact builds such a frame is drawn as with TRUE. */
+#define ANTIC_COLLISIONS_ONLY 2
 UBYTE ANTIC_GetByte(UWORD addr, int no_side_effects);
 void ANTIC_PutByte(UWORD addr, UBYTE byte);
 
@@ -118,8 +123,8 @@ extern UWORD ANTIC_hires_lookup_l[128];
 #define ANTIC_DRAWING_SCREEN (ANTIC_cur_screen_pos!=ANTIC_NOT_DRAWING)
 extern int ANTIC_delayed_wsync;
 extern int ANTIC_cur_screen_pos;
-extern const int *ANTIC_cpu2antic_ptr;
-extern const int *ANTIC_antic2cpu_ptr;
+extern const SBYTE *ANTIC_cpu2antic_ptr;
+extern const SBYTE *ANTIC_antic2cpu_ptr;
 void ANTIC_UpdateScanline(void);
 void ANTIC_UpdateScanlinePrior(UBYTE byte);
 
@@ -134,4 +139,46 @@ void ANTIC_UpdateScanlinePrior(UBYTE byte);
 extern int ANTIC_pal_blending;
 #endif /* NO_SIMPLE_PAL_BLENDING */
 
+/* The scanline cache compares what each scanline is made of (display list
+   mode, screen and font data, colour registers) with the previous frame
+   and skips drawing the scanlines that haven't changed. It isn't available
+   in the builds where a scanline can be redrawn partially or its pixels
+   depend on more than the 8-bit colour codes. */
+#if !defined(BASIC) && !defined(CURSES_BASIC) && !defined(NEW_CYCLE_EXACT) \
+	&& !defined(PAGED_MEM) && !defined(USE_COLOUR_TRANSLATION_TABLE)
+#define ANTIC_LINE_CACHE
+/* Set to TRUE to skip drawing the unchanged scanlines. */
+extern int ANTIC_line_cache;
+#endif
+
+/* The render thread draws the scanlines without player/missile graphics on
+   a second thread, while the emulation goes on with the next scanlines.
+   The scanlines with player/missile graphics are still drawn at once,
+   because they set the collision registers. ANTIC_Frame returns when the
+   whole frame is drawn. The render thread is built with RENDER_THREAD
+   in the same builds as the scanline cache, except DIRTYRECT. */
+#if defined(RENDER_THREAD) && defined(ANTIC_LINE_CACHE) && !defined(DIRTYRECT)
+#define ANTIC_RENDER_THREAD
+/* Set to TRUE to draw on the render thread. */
+extern int ANTIC_render_thread;
+#endif
+
+/* Makes the next frame draw scanlines first..last (0..Screen_HEIGHT-1)
+   of Screen_atari in full. Call it after drawing over the Atari screen. */
+void ANTIC_RedrawLines(int first, int last);
+
+/* True-colour output: ANTIC can also write every scanline it draws, as soon
+   as it is drawn, into a caller's surface of 32-bit 0x00RRGGBB pixels taken
+   from Colours_table. Screen_atari is still drawn as before. It isn't
+   available in the builds where Screen_atari doesn't hold palette indices. */
+#if !defined(BASIC) && !defined(CURSES_BASIC) && !defined(USE_COLOUR_TRANSLATION_TABLE)
+#define ANTIC_RGB_SCREEN
+/* Sets the surface that receives the area of Screen_atari at x, y of size
+   width by height, with pitch pixels per row of the surface. NULL stops
+   the output. Returns FALSE and stops the output if the area doesn't fit
+   in Screen_atari. Anything drawn over Screen_atari after ANTIC_Frame
+   doesn't get into the surface. */
+int ANTIC_SetRGBScreen(ULONG *surface, int pitch, int x, int y, int width, int height);
+#endif
+
 #endif /* ANTIC_H_ */
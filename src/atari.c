@@ -65,11 +65,15 @@
 #include "cassette.h"
 #include "cfg.h"
 #include "cpu.h"
+#ifdef CPU_JIT
+#include "cpu_jit.h"
+#endif
 #include "devices.h"
 #include "esc.h"
 #include "gtia.h"
 #include "input.h"
 #include "log.h"
+#include "mathpack.h"
 #include "memory.h"
 #include "monitor.h"
 #ifdef IDE
@@ -81,6 +85,8 @@
 #include "pia.h"
 #include "platform.h"
 #include "pokey.h"
+#include "rewind.h"
+#include "shmstream.h"
 #include "rtime.h"
 #include "pbi.h"
 #include "sio.h"
@@ -571,7 +577,11 @@ int Atari800_Initialise(int *argc, char *argv[])
 		else if (strcmp(argv[i], "-nopatch") == 0)
 			ESC_enable_sio_patch = FALSE;
 		else if (strcmp(argv[i], "-nopatchall") == 0)
-			ESC_enable_sio_patch = Devices_enable_h_patch = Devices_enable_p_patch = Devices_enable_r_patch = FALSE;
+			ESC_enable_sio_patch = Devices_enable_h_patch = Devices_enable_p_patch = Devices_enable_r_patch = MATHPACK_enable_patch = FALSE;
+		else if (strcmp(argv[i], "-fppatch") == 0)
+			MATHPACK_enable_patch = TRUE;
+		else if (strcmp(argv[i], "-nofppatch") == 0)
+			MATHPACK_enable_patch = FALSE;
 		else if (strcmp(argv[i], "-pal") == 0)
 			Atari800_tv_mode = Atari800_TV_PAL;
 		else if (strcmp(argv[i], "-ntsc") == 0)
@@ -600,6 +610,14 @@ int Atari800_Initialise(int *argc, char *argv[])
 		else if (strcmp(argv[i], "-turbo") == 0) {
 			Atari800_turbo = TRUE;
 		}
+		else if (strcmp(argv[i], "-idleskip") == 0)
+			CPU_idle_skip = TRUE;
+		else if (strcmp(argv[i], "-noidleskip") == 0)
+			CPU_idle_skip = FALSE;
+		else if (strcmp(argv[i], "-fastloops") == 0)
+			CPU_fast_loops = TRUE;
+		else if (strcmp(argv[i], "-nofastloops") == 0)
+			CPU_fast_loops = FALSE;
 		else {
 			/* parameters that take additional argument follow here */
 			int i_a = (i + 1 < *argc);		/* is argument available? */
@@ -719,6 +737,8 @@ int Atari800_Initialise(int *argc, char *argv[])
 #endif
 					Log_print("\t-nopatch         Don't patch SIO routine in OS");
 					Log_print("\t-nopatchall      Don't patch OS at all, H: device won't work");
+					Log_print("\t-fppatch         Run the floating point routines of AltirraOS natively");
+					Log_print("\t-nofppatch       Emulate the floating point routines in OS");
 					Log_print("\t-c               Enable RAM between 0xc000 and 0xcfff in Atari 800");
 					Log_print("\t-axlon <n>       Use Atari 800 Axlon memory expansion: <n> k total RAM");
 					Log_print("\t-axlon0f         Use Axlon shadow at 0x0fc0-0x0fff");
@@ -729,6 +749,10 @@ int Atari800_Initialise(int *argc, char *argv[])
 					Log_print("\t-rdevice [<dev>] Enable R: emulation (using serial device <dev>)");
 #endif
 					Log_print("\t-turbo           Run emulated Atari as fast as possible");
+					Log_print("\t-idleskip        Skip over idle loops of the emulated program");
+					Log_print("\t-noidleskip      Emulate every iteration of idle loops");
+					Log_print("\t-fastloops       Run simple memory copy loops natively");
+					Log_print("\t-nofastloops     Emulate every instruction of copy loops");
 #ifdef MONITOR_HINTS
 					Log_print("\t-label-file <f>  Load monitor labels from file <f>");
 #endif
@@ -781,11 +805,15 @@ int Atari800_Initialise(int *argc, char *argv[])
 		|| !CARTRIDGE_Initialise(argc, argv)
 		|| !CASSETTE_Initialise(argc, argv)
 		|| !PBI_Initialise(argc,argv)
+#ifdef CPU_JIT
+		|| !JIT_Initialise(argc, argv)
+#endif
 #ifdef VOICEBOX
 		|| !VOICEBOX_Initialise(argc, argv)
 #endif
 #ifndef BASIC
 		|| !INPUT_Initialise(argc, argv)
+		|| !REWIND_Initialise(argc, argv)
 #endif
 #ifdef XEP80_EMULATION
 		|| !XEP80_Initialise(argc, argv)
@@ -809,6 +837,7 @@ int Atari800_Initialise(int *argc, char *argv[])
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 		|| !Screen_Initialise(argc, argv)
 		|| !UI_Initialise(argc, argv)
+		|| !SHMSTREAM_Initialise(argc, argv)
 #if !defined(DREAMCAST) && defined(MULTIMEDIA)
 		|| !File_Export_Initialise(argc, argv)
 #endif
@@ -1025,6 +1054,10 @@ int Atari800_Exit(int run_monitor)
 #endif
 #ifndef BASIC
 		INPUT_Exit();	/* finish event recording */
+		REWIND_Exit();
+#endif
+#ifdef CPU_JIT
+		JIT_Exit();
 #endif
 		PBI_Exit();
 		CASSETTE_Exit(); /* Finish writing to the cassette file */
@@ -1042,6 +1075,9 @@ int Atari800_Exit(int run_monitor)
 #endif
 #if !defined(DREAMCAST) && defined(MULTIMEDIA)
 		File_Export_StopRecording();
+#endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+		SHMSTREAM_Exit();
 #endif
 		MONITOR_Exit();
 #ifdef SDL
@@ -1296,6 +1332,9 @@ void Atari800_Frame(void)
 	case AKEY_TURBO:
 		Atari800_turbo = !Atari800_turbo;
 		break;
+	case AKEY_REWIND:
+		REWIND_Back(1);
+		break;
 	case AKEY_UI:
 #ifdef SOUND
 		Sound_Pause();
@@ -1362,18 +1401,24 @@ void Atari800_Frame(void)
 #if defined(VERY_SLOW) || defined(CURSES_BASIC)
 		basic_frame();
 #else
-		ANTIC_Frame(Atari800_collisions_in_skipped_frames);
+		ANTIC_Frame(Atari800_collisions_in_skipped_frames ? ANTIC_COLLISIONS_ONLY : FALSE);
 #endif
 		Atari800_display_screen = FALSE;
 	}
 #endif /* BASIC */
 	POKEY_Frame();
+#ifndef BASIC
+	REWIND_Frame();
+#endif
 #ifdef VIDEO_RECORDING
 	File_Export_WriteVideo();
 #endif
 #ifdef SOUND
 	Sound_Update();
 #endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	SHMSTREAM_Frame(Atari800_display_screen);
+#endif
 #if defined(MULTIMEDIA) && (!defined(BASIC) && !defined(CURSES_BASIC))
 	/* multimedia stats are drawn here so they don't get recorded in the video */
 	Screen_DrawMultimediaStats();
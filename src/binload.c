@@ -131,8 +131,8 @@ static void loader_cont(void)
 				if (MEMORY_dGetByte(0x2e3) != 0xd7) {
 					/* run INIT routine which RTSes directly to RUN routine */
 					CPU_regPC--;
-					MEMORY_dPutByte(0x0100 + CPU_regS--, CPU_regPC >> 8);		/* high */
-					MEMORY_dPutByte(0x0100 + CPU_regS--, CPU_regPC & 0xff);	/* low */
+					MEMORY_dPushByte(CPU_regS--, CPU_regPC >> 8);		/* high */
+					MEMORY_dPushByte(CPU_regS--, CPU_regPC & 0xff);	/* low */
 					CPU_regPC = MEMORY_dGetWordAligned(0x2e2);
 				}
 				return;
@@ -146,7 +146,7 @@ static void loader_cont(void)
 	CPU_regS--;
 	ESC_Add((UWORD) (0x100 + CPU_regS), ESC_BINLOADER_CONT, loader_cont);
 	CPU_regS--;
-	MEMORY_dPutByte(0x0100 + CPU_regS--, 0x01);	/* high */
+	MEMORY_dPushByte(CPU_regS--, 0x01);	/* high */
 	MEMORY_dPutByte(0x0100 + CPU_regS, CPU_regS + 1);	/* low */
 	CPU_regS--;
 	CPU_regPC = MEMORY_dGetWordAligned(0x2e2);
@@ -222,3 +222,33 @@ int BINLOAD_Loader(const char *filename)
 	Log_print("binload: \"%s\" not recognized as a DOS or BASIC program", filename);
 	return FALSE;
 }
+
+#ifdef LIBATARI800
+void BINLOAD_SaveContext(BINLOAD_context_t *context)
+{
+	context->bin_file = BINLOAD_bin_file;
+	context->start_binloading = BINLOAD_start_binloading;
+	context->loading_basic = BINLOAD_loading_basic;
+	context->wait_active = BINLOAD_wait_active;
+	context->pause_loading = BINLOAD_pause_loading;
+	context->instr_elapsed = instr_elapsed;
+	context->from = from;
+	context->to = to;
+	context->init2e3 = init2e3;
+	context->segfinished = segfinished;
+}
+
+void BINLOAD_RestoreContext(const BINLOAD_context_t *context)
+{
+	BINLOAD_bin_file = context->bin_file;
+	BINLOAD_start_binloading = context->start_binloading;
+	BINLOAD_loading_basic = context->loading_basic;
+	BINLOAD_wait_active = context->wait_active;
+	BINLOAD_pause_loading = context->pause_loading;
+	instr_elapsed = context->instr_elapsed;
+	from = context->from;
+	to = context->to;
+	init2e3 = context->init2e3;
+	segfinished = context->segfinished;
+}
+#endif /* LIBATARI800 */
@@ -28,4 +28,24 @@ extern int BINLOAD_pause_loading;
 #define BINLOAD_LOADING_BASIC_RUN                7
 int BINLOAD_LoaderStart(UBYTE *buffer);
 
+#ifdef LIBATARI800
+/* Loader progress of one emulated machine, used to switch machines between
+   frames while a DOS or BASIC file is still being loaded. */
+typedef struct {
+	FILE *bin_file;
+	int start_binloading;
+	int loading_basic;
+	int wait_active;
+	int pause_loading;
+	unsigned int instr_elapsed;
+	UWORD from;
+	UWORD to;
+	int init2e3;
+	int segfinished;
+} BINLOAD_context_t;
+
+void BINLOAD_SaveContext(BINLOAD_context_t *context);
+void BINLOAD_RestoreContext(const BINLOAD_context_t *context);
+#endif /* LIBATARI800 */
+
 #endif /* BINLOAD_H_ */
@@ -32,8 +32,10 @@
 #include "devices.h"
 #include "esc.h"
 #include "log.h"
+#include "mathpack.h"
 #include "memory.h"
 #include "pbi.h"
+#include "rewind.h"
 #include "rtime.h"
 #include "sysrom.h"
 #ifdef XEP80_EMULATION
@@ -196,6 +198,9 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 			else if (strcmp(string, "ENABLE_SIO_PATCH") == 0) {
 				ESC_enable_sio_patch = Util_sscanbool(ptr);
 			}
+			else if (strcmp(string, "ENABLE_FP_PATCH") == 0) {
+				MATHPACK_enable_patch = Util_sscanbool(ptr);
+			}
 			else if (strcmp(string, "ENABLE_SLOW_XEX_LOADING") == 0) {
 				BINLOAD_slow_xex_loading = Util_sscanbool(ptr);
 			}
@@ -306,6 +311,10 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 			}
 			else if (RTIME_ReadConfig(string, ptr)) {
 			}
+#ifndef BASIC
+			else if (REWIND_ReadConfig(string, ptr)) {
+			}
+#endif
 #ifdef XEP80_EMULATION
 			else if (XEP80_ReadConfig(string, ptr)) {
 			}
@@ -429,6 +438,7 @@ int CFG_WriteConfig(void)
 
 	fprintf(fp, "DISABLE_BASIC=%d\n", Atari800_disable_basic);
 	fprintf(fp, "ENABLE_SIO_PATCH=%d\n", ESC_enable_sio_patch);
+	fprintf(fp, "ENABLE_FP_PATCH=%d\n", MATHPACK_enable_patch);
 	fprintf(fp, "ENABLE_SLOW_XEX_LOADING=%d\n", BINLOAD_slow_xex_loading);
 	fprintf(fp, "ENABLE_H_PATCH=%d\n", Devices_enable_h_patch);
 	fprintf(fp, "ENABLE_P_PATCH=%d\n", Devices_enable_p_patch);
@@ -460,6 +470,9 @@ int CFG_WriteConfig(void)
 	CARTRIDGE_WriteConfig(fp);
 	CASSETTE_WriteConfig(fp);
 	RTIME_WriteConfig(fp);
+#ifndef BASIC
+	REWIND_WriteConfig(fp);
+#endif
 #ifdef XEP80_EMULATION
 	XEP80_WriteConfig(fp);
 #endif
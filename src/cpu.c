@@ -27,6 +27,8 @@
 	=====================
 
 	Define CPU65C02 if you don't want 6502 JMP() bug emulation.
+	Define CPU_BLOCK_CACHE to execute code from a cache of predecoded blocks.
+	Define CPU_JIT to translate hot code to x86-64 code (needs CPU_BLOCK_CACHE).
 	Define CYCLES_PER_OPCODE to update ANTIC_xpos in each opcode's emulation.
 	Define MONITOR_BREAK if you want code breakpoints and execution history.
 	Define MONITOR_BREAKPOINTS if you want user-defined breakpoints.
@@ -58,6 +60,7 @@
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>	/* exit() */
+#include <string.h>	/* memchr(), memcmp(), memcpy() */
 
 #include "cpu.h"
 #ifdef ASAP /* external project, see http://asap.sf.net */
@@ -79,6 +82,9 @@
 #ifdef LIBATARI800
 #include "libatari800/cpu_crash.h"
 #endif
+#ifdef CPU_JIT
+#include "cpu_jit.h"
+#endif
 
 /* For Atari Basic loader */
 void (*CPU_rts_handler)(void) = NULL;
@@ -104,6 +110,10 @@ unsigned int CPU_remember_jmp_curpos = 0;
 UBYTE CPU_cim_encountered = FALSE;
 UBYTE CPU_IRQ;
 
+int CPU_idle_skip = FALSE;
+ULONG CPU_idle_cycles = 0;
+int CPU_fast_loops = TRUE;
+
 #ifndef FALCON_CPUASM
 /* Windows headers define it */
 #undef ABSOLUTE
@@ -124,10 +134,17 @@ UBYTE CPU_IRQ;
 /* If PREFETCH_CODE is defined, 2 bytes after the opcode are always fetched. */
 /* #define PREFETCH_CODE */
 
+/* With user-defined breakpoints, profiling or tracing compiled in, CPU_GO()
+   runs an instance of the main loop without them until the monitor
+   switches one of them on. */
+#if defined(MONITOR_BREAKPOINTS) || defined(MONITOR_PROFILE) || defined(MONITOR_TRACE)
+#define CPU_GO_VARIANTS
+#endif
+
 
 /* 6502 stack handling */
 #define PL                  MEMORY_dGetByte(0x0100 + ++S)
-#define PH(x)               MEMORY_dPutByte(0x0100 + S--, x)
+#define PH(x)               MEMORY_dPushByte(S--, x)
 #define PHW(x)              PH((x) >> 8); PH((x) & 0xff)
 
 /* 6502 code fetching */
@@ -234,6 +251,9 @@ void CPU_PutStatus(void)
 #if defined(WORDS_BIGENDIAN) || !defined(WORDS_UNALIGNED_OK)
 #warning PREFETCH_CODE is efficient only on little-endian machines with WORDS_UNALIGNED_OK
 #endif
+#endif
+#if defined(PREFETCH_CODE) || defined(CPU_BLOCK_CACHE)
+/* addr holds the 2 bytes after the opcode */
 #define OP_BYTE     ((UBYTE) addr)
 #define OP_WORD     addr
 #define IMMEDIATE   (PC++, (UBYTE) addr)
@@ -245,7 +265,7 @@ void CPU_PutStatus(void)
 #define INDIRECT_Y  PC++; addr &= 0xff; addr = zGetWord(addr) + Y
 #define ZPAGE_X     PC++; addr = (UBYTE) (addr + X)
 #define ZPAGE_Y     PC++; addr = (UBYTE) (addr + Y)
-#else /* PREFETCH_CODE */
+#else /* defined(PREFETCH_CODE) || defined(CPU_BLOCK_CACHE) */
 #define OP_BYTE     PEEK_CODE_BYTE()
 #define OP_WORD     PEEK_CODE_WORD()
 #define IMMEDIATE   GET_CODE_BYTE()
@@ -257,7 +277,7 @@ void CPU_PutStatus(void)
 #define INDIRECT_Y  addr = GET_CODE_BYTE(); addr = zGetWord(addr) + Y
 #define ZPAGE_X     addr = (UBYTE) (GET_CODE_BYTE() + X)
 #define ZPAGE_Y     addr = (UBYTE) (GET_CODE_BYTE() + Y)
-#endif /* PREFETCH_CODE */
+#endif /* defined(PREFETCH_CODE) || defined(CPU_BLOCK_CACHE) */
 
 /* Instructions */
 #define AND(t_data) Z = N = A &= t_data
@@ -302,6 +322,7 @@ void CPU_PutStatus(void)
 		if ((addr ^ GET_PC()) & 0xff00) \
 			ANTIC_xpos++; \
 		ANTIC_xpos++; \
+		CHECK_IDLE_LOOP(addr); \
 		SET_PC(addr); \
 		DONE \
 	} \
@@ -309,6 +330,16 @@ void CPU_PutStatus(void)
 	DONE
 #endif
 
+/* Idle loops: with CPU_idle_skip, a backward jump is followed by
+   a check whether the loop it closes is waiting for something that
+   cannot happen before the end of the current CPU_GO() call.
+   With CPU_fast_loops, it is also checked whether the loop just copies
+   or fills memory, so that its iterations can be run in C.
+   CHECK_IDLE_LOOP is defined in cpu_go.h. */
+#ifndef ASAP
+#define IDLE_LOOPS
+#endif
+
 /* 1 extra cycle for X (or Y) index overflow */
 #define NCYCLES_X   if ((UBYTE) addr < X) ANTIC_xpos++
 #define NCYCLES_Y   if ((UBYTE) addr < Y) ANTIC_xpos++
@@ -350,11 +381,12 @@ void CPU_NMI(void)
 	CPU_GetStatus(); \
 	ENTER_MONITOR; \
 	CPU_PutStatus(); \
-	UPDATE_LOCAL_REGS;
+	UPDATE_LOCAL_REGS; \
+	LEAVE_IF_DEBUGGING
 
 
 /*	0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
-static const int cycles[256] =
+static const UBYTE cycles[256] =
 {
 	7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6,		/* 0x */
 	2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7,		/* 1x */
@@ -377,2057 +409,810 @@ static const int cycles[256] =
 	2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7		/* Fx */
 };
 
-/* 6502 emulation routine */
-#ifndef NO_GOTO
-__extension__ /* suppress -ansi -pedantic warnings */
-#endif
-void CPU_GO(int limit)
-{
-#ifdef NO_GOTO
-#define OPCODE_ALIAS(code)	case 0x##code:
-#define DONE				break;
-#else
-#define OPCODE_ALIAS(code)	opcode_##code:
-#define DONE				goto next;
-	static const void *opcode[256] =
-	{
-		&&opcode_00, &&opcode_01, &&opcode_02, &&opcode_03,
-		&&opcode_04, &&opcode_05, &&opcode_06, &&opcode_07,
-		&&opcode_08, &&opcode_09, &&opcode_0a, &&opcode_0b,
-		&&opcode_0c, &&opcode_0d, &&opcode_0e, &&opcode_0f,
-
-		&&opcode_10, &&opcode_11, &&opcode_12, &&opcode_13,
-		&&opcode_14, &&opcode_15, &&opcode_16, &&opcode_17,
-		&&opcode_18, &&opcode_19, &&opcode_1a, &&opcode_1b,
-		&&opcode_1c, &&opcode_1d, &&opcode_1e, &&opcode_1f,
-
-		&&opcode_20, &&opcode_21, &&opcode_22, &&opcode_23,
-		&&opcode_24, &&opcode_25, &&opcode_26, &&opcode_27,
-		&&opcode_28, &&opcode_29, &&opcode_2a, &&opcode_2b,
-		&&opcode_2c, &&opcode_2d, &&opcode_2e, &&opcode_2f,
-
-		&&opcode_30, &&opcode_31, &&opcode_32, &&opcode_33,
-		&&opcode_34, &&opcode_35, &&opcode_36, &&opcode_37,
-		&&opcode_38, &&opcode_39, &&opcode_3a, &&opcode_3b,
-		&&opcode_3c, &&opcode_3d, &&opcode_3e, &&opcode_3f,
-
-		&&opcode_40, &&opcode_41, &&opcode_42, &&opcode_43,
-		&&opcode_44, &&opcode_45, &&opcode_46, &&opcode_47,
-		&&opcode_48, &&opcode_49, &&opcode_4a, &&opcode_4b,
-		&&opcode_4c, &&opcode_4d, &&opcode_4e, &&opcode_4f,
-
-		&&opcode_50, &&opcode_51, &&opcode_52, &&opcode_53,
-		&&opcode_54, &&opcode_55, &&opcode_56, &&opcode_57,
-		&&opcode_58, &&opcode_59, &&opcode_5a, &&opcode_5b,
-		&&opcode_5c, &&opcode_5d, &&opcode_5e, &&opcode_5f,
-
-		&&opcode_60, &&opcode_61, &&opcode_62, &&opcode_63,
-		&&opcode_64, &&opcode_65, &&opcode_66, &&opcode_67,
-		&&opcode_68, &&opcode_69, &&opcode_6a, &&opcode_6b,
-		&&opcode_6c, &&opcode_6d, &&opcode_6e, &&opcode_6f,
-
-		&&opcode_70, &&opcode_71, &&opcode_72, &&opcode_73,
-		&&opcode_74, &&opcode_75, &&opcode_76, &&opcode_77,
-		&&opcode_78, &&opcode_79, &&opcode_7a, &&opcode_7b,
-		&&opcode_7c, &&opcode_7d, &&opcode_7e, &&opcode_7f,
-
-		&&opcode_80, &&opcode_81, &&opcode_82, &&opcode_83,
-		&&opcode_84, &&opcode_85, &&opcode_86, &&opcode_87,
-		&&opcode_88, &&opcode_89, &&opcode_8a, &&opcode_8b,
-		&&opcode_8c, &&opcode_8d, &&opcode_8e, &&opcode_8f,
-
-		&&opcode_90, &&opcode_91, &&opcode_92, &&opcode_93,
-		&&opcode_94, &&opcode_95, &&opcode_96, &&opcode_97,
-		&&opcode_98, &&opcode_99, &&opcode_9a, &&opcode_9b,
-		&&opcode_9c, &&opcode_9d, &&opcode_9e, &&opcode_9f,
-
-		&&opcode_a0, &&opcode_a1, &&opcode_a2, &&opcode_a3,
-		&&opcode_a4, &&opcode_a5, &&opcode_a6, &&opcode_a7,
-		&&opcode_a8, &&opcode_a9, &&opcode_aa, &&opcode_ab,
-		&&opcode_ac, &&opcode_ad, &&opcode_ae, &&opcode_af,
-
-		&&opcode_b0, &&opcode_b1, &&opcode_b2, &&opcode_b3,
-		&&opcode_b4, &&opcode_b5, &&opcode_b6, &&opcode_b7,
-		&&opcode_b8, &&opcode_b9, &&opcode_ba, &&opcode_bb,
-		&&opcode_bc, &&opcode_bd, &&opcode_be, &&opcode_bf,
-
-		&&opcode_c0, &&opcode_c1, &&opcode_c2, &&opcode_c3,
-		&&opcode_c4, &&opcode_c5, &&opcode_c6, &&opcode_c7,
-		&&opcode_c8, &&opcode_c9, &&opcode_ca, &&opcode_cb,
-		&&opcode_cc, &&opcode_cd, &&opcode_ce, &&opcode_cf,
-
-		&&opcode_d0, &&opcode_d1, &&opcode_d2, &&opcode_d3,
-		&&opcode_d4, &&opcode_d5, &&opcode_d6, &&opcode_d7,
-		&&opcode_d8, &&opcode_d9, &&opcode_da, &&opcode_db,
-		&&opcode_dc, &&opcode_dd, &&opcode_de, &&opcode_df,
-
-		&&opcode_e0, &&opcode_e1, &&opcode_e2, &&opcode_e3,
-		&&opcode_e4, &&opcode_e5, &&opcode_e6, &&opcode_e7,
-		&&opcode_e8, &&opcode_e9, &&opcode_ea, &&opcode_eb,
-		&&opcode_ec, &&opcode_ed, &&opcode_ee, &&opcode_ef,
-
-		&&opcode_f0, &&opcode_f1, &&opcode_f2, &&opcode_f3,
-		&&opcode_f4, &&opcode_f5, &&opcode_f6, &&opcode_f7,
-		&&opcode_f8, &&opcode_f9, &&opcode_fa, &&opcode_fb,
-		&&opcode_fc, &&opcode_fd, &&opcode_fe, &&opcode_ff,
-	};
-#endif	/* NO_GOTO */
+#ifdef CPU_BLOCK_CACHE
+
+/* Predecoded code.
+   Straight-line code is decoded into blocks of instructions with their
+   operands and cycle counts, which CPU_GO() runs without fetching and
+   decoding each opcode again. A block ends at an instruction that always
+   transfers control (BRK, JSR, RTI, JMP, RTS, ESC, CIM), before an
+   instruction that crosses the end of the page or after BLOCK_MAX_INSNS
+   instructions; conditional branches continue the block. CPU_GO() leaves a
+   block as soon as PC differs from the address of its next instruction.
+
+   CPU_code flags every byte of a cached instruction. Writing to such a byte
+   (through the MEMORY_ macros) drops all the blocks in the page, and so do
+   bank switches and other copies to memory in pages with cached code.
+   Pages where the CPU keeps modifying cached code are interpreted the
+   usual way. The stack page and the hardware area are never cached. */
+
+#define BLOCK_MAX_INSNS    32
+#define ARENA_SIZE         65536
+#define MAX_INVALIDATIONS  32
+
+typedef struct {
+	const void *handler;	/* opcode label in CPU_GO(), NULL with NO_GOTO */
+	int pc;					/* address of the instruction, -1 at the end of the block */
+	UWORD operand;			/* the 2 bytes after the opcode */
+	UBYTE op;
+	UBYTE cycles;
+} predecoded_t;
 
 #ifdef CYCLES_PER_OPCODE
-#define OPCODE(code) OPCODE_ALIAS(code) ANTIC_xpos += cycles[0x##code];
-#else
-#define OPCODE(code) OPCODE_ALIAS(code)
-#endif
-
-#ifdef PC_PTR
-	const UBYTE *PC;
+#define BLOCK_CYCLES
 #else
-	UWORD PC;
+#define BLOCK_CYCLES  ANTIC_xpos += ip->cycles
 #endif
-	UBYTE A;
-	UBYTE X;
-	UBYTE Y;
-	UBYTE S;
 
-	UWORD addr;
-	UBYTE data;
-#define insn data
+UBYTE CPU_code[65536];
+UBYTE CPU_code_page[256];
 
-#else /* FALCON_CPUASM */
+/*	0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F */
+static const UBYTE insn_length[256] =
+{
+	1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* 0x */
+	2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* 1x */
+	3, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* 2x */
+	2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* 3x */
+
+	1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* 4x */
+	2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* 5x */
+	1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* 6x */
+	2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* 7x */
+
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* 8x */
+	2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* 9x */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* Ax */
+	2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* Bx */
+
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* Cx */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,		/* Dx */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,		/* Ex */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3		/* Fx */
+};
 
-#if defined(PAGED_MEM) || defined(PAGED_ATTRIB)
-#error cpu_m68k.asm cannot work with paged memory/attributes
-#endif
+/* Index in arena of the block that starts at each address, 0 if none. */
+static int block_index[65536];
+static predecoded_t arena[ARENA_SIZE];
+static int arena_used = 1;	/* arena[0] is an empty block */
+/* Next instruction to run, kept between the calls to CPU_GO(). */
+static const predecoded_t *next_insn = arena;
+static UBYTE invalidations[256];
 
-#if defined(MONITOR_BREAKPOINTS)
-#error cpu_m68k.asm does not support user-defined breakpoints
+static void drop_page(int page)
+{
+	int addr;
+	for (addr = page << 8; addr < (page + 1) << 8; addr++) {
+		int i = block_index[addr];
+		if (i != 0) {
+			block_index[addr] = 0;
+			for (; arena[i].pc >= 0; i++)
+				arena[i].pc = -1;
+		}
+	}
+	memset(CPU_code + (page << 8), 0, 0x100);
+	CPU_code_page[page] = 0;
+#ifdef CPU_JIT
+	JIT_InvalidatePage(page);
 #endif
+}
 
-#if defined(MONITOR_TRACE)
-#error cpu_m68k.asm does not support disassembling the code while it is executed
-#endif
+void CPU_InvalidateCode(int page, int code_modified)
+{
+	drop_page(page);
+	if (code_modified && invalidations[page] < MAX_INVALIDATIONS)
+		invalidations[page]++;
+}
 
-#if defined(CYCLES_PER_OPCODE)
-#warning per opcode cycles update has no effect in cpu_m68k.asm
+static void drop_all(void)
+{
+	int i;
+	for (i = 0; i < arena_used; i++)
+		arena[i].pc = -1;
+	arena_used = 1;
+	next_insn = arena;
+	memset(block_index, 0, sizeof(block_index));
+	memset(CPU_code, 0, sizeof(CPU_code));
+	memset(CPU_code_page, 0, sizeof(CPU_code_page));
+#ifdef CPU_JIT
+	JIT_Flush();
 #endif
+}
 
-#define UPDATE_GLOBAL_REGS
-#define UPDATE_LOCAL_REGS
-
-#define PH(x)  MEMORY_dPutByte(0x0100 + S--, x)
-#define PHW(x) PH((x) >> 8); PH((x) & 0xff)
-#define INTERRUPT(address)  \
-	UBYTE S = CPU_regS;     \
-	PHW(CPU_regPC);         \
-	PH(CPU_regP & 0xef);	\
-	CPU_SetI;               \
-	CPU_regPC = MEMORY_dGetWordAligned(address); \
-	CPU_regS = S;           \
-	ANTIC_xpos += 7;        \
-	INC_RET_NESTING;
-
-void CPU_NMI(void)
+void CPU_FlushCode(void)
 {
-	INTERRUPT(0xfffa);
+	drop_all();
+	memset(invalidations, 0, sizeof(invalidations));
 }
 
-#define CPUCHECKIRQ \
-	if (CPU_IRQ && !(CPU_regP & CPU_I_FLAG) && ANTIC_xpos < ANTIC_xpos_limit) { \
-		INTERRUPT(0xfffe); \
+/* Instructions that always transfer control: BRK, JSR, RTI, JMP, RTS,
+   ESCRTS, ESC and CIM. */
+static int ends_block(UBYTE insn)
+{
+	switch (insn) {
+	case 0x00: case 0x20: case 0x40: case 0x4c: case 0x60: case 0x6c:
+	case 0xd2: case 0xf2:
+	case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52:
+	case 0x62: case 0x72: case 0x92: case 0xb2:
+		return TRUE;
+	default:
+		return FALSE;
 	}
+}
 
-void CPU_GO(int limit)
+/* Decodes a block that starts at PC. Returns the empty block if the code at
+   PC is not to be cached. */
+static const predecoded_t *decode_block(UWORD pc, const void * const *handlers)
 {
-#endif /* FALCON_CPUASM */
-
-/*
-   This used to be in the main loop but has been removed to improve
-   execution speed. It does not seem to have any adverse effect on
-   the emulation for two reasons:
-
-   1. NMI's will can only be raised in antic.c - there is
-      no way an NMI can be generated whilst in this routine.
-
-   2. The timing of the IRQs are not that critical. */
-
-	if (ANTIC_wsync_halt) {
-
-#ifdef NEW_CYCLE_EXACT
-		if (ANTIC_DRAWING_SCREEN) {
-/* if ANTIC_WSYNC_C is a stolen cycle, ANTIC_antic2cpu_ptr will convert that to the nearest
-   cpu cycle before that cycle.  The CPU will see this cycle, if WSYNC is not
-   delayed. (Actually this cycle is the first cycle of the instruction after
-   STA WSYNC, which was really executed one cycle after STA WSYNC because
-   of an internal antic delay ).   ANTIC_delayed_wsync is added to this cycle to form
-   the limit in the case that WSYNC is not early (does not allow this extra cycle) */
-
-			if (limit < ANTIC_antic2cpu_ptr[ANTIC_WSYNC_C] + ANTIC_delayed_wsync)
-				return;
-			ANTIC_xpos = ANTIC_antic2cpu_ptr[ANTIC_WSYNC_C] + ANTIC_delayed_wsync;
-		}
-		else {
-			if (limit < (ANTIC_WSYNC_C + ANTIC_delayed_wsync))
-				return;
-			ANTIC_xpos = ANTIC_WSYNC_C;
-		}
-		ANTIC_delayed_wsync = 0;
-
-#else /* NEW_CYCLE_EXACT */
-
-		if (limit < ANTIC_WSYNC_C)
-			return;
-		ANTIC_xpos = ANTIC_WSYNC_C;
-
-#endif /* NEW_CYCLE_EXACT */
-
-		ANTIC_wsync_halt = 0;
+	int page = pc >> 8;
+	int start;
+	predecoded_t *p;
+	int n;
+
+	if (page == 0x01 || (page >= 0xd0 && page <= 0xd7) || invalidations[page] >= MAX_INVALIDATIONS)
+		return arena;
+	if (arena_used + BLOCK_MAX_INSNS + 1 > ARENA_SIZE)
+		drop_all();
+	start = arena_used;
+	p = arena + start;
+	for (n = 0; n < BLOCK_MAX_INSNS; n++) {
+		UBYTE insn = MEMORY_dGetByte(pc);
+		int len = insn_length[insn];
+		if ((pc & 0xff) + len > 0x100)
+			break;
+		p->handler = handlers != NULL ? handlers[insn] : NULL;
+		p->pc = pc;
+		p->operand = MEMORY_dGetByte((UWORD) (pc + 1)) + (MEMORY_dGetByte((UWORD) (pc + 2)) << 8);
+		p->op = insn;
+		p->cycles = (UBYTE) cycles[insn];
+		memset(CPU_code + pc, 1, len);
+		p++;
+		pc += len;
+		if ((pc & 0xff) == 0 || ends_block(insn))
+			break;
 	}
-	ANTIC_xpos_limit = limit;			/* needed for WSYNC store inside ANTIC */
-
-	UPDATE_LOCAL_REGS;
+	if (p == arena + start)
+		return arena;
+	p->pc = -1;
+	arena_used = p + 1 - arena;
+	block_index[arena[start].pc] = start;
+	CPU_code_page[page] = 1;
+	return arena + start;
+}
 
-	CPUCHECKIRQ;
+#endif /* CPU_BLOCK_CACHE */
 
-#ifndef FALCON_CPUASM
-	while (ANTIC_xpos < ANTIC_xpos_limit) {
-#ifdef MONITOR_PROFILE
-		int old_xpos = ANTIC_xpos;
-		UWORD old_PC = GET_PC();
+#ifdef CPU_JIT
+#ifdef NO_V_FLAG_VARIABLE
+#error CPU_JIT needs the V flag variable
 #endif
-
-
-#ifdef MONITOR_BREAKPOINTS
-	breakpoint_return:
+/* Transfer the 6502 state between CPU_GO() and translated code */
+#define JIT_SAVE_STATE(st) \
+	((st).pc = GET_PC(), (st).a = A, (st).x = X, (st).y = Y, (st).s = S, \
+	 (st).n = N, (st).z = Z, (st).c = C, (st).v = V, (st).p = CPU_regP, \
+	 (st).xpos = ANTIC_xpos, (st).xpos_limit = ANTIC_xpos_limit)
+#define JIT_LOAD_STATE(st) \
+	(SET_PC((st).pc), A = (st).a, X = (st).x, Y = (st).y, S = (st).s, \
+	 N = (st).n, Z = (st).z, C = (st).c, V = (st).v, CPU_regP = (st).p, \
+	 ANTIC_xpos = (st).xpos)
+#endif /* CPU_JIT */
+
+#ifdef IDLE_LOOPS
+
+/* Maximum number of instructions in an idle loop */
+#define IDLE_MAX_INSNS  16
+
+/* The state at the last backward jump */
+static struct {
+	int pc;
+	UBYTE a;
+	UBYTE x;
+	UBYTE y;
+	UBYTE s;
+	UBYTE n;
+	UBYTE z;
+	UBYTE c;
+#ifndef NO_V_FLAG_VARIABLE
+	UBYTE v;
 #endif
+} idle_last = { -1 };
 
-#ifdef PC_PTR
-		/* must handle 64k wrapping */
-		if (PC >= MEMORY_mem + 0xfffe) {
-			if (PC >= MEMORY_mem + 0x10000)
-				PC -= 0x10000;
-			else {
-				/* the opcode is before 0x10000, but the operand is past */
-#ifdef WORDS_UNALIGNED_OK
-				*(UWORD *) (MEMORY_mem + 0x10000) = *(UWORD *) MEMORY_mem;
-#else
-				MEMORY_mem[0x10000] = MEMORY_mem[0];
-				MEMORY_mem[0x10001] = MEMORY_mem[1];
-#endif /* WORDS_UNALIGNED_OK */
-			}
-		}
-#endif /* PC_PTR */
-
-#ifdef MONITOR_TRACE
-		if (MONITOR_trace_file != NULL) {
-			MONITOR_ShowState(MONITOR_trace_file, GET_PC(), A, X, Y, S,
-				(N & 0x80) ? 'N' : '-',
-#ifndef NO_V_FLAG_VARIABLE
-				V ? 'V' : '-',
+/* Reads memory for idle_loop_cycles(). Returns -1 for hardware registers
+   that can change or have side effects. VCOUNT only changes at the end of
+   the scanline, so it is allowed and *vcount is set. */
+static int idle_read(UWORD addr, int *vcount)
+{
+#ifndef PAGED_ATTRIB
+	if (MEMORY_attrib[addr] != MEMORY_HARDWARE)
 #else
-				(CPU_regP & CPU_V_FLAG) ? 'V' : '-',
-#endif
-				(Z == 0) ? 'Z' : '-',
-				(C != 0) ? 'C' : '-');
-		}
+	if (MEMORY_readmap[addr >> 8] == NULL)
 #endif
-
-#ifdef MONITOR_BREAK
-		CPU_remember_PC[CPU_remember_PC_curpos] = GET_PC();
-		CPU_remember_op[CPU_remember_PC_curpos][0] = MEMORY_dGetByte(GET_PC());
-		CPU_remember_op[CPU_remember_PC_curpos][1] = MEMORY_dGetByte(GET_PC()+1);
-		CPU_remember_op[CPU_remember_PC_curpos][2] = MEMORY_dGetByte(GET_PC()+2);
-#ifdef NEW_CYCLE_EXACT
-		if (ANTIC_DRAWING_SCREEN)
-			CPU_remember_xpos[CPU_remember_PC_curpos] = ANTIC_cpu2antic_ptr[ANTIC_xpos] + (ANTIC_ypos << 8);
-		else
+		return MEMORY_dGetByte(addr);
+#ifndef NEW_CYCLE_EXACT
+	if ((addr & 0xff0f) == 0xd40b) {
+		*vcount = TRUE;
+		return ANTIC_GetByte(addr, TRUE);
+	}
 #endif
-			CPU_remember_xpos[CPU_remember_PC_curpos] = ANTIC_xpos + (ANTIC_ypos << 8);
-		CPU_remember_PC_curpos = (CPU_remember_PC_curpos + 1) % CPU_REMEMBER_PC_STEPS;
-
-		if (MONITOR_break_addr == GET_PC() || ANTIC_break_ypos == ANTIC_ypos) {
-			DO_BREAK;
-		}
-#endif /* MONITOR_BREAK */
+	return -1;
+}
 
-#if defined(WRAP_64K) && !defined(PC_PTR)
-		MEMORY_mem[0x10000] = MEMORY_mem[0];
+/* Follows the loop starting at PC with the given registers and the flags
+   in N, Z, C and V. If it only reads memory, and returns to PC with the same
+   registers and flags, no iteration can end differently before an interrupt
+   or a hardware register access of some other code - that is, before the
+   end of the current CPU_GO() call. Returns the number of cycles of one
+   iteration, or 0 if it is not such an idle loop. */
+static int idle_loop_cycles(UWORD pc, UBYTE a0, UBYTE x0, UBYTE y0, UBYTE s, int *vcount)
+{
+	UWORD start = pc;
+	UBYTE a = a0;
+	UBYTE x = x0;
+	UBYTE y = y0;
+	UBYTE n = N;
+	UBYTE z = Z;
+	UBYTE c = C;
+#ifndef NO_V_FLAG_VARIABLE
+	UBYTE v = V;
 #endif
+	int result = 0;
+	int i;
 
-		insn = GET_CODE_BYTE();
+	for (i = 0; i < IDLE_MAX_INSNS; i++) {
+		UBYTE insn = MEMORY_dGetByte(pc);
+		UWORD op = MEMORY_dGetByte((UWORD) (pc + 1)) + (MEMORY_dGetByte((UWORD) (pc + 2)) << 8);
+		UWORD addr;
+		int data;
 
-#ifdef MONITOR_BREAKPOINTS
 #ifdef MONITOR_BREAK
-		if (MONITOR_breakpoint_table_size > 0 && MONITOR_breakpoints_enabled && !MONITOR_break_step)
+		if (pc == MONITOR_break_addr)
+			return 0;
+#endif
+		result += cycles[insn];
+		/* addressing mode */
+		switch (insn) {
+		case 0x09: case 0x29: case 0x49: case 0xa0: case 0xa2: case 0xa9:
+		case 0xc0: case 0xc9: case 0xe0:
+			data = (UBYTE) op;
+			pc += 2;
+			break;
+		case 0x05: case 0x24: case 0x25: case 0x45: case 0xa4: case 0xa5:
+		case 0xa6: case 0xc4: case 0xc5: case 0xe4:
+			data = MEMORY_dGetByte(op & 0xff);
+			pc += 2;
+			break;
+		case 0x15: case 0x35: case 0x55: case 0xb4: case 0xb5: case 0xd5:
+			data = MEMORY_dGetByte((UBYTE) (op + x));
+			pc += 2;
+			break;
+		case 0xb6:
+			data = idle_read((UBYTE) (op + y), vcount);
+			pc += 2;
+			break;
+		case 0x0d: case 0x2c: case 0x2d: case 0x4d: case 0xac: case 0xad:
+		case 0xae: case 0xcc: case 0xcd: case 0xec:
+			data = idle_read(op, vcount);
+			pc += 3;
+			break;
+		case 0x1d: case 0x3d: case 0x5d: case 0xbc: case 0xbd: case 0xdd:
+			addr = op + x;
+			if ((UBYTE) addr < x)
+				result++;
+			data = idle_read(addr, vcount);
+			pc += 3;
+			break;
+		case 0x19: case 0x39: case 0x59: case 0xb9: case 0xbe: case 0xd9:
+			addr = op + y;
+			if ((UBYTE) addr < y)
+				result++;
+			data = idle_read(addr, vcount);
+			pc += 3;
+			break;
+		case 0x11: case 0x31: case 0x51: case 0xb1: case 0xd1:
+			addr = zGetWord(op & 0xff) + y;
+			if ((UBYTE) addr < y)
+				result++;
+			data = idle_read(addr, vcount);
+			pc += 2;
+			break;
+		case 0x18: case 0x38: case 0x88: case 0x8a: case 0x98: case 0xa8:
+		case 0xaa: case 0xba: case 0xc8: case 0xca: case 0xe8: case 0xea:
+#ifndef NO_V_FLAG_VARIABLE
+		case 0xb8:
+#endif
+			data = 0;
+			pc++;
+			break;
+		case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xb0:
+		case 0xd0: case 0xf0:
+			data = (UBYTE) op;
+			pc += 2;
+			break;
+		case 0x4c:
+			data = 0;
+			break;
+		default:
+			return 0;
+		}
+		if (data < 0)
+			return 0;
+		/* operation */
+		switch (insn) {
+		case 0x09: case 0x05: case 0x15: case 0x0d: case 0x1d: case 0x19: case 0x11:
+			z = n = a |= data;
+			break;
+		case 0x29: case 0x25: case 0x35: case 0x2d: case 0x3d: case 0x39: case 0x31:
+			z = n = a &= data;
+			break;
+		case 0x49: case 0x45: case 0x55: case 0x4d: case 0x5d: case 0x59: case 0x51:
+			z = n = a ^= data;
+			break;
+		case 0xa9: case 0xa5: case 0xb5: case 0xad: case 0xbd: case 0xb9: case 0xb1:
+			z = n = a = data;
+			break;
+		case 0xa2: case 0xa6: case 0xb6: case 0xae: case 0xbe:
+			z = n = x = data;
+			break;
+		case 0xa0: case 0xa4: case 0xb4: case 0xac: case 0xbc:
+			z = n = y = data;
+			break;
+		case 0xc9: case 0xc5: case 0xd5: case 0xcd: case 0xdd: case 0xd9: case 0xd1:
+			z = n = a - data;
+			c = (a >= data);
+			break;
+		case 0xe0: case 0xe4: case 0xec:
+			z = n = x - data;
+			c = (x >= data);
+			break;
+		case 0xc0: case 0xc4: case 0xcc:
+			z = n = y - data;
+			c = (y >= data);
+			break;
+		case 0x24: case 0x2c:
+#ifndef NO_V_FLAG_VARIABLE
+			n = data;
+			v = data & 0x40;
+			z = a & data;
+			break;
 #else
-		if (MONITOR_breakpoint_table_size > 0 && MONITOR_breakpoints_enabled)
+			return 0;
 #endif
-		{
-			UBYTE optype = MONITOR_optype6502[insn];
-			int i;
-			switch (optype >> 4) {
-			case 1:
-				addr = PEEK_CODE_WORD();
-				break;
-			case 2:
-				addr = PEEK_CODE_BYTE();
-				break;
-			case 3:
-				addr = PEEK_CODE_WORD() + X;
-				break;
-			case 4:
-				addr = PEEK_CODE_WORD() + Y;
-				break;
-			case 5:
-				addr = (UBYTE) (PEEK_CODE_BYTE() + X);
-				addr = zGetWord(addr);
-				break;
-			case 6:
-				addr = PEEK_CODE_BYTE();
-				addr = zGetWord(addr) + Y;
-				break;
-			case 7:
-				addr = (UBYTE) (PEEK_CODE_BYTE() + X);
-				break;
-			case 8:
-				addr = (UBYTE) (PEEK_CODE_BYTE() + Y);
-				break;
-			/* XXX: case 13 */
-			default:
-				addr = 0;
-				break;
-			}
-			for (i = 0; i < MONITOR_breakpoint_table_size; i++) {
-				int cond;
-				int value, m_addr;
-				if (!MONITOR_breakpoint_table[i].enabled)
-					continue; /* skip */
-				cond = MONITOR_breakpoint_table[i].condition;
-				if (cond == MONITOR_BREAKPOINT_OR)
-					break; /* fire */
-				value = MONITOR_breakpoint_table[i].value;
-				m_addr = MONITOR_breakpoint_table[i].m_addr;
-				if (cond == MONITOR_BREAKPOINT_FLAG_CLEAR) {
-					switch (value) {
-					case CPU_N_FLAG:
-						if ((N & 0x80) == 0)
-							continue;
-						break;
+		case 0x18:
+			c = 0;
+			break;
+		case 0x38:
+			c = 1;
+			break;
 #ifndef NO_V_FLAG_VARIABLE
-					case CPU_V_FLAG:
-						if (V == 0)
-							continue;
-						break;
+		case 0xb8:
+			v = 0;
+			break;
 #endif
-					case CPU_Z_FLAG:
-						if (Z != 0)
-							continue;
-						break;
-					case CPU_C_FLAG:
-						if (C == 0)
-							continue;
-						break;
-					default:
-						if ((CPU_regP & value) == 0)
-							continue;
-						break;
-					}
-				}
-				else if (cond == MONITOR_BREAKPOINT_FLAG_SET) {
-					switch (value) {
-					case CPU_N_FLAG:
-						if ((N & 0x80) != 0)
-							continue;
-						break;
+		case 0xaa:
+			z = n = x = a;
+			break;
+		case 0xa8:
+			z = n = y = a;
+			break;
+		case 0x8a:
+			z = n = a = x;
+			break;
+		case 0x98:
+			z = n = a = y;
+			break;
+		case 0xba:
+			z = n = x = s;
+			break;
+		case 0xe8:
+			z = n = ++x;
+			break;
+		case 0xc8:
+			z = n = ++y;
+			break;
+		case 0xca:
+			z = n = --x;
+			break;
+		case 0x88:
+			z = n = --y;
+			break;
+		case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xb0:
+		case 0xd0: case 0xf0:
+			{
+				int taken;
+				switch (insn >> 6) {
+				case 0:
+					taken = n & 0x80;
+					break;
+				case 1:
 #ifndef NO_V_FLAG_VARIABLE
-					case CPU_V_FLAG:
-						if (V != 0)
-							continue;
-						break;
+					taken = v;
+#else
+					taken = CPU_regP & CPU_V_FLAG;
 #endif
-					case CPU_Z_FLAG:
-						if (Z == 0)
-							continue;
-						break;
-					case CPU_C_FLAG:
-						if (C != 0)
-							continue;
-						break;
-					default:
-						if ((CPU_regP & value) != 0)
-							continue;
-						break;
-					}
+					break;
+				case 2:
+					taken = c;
+					break;
+				default:
+					taken = z == 0;
+					break;
 				}
-				else {
-					int val;
-					switch (cond >> 3) {
-					case MONITOR_BREAKPOINT_PC >> 3:
-						val = GET_PC() - 1;
-						break;
-					case MONITOR_BREAKPOINT_A >> 3:
-						val = A;
-						break;
-					case MONITOR_BREAKPOINT_X >> 3:
-						val = X;
-						break;
-					case MONITOR_BREAKPOINT_Y >> 3:
-						val = Y;
-						break;
-					case MONITOR_BREAKPOINT_S >> 3:
-						val = S;
-						break;
-					case MONITOR_BREAKPOINT_READ >> 3:
-						if ((optype & 4) == 0)
-							goto cond_failed;
-						val = addr;
-						break;
-					case MONITOR_BREAKPOINT_WRITE >> 3:
-						if ((optype & 8) == 0)
-							goto cond_failed;
-						val = addr;
-						break;
-					case MONITOR_BREAKPOINT_ACCESS >> 3:
-						if ((optype & 12) == 0)
-							goto cond_failed;
-						val = addr;
-						break;
-					case MONITOR_BREAKPOINT_MEMORY >> 3:
-						val = MEMORY_SafeGetByte(m_addr);
-						break;
-					default:
-						/* shouldn't happen */
-						continue;
-					}
-					if ((cond & MONITOR_BREAKPOINT_LESS) != 0 && val < value)
-						continue;
-					if ((cond & MONITOR_BREAKPOINT_EQUAL) != 0 && val == value)
-						continue;
-					if ((cond & MONITOR_BREAKPOINT_GREATER) != 0 && val > value)
-						continue;
-				cond_failed:
-					;
+				if (insn & 0x20 ? taken : !taken) {
+					addr = pc + (SBYTE) data;
+					result += (addr ^ pc) & 0xff00 ? 2 : 1;
+					pc = addr;
 				}
-				/* a condition failed */
-				/* quickly skip AND-connected conditions */
-				do {
-					if (++i >= MONITOR_breakpoint_table_size)
-						goto no_breakpoint;
-				} while (MONITOR_breakpoint_table[i].condition != MONITOR_BREAKPOINT_OR || !MONITOR_breakpoint_table[i].enabled);
 			}
-			/* fire breakpoint */
-			PC--;
-			DO_BREAK;
-			goto breakpoint_return;
-		no_breakpoint:
-			;
+			break;
+		case 0x4c:
+			pc = op;
+			break;
+		default:
+			break;
 		}
-#endif /* MONITOR_BREAKPOINTS */
-
-#ifndef CYCLES_PER_OPCODE
-		ANTIC_xpos += cycles[insn];
-#endif
-
-#ifdef MONITOR_PROFILE
-		CPU_instruction_count[insn]++;
-		MONITOR_coverage[old_PC = PC - 1].count++;
-		MONITOR_coverage_insns++;
+		if (pc == start) {
+			if (a == a0 && x == x0 && y == y0 && n == N && z == Z && c == C
+#ifndef NO_V_FLAG_VARIABLE
+			 && v == V
 #endif
+			)
+				return result;
+			return 0;
+		}
+	}
+	return 0;
+}
 
-#ifdef PREFETCH_CODE
-		addr = PEEK_CODE_WORD();
+/* Maximum number of instructions before the index update in a copy loop */
+#define COPY_MAX_INSNS  8
+
+/* One bit for each address at which copy_decode() found no copy loop.
+   Cleared by CPU_Reset(). */
+static UBYTE copy_no_loop[65536 / 8];
+
+/* The last copy loop decoded by copy_decode() */
+static struct {
+	int start;
+	UWORD end;
+	UBYTE code[COPY_MAX_INSNS * 3 + 3];
+	int n_ops;
+	UBYTE ops[COPY_MAX_INSNS];
+	UWORD args[COPY_MAX_INSNS];
+	UBYTE update;
+	UBYTE branch;
+	int cycles;
+	int taken_cycles;
+} copy_last = { -1 };
+
+/* Returns TRUE if reading ADDR1..ADDR2 has no side effects. */
+static int copy_can_read(UWORD addr1, UWORD addr2)
+{
+#ifndef PAGED_ATTRIB
+	return memchr(MEMORY_attrib + addr1, MEMORY_HARDWARE, addr2 - addr1 + 1) == NULL;
+#else
+	return MEMORY_readmap[addr1 >> 8] == NULL && MEMORY_readmap[addr2 >> 8] == NULL;
 #endif
+}
 
-#ifdef NO_GOTO
-		switch (insn) {
+/* Returns TRUE if ADDR1..ADDR2 is plain RAM. */
+static int copy_can_write(UWORD addr1, UWORD addr2)
+{
+#ifndef PAGED_ATTRIB
+	int bad = 0;
+	int addr;
+	for (addr = addr1; addr <= addr2; addr++)
+		bad |= MEMORY_attrib[addr] ^ MEMORY_RAM;
+	return bad == 0;
 #else
-		goto *opcode[insn];
+	return MEMORY_writemap[addr1 >> 8] == NULL && MEMORY_writemap[addr2 >> 8] == NULL;
 #endif
+}
 
-	OPCODE(00)				/* BRK */
-#ifdef LIBATARI800
-#ifdef HAVE_SETJMP
-		if (!libatari800_continue_on_brk)
-			longjmp(libatari800_cpu_crash, LIBATARI800_BRK_INSTRUCTION);
-#endif /* HAVE_SETJMP */
-#else /* LIBATARI800 */
-#ifdef MONITOR_BREAK
-		if (MONITOR_break_brk) {
-			DO_BREAK;
-		}
-		else
-#endif /* MONITOR_BREAK */
-#endif /* LIBATARI800 */
-		{
-			PC++;
-			PHPC;
-			PHPB1;
-			CPU_SetI;
-			SET_PC(MEMORY_dGetWordAligned(0xfffe));
-			INC_RET_NESTING;
-		}
-		DONE
-
-	OPCODE(01)				/* ORA (ab,x) */
-		INDIRECT_X;
-		ORA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(03)				/* ASO (ab,x) [unofficial - ASL then ORA with Acc] */
-		INDIRECT_X;
-
-	aso:
-		RMW_GetByte(data, addr);
-		C = (data & 0x80) ? 1 : 0;
-		data <<= 1;
-		MEMORY_PutByte(addr, data);
-		Z = N = A |= data;
-		DONE
-
-	OPCODE_ALIAS(04)		/* NOP ab [unofficial - skip byte] */
-	OPCODE_ALIAS(44)
-	OPCODE(64)
-		PC++;
-		DONE
-
-	OPCODE_ALIAS(14)		/* NOP ab,x [unofficial - skip byte] */
-	OPCODE_ALIAS(34)
-	OPCODE_ALIAS(54)
-	OPCODE_ALIAS(74)
-	OPCODE_ALIAS(d4)
-	OPCODE(f4)
-		PC++;
-		DONE
-
-	OPCODE_ALIAS(80)		/* NOP #ab [unofficial - skip byte] */
-	OPCODE_ALIAS(82)
-	OPCODE_ALIAS(89)
-	OPCODE_ALIAS(c2)
-	OPCODE(e2)
-		PC++;
-		DONE
-
-	OPCODE(05)				/* ORA ab */
-		ZPAGE;
-		ORA(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(06)				/* ASL ab */
-		ZPAGE;
-		data = MEMORY_dGetByte(addr);
-		C = (data & 0x80) ? 1 : 0;
-		Z = N = data << 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(07)				/* ASO ab [unofficial - ASL then ORA with Acc] */
-		ZPAGE;
-
-	aso_zpage:
-		data = MEMORY_dGetByte(addr);
-		C = (data & 0x80) ? 1 : 0;
-		data <<= 1;
-		MEMORY_dPutByte(addr, data);
-		Z = N = A |= data;
-		DONE
-
-	OPCODE(08)				/* PHP */
-		PHPB1;
-		DONE
-
-	OPCODE(09)				/* ORA #ab */
-		ORA(IMMEDIATE);
-		DONE
-
-	OPCODE(0a)				/* ASL */
-		C = (A & 0x80) ? 1 : 0;
-		Z = N = A <<= 1;
-		DONE
-
-	OPCODE_ALIAS(0b)		/* ANC #ab [unofficial - AND then copy N to C (Fox) */
-	OPCODE(2b)
-		AND(IMMEDIATE);
-		C = N >= 0x80;
-		DONE
-
-	OPCODE(0c)				/* NOP abcd [unofficial - skip word] */
-		PC += 2;
-		DONE
-
-	OPCODE(0d)				/* ORA abcd */
-		ABSOLUTE;
-		ORA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(0e)				/* ASL abcd */
-		ABSOLUTE;
-		RMW_GetByte(data, addr);
-		C = (data & 0x80) ? 1 : 0;
-		Z = N = data << 1;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(0f)				/* ASO abcd [unofficial - ASL then ORA with Acc] */
-		ABSOLUTE;
-		goto aso;
-
-	OPCODE(10)				/* BPL */
-		BRANCH(!(N & 0x80))
-
-	OPCODE(11)				/* ORA (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		ORA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(13)				/* ASO (ab),y [unofficial - ASL then ORA with Acc] */
-		INDIRECT_Y;
-		goto aso;
-
-	OPCODE(15)				/* ORA ab,x */
-		ZPAGE_X;
-		ORA(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(16)				/* ASL ab,x */
-		ZPAGE_X;
-		data = MEMORY_dGetByte(addr);
-		C = (data & 0x80) ? 1 : 0;
-		Z = N = data << 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(17)				/* ASO ab,x [unofficial - ASL then ORA with Acc] */
-		ZPAGE_X;
-		goto aso_zpage;
-
-	OPCODE(18)				/* CLC */
-		C = 0;
-		DONE
-
-	OPCODE(19)				/* ORA abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		ORA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(1b)				/* ASO abcd,y [unofficial - ASL then ORA with Acc] */
-		ABSOLUTE_Y;
-		goto aso;
-
-	OPCODE_ALIAS(1c)		/* NOP abcd,x [unofficial - skip word] */
-	OPCODE_ALIAS(3c)
-	OPCODE_ALIAS(5c)
-	OPCODE_ALIAS(7c)
-	OPCODE_ALIAS(dc)
-	OPCODE(fc)
-		if (OP_BYTE + X >= 0x100)
-			ANTIC_xpos++;
-		PC += 2;
-		DONE
-
-	OPCODE(1d)				/* ORA abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		ORA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(1e)				/* ASL abcd,x */
-		ABSOLUTE_X;
-		RMW_GetByte(data, addr);
-		C = (data & 0x80) ? 1 : 0;
-		Z = N = data << 1;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(1f)				/* ASO abcd,x [unofficial - ASL then ORA with Acc] */
-		ABSOLUTE_X;
-		goto aso;
-
-	OPCODE(20)				/* JSR abcd */
-		{
-			UWORD retaddr = GET_PC() + 1;
-#ifdef MONITOR_BREAK
-			CPU_remember_JMP[CPU_remember_jmp_curpos] = GET_PC() - 1;
-			CPU_remember_jmp_curpos = (CPU_remember_jmp_curpos + 1) % CPU_REMEMBER_JMP_STEPS;
-			MONITOR_ret_nesting++;
+/* Marks ADDR1..ADDR2, at most 256 bytes, as written to. */
+static void copy_mark(int addr1, int addr2)
+{
+	MEMORY_dirty[addr1 >> 8] = MEMORY_dirty[addr2 >> 8] = MEMORY_DIRTY_ALL;
+#ifdef CPU_BLOCK_CACHE
+	for (; addr1 <= addr2; addr1++)
+		MEMORY_MARK_CODE(addr1);
 #endif
-			PHW(retaddr);
-		}
-		SET_PC(OP_WORD);
-		DONE
-
-	OPCODE(21)				/* AND (ab,x) */
-		INDIRECT_X;
-		AND(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(23)				/* RLA (ab,x) [unofficial - ROL Mem, then AND with A] */
-		INDIRECT_X;
-
-	rla:
-		RMW_GetByte(data, addr);
-		if (C) {
-			C = (data & 0x80) ? 1 : 0;
-			data = (data << 1) + 1;
-		}
-		else {
-			C = (data & 0x80) ? 1 : 0;
-			data = (data << 1);
-		}
-		MEMORY_PutByte(addr, data);
-		Z = N = A &= data;
-		DONE
+}
 
-	OPCODE(24)				/* BIT ab */
-		ZPAGE;
-		N = MEMORY_dGetByte(addr);
-#ifndef NO_V_FLAG_VARIABLE
-		V = N & 0x40;
-#else
-		CPU_regP = (CPU_regP & 0xbf) + (N & 0x40);
-#endif
-		Z = (A & N);
-		DONE
-
-	OPCODE(25)				/* AND ab */
-		ZPAGE;
-		AND(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(26)				/* ROL ab */
-		ZPAGE;
-		data = MEMORY_dGetByte(addr);
-		Z = N = (data << 1) + C;
-		C = (data & 0x80) ? 1 : 0;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(27)				/* RLA ab [unofficial - ROL Mem, then AND with A] */
-		ZPAGE;
-
-	rla_zpage:
-		data = MEMORY_dGetByte(addr);
-		if (C) {
-			C = (data & 0x80) ? 1 : 0;
-			data = (data << 1) + 1;
-		}
-		else {
-			C = (data & 0x80) ? 1 : 0;
-			data = (data << 1);
+/* Copy loops are loops like LDA (zp),Y / STA (zp),Y / INY / BNE or
+   STA abs,X / DEX / BNE that move or fill memory: loads of A, stores of A,
+   then INX, DEX, INY or DEY and BNE or BPL back to the start. Delay loops
+   (just DEX / BNE) are handled too. Decodes the loop at START into
+   copy_last and returns TRUE if it is a copy loop. */
+static int copy_decode(UWORD start)
+{
+	UWORD p = start;
+	int n_ops = 0;
+	int cyc = 0;
+	UBYTE insn;
+
+	copy_last.start = -1;
+	for (;;) {
+		insn = MEMORY_dGetByte(p);
+		if (insn == 0xe8 || insn == 0xca || insn == 0xc8 || insn == 0x88)
+			break;
+		if (n_ops == COPY_MAX_INSNS)
+			return FALSE;
+		switch (insn) {
+		case 0xa9: case 0xb1: case 0x91: case 0x95:
+			copy_last.args[n_ops] = MEMORY_dGetByte((UWORD) (p + 1));
+			p += 2;
+			break;
+		case 0xbd: case 0xb9: case 0x9d: case 0x99:
+			copy_last.args[n_ops] = MEMORY_dGetByte((UWORD) (p + 1)) + (MEMORY_dGetByte((UWORD) (p + 2)) << 8);
+			p += 3;
+			break;
+		default:
+			return FALSE;
 		}
-		MEMORY_dPutByte(addr, data);
-		Z = N = A &= data;
-		DONE
-
-	OPCODE(28)				/* PLP */
-		PLP;
-		CPUCHECKIRQ;
-		DONE
-
-	OPCODE(29)				/* AND #ab */
-		AND(IMMEDIATE);
-		DONE
-
-	OPCODE(2a)				/* ROL */
-		Z = N = (A << 1) + C;
-		C = (A & 0x80) ? 1 : 0;
-		A = Z;
-		DONE
-
-	OPCODE(2c)				/* BIT abcd */
-		ABSOLUTE;
-		N = MEMORY_GetByte(addr);
-#ifndef NO_V_FLAG_VARIABLE
-		V = N & 0x40;
-#else
-		CPU_regP = (CPU_regP & 0xbf) + (N & 0x40);
-#endif
-		Z = (A & N);
-		DONE
-
-	OPCODE(2d)				/* AND abcd */
-		ABSOLUTE;
-		AND(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(2e)				/* ROL abcd */
-		ABSOLUTE;
-		RMW_GetByte(data, addr);
-		Z = N = (data << 1) + C;
-		C = (data & 0x80) ? 1 : 0;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(2f)				/* RLA abcd [unofficial - ROL Mem, then AND with A] */
-		ABSOLUTE;
-		goto rla;
-
-	OPCODE(30)				/* BMI */
-		BRANCH(N & 0x80)
-
-	OPCODE(31)				/* AND (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		AND(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(33)				/* RLA (ab),y [unofficial - ROL Mem, then AND with A] */
-		INDIRECT_Y;
-		goto rla;
-
-	OPCODE(35)				/* AND ab,x */
-		ZPAGE_X;
-		AND(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(36)				/* ROL ab,x */
-		ZPAGE_X;
-		data = MEMORY_dGetByte(addr);
-		Z = N = (data << 1) + C;
-		C = (data & 0x80) ? 1 : 0;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(37)				/* RLA ab,x [unofficial - ROL Mem, then AND with A] */
-		ZPAGE_X;
-		goto rla_zpage;
-
-	OPCODE(38)				/* SEC */
-		C = 1;
-		DONE
-
-	OPCODE(39)				/* AND abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		AND(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(3b)				/* RLA abcd,y [unofficial - ROL Mem, then AND with A] */
-		ABSOLUTE_Y;
-		goto rla;
-
-	OPCODE(3d)				/* AND abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		AND(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(3e)				/* ROL abcd,x */
-		ABSOLUTE_X;
-		RMW_GetByte(data, addr);
-		Z = N = (data << 1) + C;
-		C = (data & 0x80) ? 1 : 0;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(3f)				/* RLA abcd,x [unofficial - ROL Mem, then AND with A] */
-		ABSOLUTE_X;
-		goto rla;
-
-	OPCODE(40)				/* RTI */
-		PLP;
-		data = PL;
-		SET_PC((PL << 8) + data);
-		CPUCHECKIRQ;
-#ifdef MONITOR_BREAK
-		if (MONITOR_break_ret && --MONITOR_ret_nesting <= 0)
-			MONITOR_break_step = TRUE;
-#endif
-		DONE
-
-	OPCODE(41)				/* EOR (ab,x) */
-		INDIRECT_X;
-		EOR(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(43)				/* LSE (ab,x) [unofficial - LSR then EOR result with A] */
-		INDIRECT_X;
-
-	lse:
-		RMW_GetByte(data, addr);
-		C = data & 1;
-		data >>= 1;
-		MEMORY_PutByte(addr, data);
-		Z = N = A ^= data;
-		DONE
-
-	OPCODE(45)				/* EOR ab */
-		ZPAGE;
-		EOR(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(46)				/* LSR ab */
-		ZPAGE;
-		data = MEMORY_dGetByte(addr);
-		C = data & 1;
-		Z = data >> 1;
-		N = 0;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(47)				/* LSE ab [unofficial - LSR then EOR result with A] */
-		ZPAGE;
-
-	lse_zpage:
-		data = MEMORY_dGetByte(addr);
-		C = data & 1;
-		data >>= 1;
-		MEMORY_dPutByte(addr, data);
-		Z = N = A ^= data;
-		DONE
-
-	OPCODE(48)				/* PHA */
-		PH(A);
-		DONE
-
-	OPCODE(49)				/* EOR #ab */
-		EOR(IMMEDIATE);
-		DONE
-
-	OPCODE(4a)				/* LSR */
-		C = A & 1;
-		Z = N = A >>= 1;
-		DONE
-
-	OPCODE(4b)				/* ALR #ab [unofficial - Acc AND Data, LSR result] */
-		data = A & IMMEDIATE;
-		C = data & 1;
-		Z = N = A = (data >> 1);
-		DONE
-
-	OPCODE(4c)				/* JMP abcd */
-#ifdef MONITOR_BREAK
-		CPU_remember_JMP[CPU_remember_jmp_curpos] = GET_PC() - 1;
-		CPU_remember_jmp_curpos = (CPU_remember_jmp_curpos + 1) % CPU_REMEMBER_JMP_STEPS;
-#endif
-		SET_PC(OP_WORD);
-		DONE
-
-	OPCODE(4d)				/* EOR abcd */
-		ABSOLUTE;
-		EOR(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(4e)				/* LSR abcd */
-		ABSOLUTE;
-		RMW_GetByte(data, addr);
-		C = data & 1;
-		Z = data >> 1;
-		N = 0;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(4f)				/* LSE abcd [unofficial - LSR then EOR result with A] */
-		ABSOLUTE;
-		goto lse;
-
-	OPCODE(50)				/* BVC */
-#ifndef NO_V_FLAG_VARIABLE
-		BRANCH(!V)
-#else
-		BRANCH(!(CPU_regP & 0x40))
-#endif
+		copy_last.ops[n_ops++] = insn;
+		cyc += cycles[insn];
+	}
+	copy_last.update = insn;
+	copy_last.branch = MEMORY_dGetByte((UWORD) (p + 1));
+	if (copy_last.branch != 0xd0 && copy_last.branch != 0x10)
+		return FALSE;
+	copy_last.end = p + 3;
+	if (copy_last.end <= start
+	 || (UWORD) (copy_last.end + (SBYTE) MEMORY_dGetByte((UWORD) (p + 2))) != start)
+		return FALSE;
+	copy_last.n_ops = n_ops;
+	copy_last.cycles = cyc + cycles[insn] + cycles[copy_last.branch];
+	copy_last.taken_cycles = (start ^ copy_last.end) & 0xff00 ? 2 : 1;
+	memcpy(copy_last.code, MEMORY_mem + start, copy_last.end - start);
+	copy_last.start = start;
+	return TRUE;
+}
 
-	OPCODE(51)				/* EOR (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		EOR(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(53)				/* LSE (ab),y [unofficial - LSR then EOR result with A] */
-		INDIRECT_Y;
-		goto lse;
-
-	OPCODE(55)				/* EOR ab,x */
-		ZPAGE_X;
-		EOR(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(56)				/* LSR ab,x */
-		ZPAGE_X;
-		data = MEMORY_dGetByte(addr);
-		C = data & 1;
-		Z = data >> 1;
-		N = 0;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(57)				/* LSE ab,x [unofficial - LSR then EOR result with A] */
-		ZPAGE_X;
-		goto lse_zpage;
-
-	OPCODE(58)				/* CLI */
-		CPU_ClrI;
-		CPUCHECKIRQ;
-		DONE
-
-	OPCODE(59)				/* EOR abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		EOR(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(5b)				/* LSE abcd,y [unofficial - LSR then EOR result with A] */
-		ABSOLUTE_Y;
-		goto lse;
-
-	OPCODE(5d)				/* EOR abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		EOR(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(5e)				/* LSR abcd,x */
-		ABSOLUTE_X;
-		RMW_GetByte(data, addr);
-		C = data & 1;
-		Z = data >> 1;
-		N = 0;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(5f)				/* LSE abcd,x [unofficial - LSR then EOR result with A] */
-		ABSOLUTE_X;
-		goto lse;
-
-	OPCODE(60)				/* RTS */
-		data = PL;
-		SET_PC((PL << 8) + data + 1);
+/* If *PC is the start of a copy loop, runs all its iterations that end
+   before ANTIC_xpos_limit, in order and byte by byte, so that overlapping
+   moves give the same result as on the 6502. The iterations are left to
+   the interpreter if they would access hardware registers, write to ROM,
+   the loop itself or the pointers that it uses. Updates the registers,
+   N, Z and ANTIC_xpos. Returns the number of iterations run (0 if the next
+   iteration must be interpreted), or -1 if *PC is not a copy loop. */
+static int copy_loop(UWORD *pc, UBYTE *a, UBYTE *x, UBYTE *y)
+{
+	UWORD start = *pc;
+	UWORD end;
+	int n_ops;
+	/* address for a fixed index, or base address to add the index to */
+	UWORD addrs[COPY_MAX_INSNS];
+	UBYTE indexed[COPY_MAX_INSNS];
+	/* low bytes of the base addresses of indexed loads */
+	int cross[COPY_MAX_INSNS];
+	int n_cross = 0;
+	int cyc;
+	UBYTE index;
+	UBYTE first;
+	UBYTE last;
+	int step;
+	int index_x;
+	int total = 0;
+	int iterations = 0;
+	int finished = FALSE;
+	/* stored ranges */
+	int stores1[COPY_MAX_INSNS];
+	int stores2[COPY_MAX_INSNS];
+	int n_stores = 0;
+	UBYTE value;
+	int i;
+
+	if (start != copy_last.start
+	 || memcmp(MEMORY_mem + start, copy_last.code, copy_last.end - start) != 0) {
+		if (!copy_decode(start))
+			return -1;
+	}
 #ifdef MONITOR_BREAK
-		if (MONITOR_break_ret && --MONITOR_ret_nesting <= 0)
-			MONITOR_break_step = TRUE;
+	if (MONITOR_break_addr >= start && MONITOR_break_addr < copy_last.end)
+		return 0;
 #endif
-		if (CPU_rts_handler != NULL) {
-			CPU_rts_handler();
-			CPU_rts_handler = NULL;
-		}
-		DONE
-
-	OPCODE(61)				/* ADC (ab,x) */
-		INDIRECT_X;
-		data = MEMORY_GetByte(addr);
-		goto adc;
-
-	OPCODE(63)				/* RRA (ab,x) [unofficial - ROR Mem, then ADC to Acc] */
-		INDIRECT_X;
-
-	rra:
-		RMW_GetByte(data, addr);
-		if (C) {
-			C = data & 1;
-			data = (data >> 1) + 0x80;
+	end = copy_last.end;
+	n_ops = copy_last.n_ops;
+	cyc = copy_last.cycles + copy_last.taken_cycles;
+	index_x = copy_last.update == 0xe8 || copy_last.update == 0xca;
+	index = index_x ? *x : *y;
+	step = copy_last.update == 0xe8 || copy_last.update == 0xc8 ? 1 : -1;
+
+	/* The pointers and the register that is not updated do not change,
+	   so every access is to a fixed address or to a base address plus
+	   the index. */
+	for (i = 0; i < n_ops; i++) {
+		UBYTE op = copy_last.ops[i];
+		UWORD addr = copy_last.args[i];
+		UBYTE reg;
+		switch (op) {
+		case 0xbd: case 0x9d: case 0x95:
+			indexed[i] = index_x;
+			reg = *x;
+			break;
+		case 0xb1: case 0x91:
+			addr = zGetWord(addr);
+			/* FALLTHROUGH */
+		case 0xb9: case 0x99:
+			indexed[i] = !index_x;
+			reg = *y;
+			break;
+		default:
+			indexed[i] = FALSE;
+			reg = 0;
+			break;
 		}
-		else {
-			C = data & 1;
-			data >>= 1;
-		}
-		MEMORY_PutByte(addr, data);
-		goto adc;
-
-	OPCODE(65)				/* ADC ab */
-		ZPAGE;
-		data = MEMORY_dGetByte(addr);
-		goto adc;
-
-	OPCODE(66)				/* ROR ab */
-		ZPAGE;
-		data = MEMORY_dGetByte(addr);
-		Z = N = (C << 7) + (data >> 1);
-		C = data & 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(67)				/* RRA ab [unofficial - ROR Mem, then ADC to Acc] */
-		ZPAGE;
-
-	rra_zpage:
-		data = MEMORY_dGetByte(addr);
-		if (C) {
-			C = data & 1;
-			data = (data >> 1) + 0x80;
-		}
-		else {
-			C = data & 1;
-			data >>= 1;
-		}
-		MEMORY_dPutByte(addr, data);
-		goto adc;
-
-	OPCODE(68)				/* PLA */
-		Z = N = A = PL;
-		DONE
-
-	OPCODE(69)				/* ADC #ab */
-		data = IMMEDIATE;
-		goto adc;
-
-	OPCODE(6a)				/* ROR */
-		Z = N = (C << 7) + (A >> 1);
-		C = A & 1;
-		A = Z;
-		DONE
-
-	OPCODE(6b)				/* ARR #ab [unofficial - Acc AND Data, ROR result] */
-		/* It does some 'BCD fixup' if D flag is set */
-		/* MPC 05/24/00 */
-		data = A & IMMEDIATE;
-		if (CPU_regP & CPU_D_FLAG) {
-			UBYTE temp = (data >> 1) + (C << 7);
-			Z = N = temp;
-#ifndef NO_V_FLAG_VARIABLE
-			V = ((temp ^ data) & 0x40);
-#else
-			CPU_regP = (CPU_regP & 0xbf) + ((temp ^ data) & 0x40);
-#endif
-			if ((data & 0x0F) + (data & 0x01) > 5)
-				temp = (temp & 0xF0) + ((temp + 0x6) & 0x0F);
-			if (data + (data & 0x10) >= 0x60) {
-				temp += 0x60;
-				C = 1;
-			}
-			else
-				C = 0;
-			A = (UBYTE) temp;
+		if (indexed[i]) {
+			if (op & 0x20)
+				cross[n_cross++] = (UBYTE) addr;
 		}
 		else {
-			Z = N = A = (data >> 1) + (C << 7);
-			C = data >> 7;
-#ifndef NO_V_FLAG_VARIABLE
-			V = C ^ ((A >> 5) & 1);
-#else
-			CPU_regP = (CPU_regP & 0xbf) + ((A ^ data) & 0x40);
-#endif
+			addr = op == 0x95 ? (UBYTE) (addr + reg) : (UWORD) (addr + reg);
+			/* the same page crossing in every iteration */
+			if ((op & 0x20) && (UBYTE) addr < reg)
+				cyc++;
 		}
-		DONE
-
-	OPCODE(6c)				/* JMP (abcd) */
-#ifdef MONITOR_BREAK
-		CPU_remember_JMP[CPU_remember_jmp_curpos] = GET_PC() - 1;
-		CPU_remember_jmp_curpos = (CPU_remember_jmp_curpos + 1) % CPU_REMEMBER_JMP_STEPS;
-#endif
-		ABSOLUTE;
-#ifdef CPU65C02
-		/* XXX: if ((UBYTE) addr == 0xff) ANTIC_xpos++; */
-		SET_PC(MEMORY_dGetWord(addr));
-#else
-		/* original 6502 had a bug in JMP (addr) when addr crossed page boundary */
-		if ((UBYTE) addr == 0xff)
-			SET_PC((MEMORY_dGetByte(addr - 0xff) << 8) + MEMORY_dGetByte(addr));
-		else
-			SET_PC(MEMORY_dGetWord(addr));
-#endif
-		DONE
-
-	OPCODE(6d)				/* ADC abcd */
-		ABSOLUTE;
-		data = MEMORY_GetByte(addr);
-		goto adc;
-
-	OPCODE(6e)				/* ROR abcd */
-		ABSOLUTE;
-		RMW_GetByte(data, addr);
-		Z = N = (C << 7) + (data >> 1);
-		C = data & 1;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(6f)				/* RRA abcd [unofficial - ROR Mem, then ADC to Acc] */
-		ABSOLUTE;
-		goto rra;
-
-	OPCODE(70)				/* BVS */
-#ifndef NO_V_FLAG_VARIABLE
-		BRANCH(V)
-#else
-		BRANCH(CPU_regP & 0x40)
-#endif
+		addrs[i] = addr;
+	}
 
-	OPCODE(71)				/* ADC (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		data = MEMORY_GetByte(addr);
-		goto adc;
-
-	OPCODE(73)				/* RRA (ab),y [unofficial - ROR Mem, then ADC to Acc] */
-		INDIRECT_Y;
-		goto rra;
-
-	OPCODE(75)				/* ADC ab,x */
-		ZPAGE_X;
-		data = MEMORY_dGetByte(addr);
-		goto adc;
-
-	OPCODE(76)				/* ROR ab,x */
-		ZPAGE_X;
-		data = MEMORY_dGetByte(addr);
-		Z = N = (C << 7) + (data >> 1);
-		C = data & 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(77)				/* RRA ab,x [unofficial - ROR Mem, then ADC to Acc] */
-		ZPAGE_X;
-		goto rra_zpage;
-
-	OPCODE(78)				/* SEI */
-		CPU_SetI;
-		DONE
-
-	OPCODE(79)				/* ADC abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		data = MEMORY_GetByte(addr);
-		goto adc;
-
-	OPCODE(7b)				/* RRA abcd,y [unofficial - ROR Mem, then ADC to Acc] */
-		ABSOLUTE_Y;
-		goto rra;
-
-	OPCODE(7d)				/* ADC abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		data = MEMORY_GetByte(addr);
-		goto adc;
-
-	OPCODE(7e)				/* ROR abcd,x */
-		ABSOLUTE_X;
-		RMW_GetByte(data, addr);
-		Z = N = (C << 7) + (data >> 1);
-		C = data & 1;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(7f)				/* RRA abcd,x [unofficial - ROR Mem, then ADC to Acc] */
-		ABSOLUTE_X;
-		goto rra;
-
-	OPCODE(81)				/* STA (ab,x) */
-		INDIRECT_X;
-		MEMORY_PutByte(addr, A);
-		DONE
-
-	/* AXS doesn't change flags and SAX is better name for it (Fox) */
-	OPCODE(83)				/* SAX (ab,x) [unofficial - Store result A AND X */
-		INDIRECT_X;
-		data = A & X;
-		MEMORY_PutByte(addr, data);
-		DONE
-
-	OPCODE(84)				/* STY ab */
-		ZPAGE;
-		MEMORY_dPutByte(addr, Y);
-		DONE
-
-	OPCODE(85)				/* STA ab */
-		ZPAGE;
-		MEMORY_dPutByte(addr, A);
-		DONE
-
-	OPCODE(86)				/* STX ab */
-		ZPAGE;
-		MEMORY_dPutByte(addr, X);
-		DONE
-
-	OPCODE(87)				/* SAX ab [unofficial - Store result A AND X] */
-		ZPAGE;
-		data = A & X;
-		MEMORY_dPutByte(addr, data);
-		DONE
-
-	OPCODE(88)				/* DEY */
-		Z = N = --Y;
-		DONE
-
-	OPCODE(8a)				/* TXA */
-		Z = N = A = X;
-		DONE
-
-	OPCODE(8b)				/* ANE #ab [unofficial - A AND X AND (Mem OR $EF) to Acc] (Fox) */
-		data = IMMEDIATE;
-		Z = N = A & X & data;
-		A &= X & (data | 0xef);
-		DONE
-
-	OPCODE(8c)				/* STY abcd */
-		ABSOLUTE;
-		MEMORY_PutByte(addr, Y);
-		DONE
-
-	OPCODE(8d)				/* STA abcd */
-		ABSOLUTE;
-		MEMORY_PutByte(addr, A);
-		DONE
-
-	OPCODE(8e)				/* STX abcd */
-		ABSOLUTE;
-		MEMORY_PutByte(addr, X);
-		DONE
-
-	OPCODE(8f)				/* SAX abcd [unofficial - Store result A AND X] */
-		ABSOLUTE;
-		data = A & X;
-		MEMORY_PutByte(addr, data);
-		DONE
-
-	OPCODE(90)				/* BCC */
-		BRANCH(!C)
-
-	OPCODE(91)				/* STA (ab),y */
-		INDIRECT_Y;
-		MEMORY_PutByte(addr, A);
-		DONE
-
-	OPCODE(93)				/* SHA (ab),y [unofficial, UNSTABLE - Store A AND X AND (H+1) ?] (Fox) */
-		/* It seems previous memory value is important - also in 9f */
-		ZPAGE;
-		addr = zGetWord(addr);
-		data = A & X & ((addr >> 8) + 1);
-		if ((addr & 0xff) + Y > 0xff) { /* if it crosses a page */
-			MEMORY_PutByte(((addr + Y) & 0xff) | (data << 8), data);
+	/* Count the iterations that end before the limit, without letting
+	   the index wrap around. */
+	first = last = index;
+	for (;;) {
+		int c = cyc;
+		UBYTE next = index + step;
+		for (i = 0; i < n_cross; i++)
+			if (cross[i] + index > 0xff)
+				c++;
+		if (copy_last.branch == 0xd0 ? next == 0 : (next & 0x80) != 0) {
+			c -= copy_last.taken_cycles;
+			finished = TRUE;
 		}
-		else {
-			MEMORY_PutByte(addr + Y, data);
+		if (ANTIC_xpos + total + c >= ANTIC_xpos_limit) {
+			finished = FALSE;
+			break;
 		}
-		DONE
-
-	OPCODE(94)				/* STY ab,x */
-		ZPAGE_X;
-		MEMORY_dPutByte(addr, Y);
-		DONE
-
-	OPCODE(95)				/* STA ab,x */
-		ZPAGE_X;
-		MEMORY_dPutByte(addr, A);
-		DONE
-
-	OPCODE(96)				/* STX ab,y */
-		ZPAGE_Y;
-		MEMORY_PutByte(addr, X);
-		DONE
-
-	OPCODE(97)				/* SAX ab,y [unofficial - Store result A AND X] */
-		ZPAGE_Y;
-		data = A & X;
-		MEMORY_dPutByte(addr, data);
-		DONE
-
-	OPCODE(98)				/* TYA */
-		Z = N = A = Y;
-		DONE
-
-	OPCODE(99)				/* STA abcd,y */
-		ABSOLUTE_Y;
-		MEMORY_PutByte(addr, A);
-		DONE
-
-	OPCODE(9a)				/* TXS */
-		S = X;
-		DONE
-
-	OPCODE(9b)				/* SHS abcd,y [unofficial, UNSTABLE] (Fox) */
-		/* Transfer A AND X to S, then store S AND (H+1)] */
-		/* S seems to be stable, only memory values vary */
-		ABSOLUTE;
-		S = A & X;
-		data = S & ((addr >> 8) + 1);
-		if ((addr & 0xff) + Y > 0xff) { /* if it crosses a page */
-			MEMORY_PutByte(((addr + Y) & 0xff) | (data << 8), data);
-		}
-		else {
-			MEMORY_PutByte(addr + Y, data);
+		total += c;
+		iterations++;
+		last = index;
+		index = next;
+		if (finished || next == (step > 0 ? 0 : 0xff))
+			break;
+	}
+	if (iterations == 0)
+		return 0;
+
+	/* Check the memory accessed by these iterations. */
+	for (i = 0; i < n_ops; i++) {
+		UBYTE op = copy_last.ops[i];
+		int addr1 = addrs[i];
+		int addr2 = addrs[i];
+		if (op == 0xa9)
+			continue;
+		if (indexed[i]) {
+			addr1 += step > 0 ? first : last;
+			addr2 += step > 0 ? last : first;
+			if (addr2 > (op == 0x95 ? 0xff : 0xffff))
+				return 0;
 		}
-		DONE
-
-	OPCODE(9c)				/* SHY abcd,x [unofficial - Store Y and (H+1)] (Fox) */
-		/* Seems to be stable */
-		ABSOLUTE;
-		/* MPC 05/24/00 */
-		data = Y & ((UBYTE) ((addr >> 8) + 1));
-		if ((addr & 0xff) + X > 0xff) { /* if it crosses a page */
-			MEMORY_PutByte(((addr + X) & 0xff) | (data << 8), data);
+		if (op & 0x20) {
+			if (!copy_can_read((UWORD) addr1, (UWORD) addr2))
+				return 0;
 		}
 		else {
-			MEMORY_PutByte(addr + X, data);
-		}
-		DONE
-
-	OPCODE(9d)				/* STA abcd,x */
-		ABSOLUTE_X;
-		MEMORY_PutByte(addr, A);
-		DONE
-
-	OPCODE(9e)				/* SHX abcd,y [unofficial - Store X and (H+1)] (Fox) */
-		/* Seems to be stable */
-		ABSOLUTE;
-		/* MPC 05/24/00 */
-		data = X & ((UBYTE) ((addr >> 8) + 1));
-		if ((addr & 0xff) + Y > 0xff) { /* if it crosses a page */
-			MEMORY_PutByte(((addr + Y) & 0xff) | (data << 8), data);
+			int j;
+			if (!copy_can_write((UWORD) addr1, (UWORD) addr2) || (addr2 >= start && addr1 < end))
+				return 0;
+			for (j = 0; j < n_ops; j++) {
+				if (copy_last.ops[j] == 0xb1 || copy_last.ops[j] == 0x91) {
+					int zp = copy_last.args[j];
+					if ((addr1 <= zp && zp <= addr2)
+					 || (addr1 <= (UBYTE) (zp + 1) && (UBYTE) (zp + 1) <= addr2))
+						return 0;
+				}
+			}
+			stores1[n_stores] = addr1;
+			stores2[n_stores++] = addr2;
 		}
-		else {
-			MEMORY_PutByte(addr + Y, data);
+	}
+	for (i = 0; i < n_stores; i++)
+		copy_mark(stores1[i], stores2[i]);
+
+	/* Run the iterations. */
+	value = *a;
+	index = first;
+	for (;;) {
+		for (i = 0; i < n_ops; i++) {
+			UWORD addr = indexed[i] ? addrs[i] + index : addrs[i];
+			UBYTE op = copy_last.ops[i];
+			if (op == 0xa9)
+				value = (UBYTE) copy_last.args[i];
+			else if (op & 0x20)
+				value = MEMORY_mem[addr];
+			else
+				MEMORY_mem[addr] = value;
 		}
-		DONE
+		if (index == last)
+			break;
+		index += step;
+	}
+	*a = value;
+	index = last + step;
+	if (index_x)
+		*x = index;
+	else
+		*y = index;
+	Z = N = index;
+	ANTIC_xpos += total;
+	if (finished)
+		*pc = end;
+	return iterations;
+}
 
-	OPCODE(9f)				/* SHA abcd,y [unofficial, UNSTABLE - Store A AND X AND (H+1) ?] (Fox) */
-		ABSOLUTE;
-		data = A & X & ((addr >> 8) + 1);
-		if ((addr & 0xff) + Y > 0xff) { /* if it crosses a page */
-			MEMORY_PutByte(((addr + Y) & 0xff) | (data << 8), data);
-		}
-		else {
-			MEMORY_PutByte(addr + Y, data);
-		}
-		DONE
-
-	OPCODE(a0)				/* LDY #ab */
-		LDY(IMMEDIATE);
-		DONE
-
-	OPCODE(a1)				/* LDA (ab,x) */
-		INDIRECT_X;
-		LDA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(a2)				/* LDX #ab */
-		LDX(IMMEDIATE);
-		DONE
-
-	OPCODE(a3)				/* LAX (ab,x) [unofficial] */
-		INDIRECT_X;
-		Z = N = X = A = MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(a4)				/* LDY ab */
-		ZPAGE;
-		LDY(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(a5)				/* LDA ab */
-		ZPAGE;
-		LDA(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(a6)				/* LDX ab */
-		ZPAGE;
-		LDX(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(a7)				/* LAX ab [unofficial] */
-		ZPAGE;
-		Z = N = X = A = MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(a8)				/* TAY */
-		Z = N = Y = A;
-		DONE
-
-	OPCODE(a9)				/* LDA #ab */
-		LDA(IMMEDIATE);
-		DONE
-
-	OPCODE(aa)				/* TAX */
-		Z = N = X = A;
-		DONE
-
-	OPCODE(ab)				/* ANX #ab [unofficial - AND #ab, then TAX] */
-		Z = N = X = A &= IMMEDIATE;
-		DONE
-
-	OPCODE(ac)				/* LDY abcd */
-		ABSOLUTE;
-		LDY(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(ad)				/* LDA abcd */
-		ABSOLUTE;
-		LDA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(ae)				/* LDX abcd */
-		ABSOLUTE;
-		LDX(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(af)				/* LAX abcd [unofficial] */
-		ABSOLUTE;
-		Z = N = X = A = MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(b0)				/* BCS */
-		BRANCH(C)
-
-	OPCODE(b1)				/* LDA (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		LDA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(b3)				/* LAX (ab),y [unofficial] */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		Z = N = X = A = MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(b4)				/* LDY ab,x */
-		ZPAGE_X;
-		LDY(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(b5)				/* LDA ab,x */
-		ZPAGE_X;
-		LDA(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(b6)				/* LDX ab,y */
-		ZPAGE_Y;
-		LDX(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(b7)				/* LAX ab,y [unofficial] */
-		ZPAGE_Y;
-		Z = N = X = A = MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(b8)				/* CLV */
-#ifndef NO_V_FLAG_VARIABLE
-		V = 0;
-#else
-		CPU_ClrV;
-#endif
-		DONE
-
-	OPCODE(b9)				/* LDA abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		LDA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(ba)				/* TSX */
-		Z = N = X = S;
-		DONE
-
-/* AXA [unofficial - original decode by R.Sterba and R.Petruzela 15.1.1998 :-)]
-   AXA - this is our new imaginative name for instruction with opcode hex BB.
-   AXA - Store Mem AND #$FD to Acc and X, then set stackpoint to value (Acc - 4)
-   It's cool! :-)
-   LAS - this is better name for this :) (Fox)
-   It simply ANDs stack pointer with Mem, then transfers result to A and X
- */
+#endif /* IDLE_LOOPS */
 
-	OPCODE(bb)				/* LAS abcd,y [unofficial - AND S with Mem, transfer to A and X (Fox) */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		Z = N = A = X = S &= MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(bc)				/* LDY abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		LDY(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(bd)				/* LDA abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		LDA(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(be)				/* LDX abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		LDX(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(bf)				/* LAX abcd,y [unofficial] */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		Z = N = X = A = MEMORY_GetByte(addr);
-		DONE
-
-	OPCODE(c0)				/* CPY #ab */
-		CPY(IMMEDIATE);
-		DONE
-
-	OPCODE(c1)				/* CMP (ab,x) */
-		INDIRECT_X;
-		CMP(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(c3)				/* DCM (ab,x) [unofficial - DEC Mem then CMP with Acc] */
-		INDIRECT_X;
-
-	dcm:
-		RMW_GetByte(data, addr);
-		data--;
-		MEMORY_PutByte(addr, data);
-		CMP(data);
-		DONE
-
-	OPCODE(c4)				/* CPY ab */
-		ZPAGE;
-		CPY(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(c5)				/* CMP ab */
-		ZPAGE;
-		CMP(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(c6)				/* DEC ab */
-		ZPAGE;
-		Z = N = MEMORY_dGetByte(addr) - 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(c7)				/* DCM ab [unofficial - DEC Mem then CMP with Acc] */
-		ZPAGE;
-
-	dcm_zpage:
-		data = MEMORY_dGetByte(addr) - 1;
-		MEMORY_dPutByte(addr, data);
-		CMP(data);
-		DONE
-
-	OPCODE(c8)				/* INY */
-		Z = N = ++Y;
-		DONE
-
-	OPCODE(c9)				/* CMP #ab */
-		CMP(IMMEDIATE);
-		DONE
-
-	OPCODE(ca)				/* DEX */
-		Z = N = --X;
-		DONE
-
-	OPCODE(cb)				/* SBX #ab [unofficial - store ((A AND X) - Mem) in X] (Fox) */
-		X &= A;
-		data = IMMEDIATE;
-		C = X >= data;
-		/* MPC 05/24/00 */
-		Z = N = X -= data;
-		DONE
-
-	OPCODE(cc)				/* CPY abcd */
-		ABSOLUTE;
-		CPY(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(cd)				/* CMP abcd */
-		ABSOLUTE;
-		CMP(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(ce)				/* DEC abcd */
-		ABSOLUTE;
-		RMW_GetByte(Z, addr);
-		N = --Z;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(cf)				/* DCM abcd [unofficial - DEC Mem then CMP with Acc] */
-		ABSOLUTE;
-		goto dcm;
-
-	OPCODE(d0)				/* BNE */
-		BRANCH(Z)
-
-	OPCODE(d1)				/* CMP (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		CMP(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(d3)				/* DCM (ab),y [unofficial - DEC Mem then CMP with Acc] */
-		INDIRECT_Y;
-		goto dcm;
-
-	OPCODE(d5)				/* CMP ab,x */
-		ZPAGE_X;
-		CMP(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(d6)				/* DEC ab,x */
-		ZPAGE_X;
-		Z = N = MEMORY_dGetByte(addr) - 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(d7)				/* DCM ab,x [unofficial - DEC Mem then CMP with Acc] */
-		ZPAGE_X;
-		goto dcm_zpage;
-
-	OPCODE(d8)				/* CLD */
-		CPU_ClrD;
-		DONE
-
-	OPCODE(d9)				/* CMP abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		CMP(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(db)				/* DCM abcd,y [unofficial - DEC Mem then CMP with Acc] */
-		ABSOLUTE_Y;
-		goto dcm;
-
-	OPCODE(dd)				/* CMP abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		CMP(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(de)				/* DEC abcd,x */
-		ABSOLUTE_X;
-		RMW_GetByte(Z, addr);
-		N = --Z;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(df)				/* DCM abcd,x [unofficial - DEC Mem then CMP with Acc] */
-		ABSOLUTE_X;
-		goto dcm;
-
-	OPCODE(e0)				/* CPX #ab */
-		CPX(IMMEDIATE);
-		DONE
-
-	OPCODE(e1)				/* SBC (ab,x) */
-		INDIRECT_X;
-		data = MEMORY_GetByte(addr);
-		goto sbc;
-
-	OPCODE(e3)				/* INS (ab,x) [unofficial - INC Mem then SBC with Acc] */
-		INDIRECT_X;
-
-	ins:
-		RMW_GetByte(data, addr);
-		++data;
-		MEMORY_PutByte(addr, data);
-		goto sbc;
-
-	OPCODE(e4)				/* CPX ab */
-		ZPAGE;
-		CPX(MEMORY_dGetByte(addr));
-		DONE
-
-	OPCODE(e5)				/* SBC ab */
-		ZPAGE;
-		data = MEMORY_dGetByte(addr);
-		goto sbc;
-
-	OPCODE(e6)				/* INC ab */
-		ZPAGE;
-		Z = N = MEMORY_dGetByte(addr) + 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(e7)				/* INS ab [unofficial - INC Mem then SBC with Acc] */
-		ZPAGE;
-
-	ins_zpage:
-		data = MEMORY_dGetByte(addr) + 1;
-		MEMORY_dPutByte(addr, data);
-		goto sbc;
-
-	OPCODE(e8)				/* INX */
-		Z = N = ++X;
-		DONE
-
-	OPCODE_ALIAS(e9)		/* SBC #ab */
-	OPCODE(eb)				/* SBC #ab [unofficial] */
-		data = IMMEDIATE;
-		goto sbc;
-
-	OPCODE_ALIAS(ea)		/* NOP */
-	OPCODE_ALIAS(1a)		/* NOP [unofficial] */
-	OPCODE_ALIAS(3a)
-	OPCODE_ALIAS(5a)
-	OPCODE_ALIAS(7a)
-	OPCODE_ALIAS(da)
-	OPCODE(fa)
-		DONE
-
-	OPCODE(ec)				/* CPX abcd */
-		ABSOLUTE;
-		CPX(MEMORY_GetByte(addr));
-		DONE
-
-	OPCODE(ed)				/* SBC abcd */
-		ABSOLUTE;
-		data = MEMORY_GetByte(addr);
-		goto sbc;
-
-	OPCODE(ee)				/* INC abcd */
-		ABSOLUTE;
-		RMW_GetByte(Z, addr);
-		N = ++Z;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(ef)				/* INS abcd [unofficial - INC Mem then SBC with Acc] */
-		ABSOLUTE;
-		goto ins;
-
-	OPCODE(f0)				/* BEQ */
-		BRANCH(!Z)
-
-	OPCODE(f1)				/* SBC (ab),y */
-		INDIRECT_Y;
-		NCYCLES_Y;
-		data = MEMORY_GetByte(addr);
-		goto sbc;
-
-	OPCODE(f3)				/* INS (ab),y [unofficial - INC Mem then SBC with Acc] */
-		INDIRECT_Y;
-		goto ins;
-
-	OPCODE(f5)				/* SBC ab,x */
-		ZPAGE_X;
-		data = MEMORY_dGetByte(addr);
-		goto sbc;
-
-	OPCODE(f6)				/* INC ab,x */
-		ZPAGE_X;
-		Z = N = MEMORY_dGetByte(addr) + 1;
-		MEMORY_dPutByte(addr, Z);
-		DONE
-
-	OPCODE(f7)				/* INS ab,x [unofficial - INC Mem then SBC with Acc] */
-		ZPAGE_X;
-		goto ins_zpage;
-
-	OPCODE(f8)				/* SED */
-		CPU_SetD;
-		DONE
-
-	OPCODE(f9)				/* SBC abcd,y */
-		ABSOLUTE_Y;
-		NCYCLES_Y;
-		data = MEMORY_GetByte(addr);
-		goto sbc;
-
-	OPCODE(fb)				/* INS abcd,y [unofficial - INC Mem then SBC with Acc] */
-		ABSOLUTE_Y;
-		goto ins;
-
-	OPCODE(fd)				/* SBC abcd,x */
-		ABSOLUTE_X;
-		NCYCLES_X;
-		data = MEMORY_GetByte(addr);
-		goto sbc;
-
-	OPCODE(fe)				/* INC abcd,x */
-		ABSOLUTE_X;
-		RMW_GetByte(Z, addr);
-		N = ++Z;
-		MEMORY_PutByte(addr, Z);
-		DONE
-
-	OPCODE(ff)				/* INS abcd,x [unofficial - INC Mem then SBC with Acc] */
-		ABSOLUTE_X;
-		goto ins;
-
-#ifdef ASAP
-
-	OPCODE_ALIAS(d2)
-	OPCODE_ALIAS(f2)
+#endif /* FALCON_CPUASM */
 
-#else
+#ifdef CPU_GO_VARIANTS
 
-	OPCODE(d2)				/* ESCRTS #ab (CIM) - on Atari is here instruction CIM [unofficial] !RS! */
-		data = IMMEDIATE;
-		UPDATE_GLOBAL_REGS;
-		CPU_GetStatus();
-		ESC_Run(data);
-		CPU_PutStatus();
-		UPDATE_LOCAL_REGS;
-		data = PL;
-		SET_PC((PL << 8) + data + 1);
-#ifdef MONITOR_BREAK
-		if (MONITOR_break_ret && --MONITOR_ret_nesting <= 0)
-			MONITOR_break_step = TRUE;
+/* Returns TRUE if a monitor feature that only go_debug() supports is
+   switched on. */
+static int debugging(void)
+{
+#ifdef MONITOR_BREAKPOINTS
+	if (MONITOR_breakpoint_table_size > 0 && MONITOR_breakpoints_enabled)
+		return TRUE;
 #endif
-		DONE
-
-	OPCODE(f2)				/* ESC #ab (CIM) - on Atari is here instruction CIM [unofficial] !RS! */
-		/* OPCODE(ff: ESC #ab - opcode FF is now used for INS [unofficial] instruction !RS! */
-		data = IMMEDIATE;
-		UPDATE_GLOBAL_REGS;
-		CPU_GetStatus();
-		ESC_Run(data);
-		CPU_PutStatus();
-		UPDATE_LOCAL_REGS;
-		DONE
-
-#endif /* ASAP */
-
-	OPCODE_ALIAS(02)		/* CIM [unofficial - crash intermediate] */
-	OPCODE_ALIAS(12)
-	OPCODE_ALIAS(22)
-	OPCODE_ALIAS(32)
-	OPCODE_ALIAS(42)
-	OPCODE_ALIAS(52)
-	OPCODE_ALIAS(62)
-	OPCODE_ALIAS(72)
-	OPCODE_ALIAS(92)
-	OPCODE(b2)
-
-#ifdef ASAP
-
-		ASAP_CIM();
-		DONE
-
-#else
-
-	/* OPCODE(d2) Used for ESCRTS #ab (CIM) */
-	/* OPCODE(f2) Used for ESC #ab (CIM) */
-		PC--;
-		UPDATE_GLOBAL_REGS;
-		CPU_GetStatus();
-
-#ifdef CRASH_MENU
-		UI_crash_address = GET_PC();
-		UI_crash_afterCIM = GET_PC() + 1;
-		UI_crash_code = insn;
-		UI_Run();
-#else
-		CPU_cim_encountered = TRUE;
-#ifdef LIBATARI800
-#ifdef HAVE_SETJMP
-		longjmp(libatari800_cpu_crash, LIBATARI800_CPU_CRASH);
-#endif /* HAVE_SETJMP */
-#else
-		ENTER_MONITOR;
-#endif /* LIBATARI800 */
-#endif /* CRASH_MENU */
-
-		CPU_PutStatus();
-		UPDATE_LOCAL_REGS;
-		DONE
-
-#endif /* ASAP */
-
-/* ---------------------------------------------- */
-/* ADC and SBC routines */
-
-	adc:
-		if (!(CPU_regP & CPU_D_FLAG)) {
-			/* Binary mode */
-			unsigned int tmp;
-			tmp = A + data + C;
-			C = tmp > 0xff;
-			/* C = tmp >> 8; */
-#ifndef NO_V_FLAG_VARIABLE
-			V = !((A ^ data) & 0x80) && ((data ^ tmp) & 0x80);
-#else
-			CPU_ClrV;
-			if (!((A ^ data) & 0x80) && ((data ^ tmp) & 0x80))
-				CPU_SetV;
+#ifdef MONITOR_PROFILE
+	if (MONITOR_profile_enabled)
+		return TRUE;
 #endif
-			Z = N = A = (UBYTE) tmp;
-	    }
-		else {
-			/* Decimal mode */
-			unsigned int tmp;
-			tmp = (A & 0x0f) + (data & 0x0f) + C;
-			if (tmp >= 0x0a)
-				tmp = ((tmp + 0x06) & 0x0f) + 0x10;
-			tmp += (A & 0xf0) + (data & 0xf0);
-
-			Z = A + data + C;
-			N = (UBYTE) tmp;
-#ifndef NO_V_FLAG_VARIABLE
-			V = !((A ^ data) & 0x80) && ((data ^ tmp) & 0x80);
-#else
-			CPU_ClrV;
-			if (!((A ^ data) & 0x80) && ((data ^ tmp) & 0x80))
-				CPU_SetV;
+#ifdef MONITOR_TRACE
+	if (MONITOR_trace_file != NULL)
+		return TRUE;
 #endif
+	return FALSE;
+}
 
-			if (tmp >= 0xa0)
-				tmp += 0x60;
-			C = tmp > 0xff;
-			A = (UBYTE) tmp;
-		}
-		DONE
-
-	sbc:
-		if (!(CPU_regP & CPU_D_FLAG)) {
-			/* Binary mode */
-			unsigned int tmp;
-			/* tmp = A - data - !C; */
-			tmp = A - data - 1 + C;
-			C = tmp < 0x100;
-#ifndef NO_V_FLAG_VARIABLE
-			V = ((A ^ data) & 0x80) && ((A ^ tmp) & 0x80);
-#else
-			CPU_ClrV;
-			if (((A ^ data) & 0x80) && ((A ^ tmp) & 0x80))
-				CPU_SetV;
-#endif
-			Z = N = A = (UBYTE) tmp;
-		}
-		else {
-			/* Decimal mode */
-			unsigned int tmp;
-			tmp = (A & 0x0f) - (data & 0x0f) - 1 + C;
-			if (tmp & 0x10)
-				tmp = ((tmp - 0x06) & 0x0f) - 0x10;
-			tmp += (A & 0xf0) - (data & 0xf0);
-			if (tmp & 0x100)
-				tmp -= 0x60;
-
-			Z = N = A - data - 1 + C;
-#ifndef NO_V_FLAG_VARIABLE
-			V = ((A ^ data) & 0x80) && ((A ^ Z) & 0x80);
-#else
-			CPU_ClrV;
-			if (((A ^ data) & 0x80) && ((A ^ Z) & 0x80))
-				CPU_SetV;
-#endif
-			C = ((unsigned int) (A - data - 1 + C)) <= 0xff;
+static void go_fast(int limit);
+static void go_debug(int limit);
 
-			A = tmp;
-		}
-		DONE
+#define CPU_GO_NAME  go_fast
+#define GO_FAST
+#include "cpu_go.h"
+#undef CPU_GO_NAME
+#undef GO_FAST
 
-#ifdef NO_GOTO
-	}
-#else
-	next:
+#define CPU_GO_NAME  go_debug
+#ifdef MONITOR_BREAKPOINTS
+#define GO_BREAKPOINTS
 #endif
-
 #ifdef MONITOR_PROFILE
-		{
-			int cyc = ANTIC_xpos - old_xpos;
-			MONITOR_coverage[old_PC].cycles += cyc;
-			MONITOR_coverage_cycles += cyc;
-		}
+#define GO_PROFILE
 #endif
-
-#ifdef MONITOR_BREAK
-		if (MONITOR_break_step) {
-			DO_BREAK;
-		}
+#ifdef MONITOR_TRACE
+#define GO_TRACE
 #endif
-		/* This "continue" does nothing here.
-		   But it is necessary because, if we're not using NO_GOTO nor MONITOR_BREAK,
-		   gcc can complain: "error: label at end of compound statement". */
-		continue;
+#include "cpu_go.h"
+
+void CPU_GO(int limit)
+{
+	if (debugging())
+		go_debug(limit);
+	else {
+		go_fast(limit);
+		/* The monitor switched debugging on in the middle. */
+		if (ANTIC_xpos < ANTIC_xpos_limit && debugging())
+			go_debug(limit);
 	}
+}
 
-#else /* FALCON_CPUASM */
+#else /* CPU_GO_VARIANTS */
 
-	{
-		extern void CPU_GO_m68k(void);
-		CPU_GO_m68k();
-	}
+#define CPU_GO_NAME  CPU_GO
+#include "cpu_go.h"
 
-#endif /* FALCON_CPUASM */
-	UPDATE_GLOBAL_REGS;
-}
+#endif /* CPU_GO_VARIANTS */
 
 void CPU_Reset(void)
 {
@@ -2441,6 +1226,13 @@ void CPU_Reset(void)
 	CPU_PutStatus();	/* Make sure flags are all updated */
 	CPU_regS = 0xff;
 	CPU_regPC = MEMORY_dGetWordAligned(0xfffc);
+
+#ifdef CPU_BLOCK_CACHE
+	CPU_FlushCode();
+#endif
+#if defined(IDLE_LOOPS) && !defined(FALCON_CPUASM)
+	memset(copy_no_loop, 0, sizeof(copy_no_loop));
+#endif
 }
 
 #if !defined(BASIC) && !defined(ASAP)
@@ -2477,6 +1269,10 @@ void CPU_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 	StateSav_ReadUBYTE(&CPU_IRQ, 1);
 
 	MEMORY_StateRead(SaveVerbose, StateVersion);
+#ifdef CPU_BLOCK_CACHE
+	/* delta states restore memory without the MEMORY_ macros */
+	CPU_FlushCode();
+#endif
 
 	StateSav_ReadUWORD(&CPU_regPC, 1);
 }
@@ -53,6 +53,17 @@ extern void (*CPU_rts_handler)(void);
 
 extern UBYTE CPU_cim_encountered;
 
+/* If TRUE, CPU_GO() recognises idle loops - short loops that only poll
+   memory which cannot change before CPU_GO() returns - and skips their
+   iterations in one step. The emulation is not affected. */
+extern int CPU_idle_skip;
+/* Number of CPU cycles skipped in idle loops (wraps around). */
+extern ULONG CPU_idle_cycles;
+/* If TRUE (the default), CPU_GO() recognises simple loops that copy or
+   fill memory and runs their iterations in C, with the same results and
+   cycle counts as the emulated instructions. */
+extern int CPU_fast_loops;
+
 #define CPU_REMEMBER_PC_STEPS 64
 extern UWORD CPU_remember_PC[CPU_REMEMBER_PC_STEPS];
 extern UBYTE CPU_remember_op[CPU_REMEMBER_PC_STEPS][3];
@@ -67,4 +78,15 @@ extern unsigned int CPU_remember_jmp_curpos;
 extern int CPU_instruction_count[256];
 #endif
 
+#ifdef CPU_BLOCK_CACHE
+/* Bytes and pages of memory that hold predecoded code. */
+extern UBYTE CPU_code[65536];
+extern UBYTE CPU_code_page[256];
+/* Drops the predecoded code in PAGE. CODE_MODIFIED is TRUE when the CPU's
+   own code was written to rather than replaced by a copy to memory. */
+void CPU_InvalidateCode(int page, int code_modified);
+/* Drops all predecoded code. */
+void CPU_FlushCode(void);
+#endif
+
 #endif /* CPU_H_ */
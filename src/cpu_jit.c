@@ -0,0 +1,1153 @@
+/*
+ * cpu_jit.c - translation of 6502 code to native x86-64 code
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _GNU_SOURCE /* for MAP_ANONYMOUS */
+#include "config.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "atari.h"
+#include "cpu.h"
+#include "cpu_jit.h"
+#include "log.h"
+#include "memory.h"
+
+#if !defined(__x86_64__)
+#error The JIT translates to x86-64 code only
+#endif
+#if !defined(CPU_BLOCK_CACHE)
+#error The JIT needs CPU_BLOCK_CACHE
+#endif
+#if defined(PAGED_ATTRIB) || defined(PAGED_MEM)
+#error The JIT cannot work with paged memory/attributes
+#endif
+
+int JIT_mode = JIT_OFF;
+const void *JIT_entry[65536];
+UBYTE JIT_heat[65536];
+
+#define CODE_SIZE        (4 * 1024 * 1024)
+#define MAX_BLOCK_INSNS  64
+/* Upper limit of the native code of one block. */
+#define MAX_BLOCK_CODE   (MAX_BLOCK_INSNS * 160 + 64)
+
+static UBYTE *code = NULL;
+static UBYTE *code_start;	/* after the shared stubs */
+static UBYTE *out;
+
+/* Shared stubs. */
+static void (*enter)(JIT_state_t *state, const void *native);
+static UBYTE *exit_stub;	/* returns to enter()'s caller with the 6502 PC in EAX */
+static UBYTE *chain_stub;	/* continues at the 6502 PC in EAX, or exits */
+
+/* Pages whose translations differed from the interpreter. */
+static UBYTE refused[256];
+
+/* JIT_VERIFY mode */
+static UBYTE *verify_mem = NULL;
+static UBYTE *verify_result_mem;
+static JIT_state_t verify_result;
+static UWORD verify_pc;
+static int verify_mismatches = 0;
+
+/* 6502 instructions --------------------------------------------------------- */
+
+enum {
+	K_NONE,
+	K_LDA, K_LDX, K_LDY, K_STA, K_STX, K_STY,
+	K_AND, K_ORA, K_EOR, K_ADC, K_SBC, K_CMP, K_CPX, K_CPY, K_BIT,
+	K_ASL, K_LSR, K_ROL, K_ROR, K_INC, K_DEC,
+	K_INX, K_INY, K_DEX, K_DEY,
+	K_TAX, K_TAY, K_TXA, K_TYA, K_TSX, K_TXS,
+	K_CLC, K_SEC, K_CLV, K_CLD, K_SED, K_SEI, K_NOP,
+	K_PHA, K_PLA, K_PHP,
+	K_BRANCH, K_JMP, K_JSR, K_RTS
+};
+
+enum {
+	M_IMP, M_IMM, M_ZP, M_ZPX, M_ZPY, M_ABS, M_ABSX, M_ABSY, M_INDX, M_INDY, M_REL
+};
+
+static const UBYTE mode_length[] = { 1, 2, 2, 2, 2, 3, 3, 3, 2, 2, 2 };
+
+/* The documented instructions, except those that always leave translated
+   code. Cycles are as in cpu.c, without the extra cycles for page crossing
+   and taken branches. */
+static const struct {
+	UBYTE opcode;
+	UBYTE kind;
+	UBYTE mode;
+	UBYTE cycles;
+} instructions[] = {
+	{ 0x69, K_ADC, M_IMM, 2 }, { 0x65, K_ADC, M_ZP, 3 }, { 0x75, K_ADC, M_ZPX, 4 }, { 0x6d, K_ADC, M_ABS, 4 },
+	{ 0x7d, K_ADC, M_ABSX, 4 }, { 0x79, K_ADC, M_ABSY, 4 }, { 0x61, K_ADC, M_INDX, 6 }, { 0x71, K_ADC, M_INDY, 5 },
+	{ 0x29, K_AND, M_IMM, 2 }, { 0x25, K_AND, M_ZP, 3 }, { 0x35, K_AND, M_ZPX, 4 }, { 0x2d, K_AND, M_ABS, 4 },
+	{ 0x3d, K_AND, M_ABSX, 4 }, { 0x39, K_AND, M_ABSY, 4 }, { 0x21, K_AND, M_INDX, 6 }, { 0x31, K_AND, M_INDY, 5 },
+	{ 0x0a, K_ASL, M_IMP, 2 }, { 0x06, K_ASL, M_ZP, 5 }, { 0x16, K_ASL, M_ZPX, 6 }, { 0x0e, K_ASL, M_ABS, 6 },
+	{ 0x1e, K_ASL, M_ABSX, 7 },
+	{ 0x10, K_BRANCH, M_REL, 2 }, { 0x30, K_BRANCH, M_REL, 2 }, { 0x50, K_BRANCH, M_REL, 2 }, { 0x70, K_BRANCH, M_REL, 2 },
+	{ 0x90, K_BRANCH, M_REL, 2 }, { 0xb0, K_BRANCH, M_REL, 2 }, { 0xd0, K_BRANCH, M_REL, 2 }, { 0xf0, K_BRANCH, M_REL, 2 },
+	{ 0x24, K_BIT, M_ZP, 3 }, { 0x2c, K_BIT, M_ABS, 4 },
+	{ 0x18, K_CLC, M_IMP, 2 }, { 0xd8, K_CLD, M_IMP, 2 }, { 0xb8, K_CLV, M_IMP, 2 },
+	{ 0x38, K_SEC, M_IMP, 2 }, { 0xf8, K_SED, M_IMP, 2 }, { 0x78, K_SEI, M_IMP, 2 }, { 0xea, K_NOP, M_IMP, 2 },
+	{ 0xc9, K_CMP, M_IMM, 2 }, { 0xc5, K_CMP, M_ZP, 3 }, { 0xd5, K_CMP, M_ZPX, 4 }, { 0xcd, K_CMP, M_ABS, 4 },
+	{ 0xdd, K_CMP, M_ABSX, 4 }, { 0xd9, K_CMP, M_ABSY, 4 }, { 0xc1, K_CMP, M_INDX, 6 }, { 0xd1, K_CMP, M_INDY, 5 },
+	{ 0xe0, K_CPX, M_IMM, 2 }, { 0xe4, K_CPX, M_ZP, 3 }, { 0xec, K_CPX, M_ABS, 4 },
+	{ 0xc0, K_CPY, M_IMM, 2 }, { 0xc4, K_CPY, M_ZP, 3 }, { 0xcc, K_CPY, M_ABS, 4 },
+	{ 0xc6, K_DEC, M_ZP, 5 }, { 0xd6, K_DEC, M_ZPX, 6 }, { 0xce, K_DEC, M_ABS, 6 }, { 0xde, K_DEC, M_ABSX, 7 },
+	{ 0xe6, K_INC, M_ZP, 5 }, { 0xf6, K_INC, M_ZPX, 6 }, { 0xee, K_INC, M_ABS, 6 }, { 0xfe, K_INC, M_ABSX, 7 },
+	{ 0xca, K_DEX, M_IMP, 2 }, { 0x88, K_DEY, M_IMP, 2 }, { 0xe8, K_INX, M_IMP, 2 }, { 0xc8, K_INY, M_IMP, 2 },
+	{ 0x49, K_EOR, M_IMM, 2 }, { 0x45, K_EOR, M_ZP, 3 }, { 0x55, K_EOR, M_ZPX, 4 }, { 0x4d, K_EOR, M_ABS, 4 },
+	{ 0x5d, K_EOR, M_ABSX, 4 }, { 0x59, K_EOR, M_ABSY, 4 }, { 0x41, K_EOR, M_INDX, 6 }, { 0x51, K_EOR, M_INDY, 5 },
+	{ 0x4c, K_JMP, M_ABS, 3 }, { 0x20, K_JSR, M_ABS, 6 }, { 0x60, K_RTS, M_IMP, 6 },
+	{ 0xa9, K_LDA, M_IMM, 2 }, { 0xa5, K_LDA, M_ZP, 3 }, { 0xb5, K_LDA, M_ZPX, 4 }, { 0xad, K_LDA, M_ABS, 4 },
+	{ 0xbd, K_LDA, M_ABSX, 4 }, { 0xb9, K_LDA, M_ABSY, 4 }, { 0xa1, K_LDA, M_INDX, 6 }, { 0xb1, K_LDA, M_INDY, 5 },
+	{ 0xa2, K_LDX, M_IMM, 2 }, { 0xa6, K_LDX, M_ZP, 3 }, { 0xb6, K_LDX, M_ZPY, 4 }, { 0xae, K_LDX, M_ABS, 4 },
+	{ 0xbe, K_LDX, M_ABSY, 4 },
+	{ 0xa0, K_LDY, M_IMM, 2 }, { 0xa4, K_LDY, M_ZP, 3 }, { 0xb4, K_LDY, M_ZPX, 4 }, { 0xac, K_LDY, M_ABS, 4 },
+	{ 0xbc, K_LDY, M_ABSX, 4 },
+	{ 0x4a, K_LSR, M_IMP, 2 }, { 0x46, K_LSR, M_ZP, 5 }, { 0x56, K_LSR, M_ZPX, 6 }, { 0x4e, K_LSR, M_ABS, 6 },
+	{ 0x5e, K_LSR, M_ABSX, 7 },
+	{ 0x09, K_ORA, M_IMM, 2 }, { 0x05, K_ORA, M_ZP, 3 }, { 0x15, K_ORA, M_ZPX, 4 }, { 0x0d, K_ORA, M_ABS, 4 },
+	{ 0x1d, K_ORA, M_ABSX, 4 }, { 0x19, K_ORA, M_ABSY, 4 }, { 0x01, K_ORA, M_INDX, 6 }, { 0x11, K_ORA, M_INDY, 5 },
+	{ 0x48, K_PHA, M_IMP, 3 }, { 0x08, K_PHP, M_IMP, 3 }, { 0x68, K_PLA, M_IMP, 4 },
+	{ 0x2a, K_ROL, M_IMP, 2 }, { 0x26, K_ROL, M_ZP, 5 }, { 0x36, K_ROL, M_ZPX, 6 }, { 0x2e, K_ROL, M_ABS, 6 },
+	{ 0x3e, K_ROL, M_ABSX, 7 },
+	{ 0x6a, K_ROR, M_IMP, 2 }, { 0x66, K_ROR, M_ZP, 5 }, { 0x76, K_ROR, M_ZPX, 6 }, { 0x6e, K_ROR, M_ABS, 6 },
+	{ 0x7e, K_ROR, M_ABSX, 7 },
+	{ 0xe9, K_SBC, M_IMM, 2 }, { 0xe5, K_SBC, M_ZP, 3 }, { 0xf5, K_SBC, M_ZPX, 4 }, { 0xed, K_SBC, M_ABS, 4 },
+	{ 0xfd, K_SBC, M_ABSX, 4 }, { 0xf9, K_SBC, M_ABSY, 4 }, { 0xe1, K_SBC, M_INDX, 6 }, { 0xf1, K_SBC, M_INDY, 5 },
+	{ 0x85, K_STA, M_ZP, 3 }, { 0x95, K_STA, M_ZPX, 4 }, { 0x8d, K_STA, M_ABS, 4 }, { 0x9d, K_STA, M_ABSX, 5 },
+	{ 0x99, K_STA, M_ABSY, 5 }, { 0x81, K_STA, M_INDX, 6 }, { 0x91, K_STA, M_INDY, 6 },
+	{ 0x86, K_STX, M_ZP, 3 }, { 0x96, K_STX, M_ZPY, 4 }, { 0x8e, K_STX, M_ABS, 4 },
+	{ 0x84, K_STY, M_ZP, 3 }, { 0x94, K_STY, M_ZPX, 4 }, { 0x8c, K_STY, M_ABS, 4 },
+	{ 0xaa, K_TAX, M_IMP, 2 }, { 0xa8, K_TAY, M_IMP, 2 }, { 0xba, K_TSX, M_IMP, 2 },
+	{ 0x8a, K_TXA, M_IMP, 2 }, { 0x9a, K_TXS, M_IMP, 2 }, { 0x98, K_TYA, M_IMP, 2 }
+};
+
+static UBYTE op_kind[256];
+static UBYTE op_mode[256];
+static UBYTE op_cycles[256];
+
+static int reads_memory(int kind)
+{
+	switch (kind) {
+	case K_LDA: case K_LDX: case K_LDY:
+	case K_AND: case K_ORA: case K_EOR: case K_ADC: case K_SBC:
+	case K_CMP: case K_CPX: case K_CPY: case K_BIT:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static int ends_block(int kind)
+{
+	return kind == K_JMP || kind == K_JSR || kind == K_RTS;
+}
+
+static int is_rmw(int kind)
+{
+	return kind == K_ASL || kind == K_LSR || kind == K_ROL || kind == K_ROR
+		|| kind == K_INC || kind == K_DEC;
+}
+
+/* x86-64 code generation ---------------------------------------------------- */
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+#define NONE  -1
+
+/* Register assignment in translated code. All 6502 registers are kept
+   zero-extended to 32 bits. */
+#define R_STATE   RDI	/* JIT_state_t *, holds the flags */
+#define R_MEM     RBX	/* MEMORY_mem */
+#define R_ATTRIB  RBP	/* MEMORY_attrib */
+#define R_CODE    R12	/* CPU_code */
+#define R_DIRTY   R13	/* MEMORY_dirty */
+#define R_ENTRY   R14	/* JIT_entry */
+#define R_LIMIT   R15	/* ANTIC_xpos_limit */
+#define R_XPOS    RSI	/* ANTIC_xpos */
+#define R_A       R8
+#define R_X       R9
+#define R_Y       R10
+#define R_S       R11
+
+/* Condition codes */
+#define CC_B   0x2
+#define CC_AE  0x3
+#define CC_E   0x4
+#define CC_NE  0x5
+#define CC_A   0x7
+#define CC_GE  0xd
+
+/* Opcodes with a ModRM operand; two-byte ones have the 0x0f in the high byte. */
+#define OP_ADD     0x03
+#define OP_OR      0x0b
+#define OP_AND     0x23
+#define OP_SUB     0x2b
+#define OP_XOR     0x33
+#define OP_CMP     0x3b
+#define OP_OR_M8   0x08	/* or r/m8, r8 */
+#define OP_ST8     0x88
+#define OP_ST32    0x89
+#define OP_LD32    0x8b
+#define OP_LEA     0x8d
+#define OP_TEST    0x85
+#define OP_MOVZX8  0x0fb6
+#define OP_MOVZX16 0x0fb7
+
+/* Extensions of the 0x80, 0x81 and 0xc1 groups */
+#define EXT_ADD  0
+#define EXT_OR   1
+#define EXT_AND  4
+#define EXT_SUB  5
+#define EXT_XOR  6
+#define EXT_CMP  7
+#define EXT_SHL  4
+#define EXT_SHR  5
+
+#define OFFSET(field)  ((int) offsetof(JIT_state_t, field))
+
+static void emit(int b)
+{
+	*out++ = (UBYTE) b;
+}
+
+static void emit32(int v)
+{
+	emit(v);
+	emit(v >> 8);
+	emit(v >> 16);
+	emit(v >> 24);
+}
+
+static void emit64(const void *p)
+{
+	unsigned long v = (unsigned long) p;
+	emit32((int) v);
+	emit32((int) (v >> 32));
+}
+
+static void rex(int w, int reg, int index, int base)
+{
+	int r = (w ? 8 : 0) | (reg >= 8 ? 4 : 0) | (index >= 8 ? 2 : 0) | (base >= 8 ? 1 : 0);
+	if (r != 0)
+		emit(0x40 | r);
+}
+
+static void opcode(int op)
+{
+	if (op > 0xff)
+		emit(op >> 8);
+	emit(op & 0xff);
+}
+
+/* [BASE + INDEX * 2^SCALE + DISP], always with a 32-bit displacement */
+static void modrm_mem(int reg, int base, int index, int scale, int disp)
+{
+	if (index == NONE) {
+		emit(0x80 | ((reg & 7) << 3) | (base & 7));
+		if ((base & 7) == RSP)
+			emit(0x24);
+	}
+	else {
+		emit(0x84 | ((reg & 7) << 3));
+		emit((scale << 6) | ((index & 7) << 3) | (base & 7));
+	}
+	emit32(disp);
+}
+
+/* OP reg, [base + index + disp] (or the other direction, as OP says) */
+static void op_mem(int w, int op, int reg, int base, int index, int disp)
+{
+	rex(w, reg, index == NONE ? 0 : index, base);
+	opcode(op);
+	modrm_mem(reg, base, index, 0, disp);
+}
+
+/* OP reg, rm */
+static void op_reg(int op, int reg, int rm)
+{
+	rex(0, reg, 0, rm);
+	opcode(op);
+	emit(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* OP (group 0x81) reg, imm32 */
+static void op_imm(int ext, int reg, int imm)
+{
+	rex(0, 0, 0, reg);
+	emit(0x81);
+	emit(0xc0 | (ext << 3) | (reg & 7));
+	emit32(imm);
+}
+
+/* OP byte [base + index + disp], imm8, for OP 0x80 (group), 0xc6 (mov), 0xf6 (test) */
+static void op_mem_imm8(int op, int ext, int base, int index, int disp, int imm)
+{
+	rex(0, 0, index == NONE ? 0 : index, base);
+	emit(op);
+	modrm_mem(ext, base, index, 0, disp);
+	emit(imm);
+}
+
+static void shift(int ext, int reg, int n)
+{
+	rex(0, 0, 0, reg);
+	emit(0xc1);
+	emit(0xc0 | (ext << 3) | (reg & 7));
+	emit(n);
+}
+
+static void mov_imm(int reg, int imm)
+{
+	rex(0, 0, 0, reg);
+	emit(0xb8 | (reg & 7));
+	emit32(imm);
+}
+
+static void mov_imm64(int reg, const void *p)
+{
+	rex(1, 0, 0, reg);
+	emit(0xb8 | (reg & 7));
+	emit64(p);
+}
+
+/* setcc byte [R_STATE + disp] */
+static void setcc_state(int cc, int disp)
+{
+	emit(0x0f);
+	emit(0x90 | cc);
+	modrm_mem(0, R_STATE, NONE, 0, disp);
+}
+
+/* setcc reg8 (RAX..RDX only) */
+static void setcc_reg(int cc, int reg)
+{
+	emit(0x0f);
+	emit(0x90 | cc);
+	emit(0xc0 | reg);
+}
+
+/* Emits a jump with a 32-bit displacement and returns the location of the
+   displacement. */
+static UBYTE *jcc(int cc)
+{
+	emit(0x0f);
+	emit(0x80 | cc);
+	emit32(0);
+	return out - 4;
+}
+
+static UBYTE *jmp(void)
+{
+	emit(0xe9);
+	emit32(0);
+	return out - 4;
+}
+
+static void patch(UBYTE *rel, const UBYTE *target)
+{
+	int d = (int) (target - (rel + 4));
+	memcpy(rel, &d, 4);
+}
+
+static void push(int reg)
+{
+	rex(0, 0, 0, reg);
+	emit(0x50 | (reg & 7));
+}
+
+static void pop(int reg)
+{
+	rex(0, 0, 0, reg);
+	emit(0x58 | (reg & 7));
+}
+
+/* Stores a byte register to a JIT_state_t field. */
+static void store_state(int reg, int disp)
+{
+	op_mem(0, OP_ST8, reg, R_STATE, NONE, disp);
+}
+
+static void load_state(int reg, int disp)
+{
+	op_mem(0, OP_MOVZX8, reg, R_STATE, NONE, disp);
+}
+
+/* Memory operand at a 6502 address: EA if known at translation time,
+   otherwise the address in EAX. */
+static void op_ea(int op, int reg, int base, int ea)
+{
+	if (ea >= 0)
+		op_mem(0, op, reg, base, NONE, ea);
+	else
+		op_mem(0, op, reg, base, RAX, 0);
+}
+
+static void op_ea_imm8(int op, int ext, int base, int ea, int imm)
+{
+	if (ea >= 0)
+		op_mem_imm8(op, ext, base, NONE, ea, imm);
+	else
+		op_mem_imm8(op, ext, base, RAX, 0, imm);
+}
+
+static void set_nz(int reg)
+{
+	store_state(reg, OFFSET(n));
+	store_state(reg, OFFSET(z));
+}
+
+/* REG = (UBYTE) REG */
+static void zero_extend(int reg)
+{
+	op_reg(OP_MOVZX8, reg, reg);
+}
+
+static void push_byte(int reg)
+{
+	op_mem(0, OP_ST8, reg, R_MEM, R_S, 0x100);
+	op_imm(EXT_SUB, R_S, 1);
+	zero_extend(R_S);
+}
+
+static void push_imm(int imm)
+{
+	op_mem_imm8(0xc6, 0, R_MEM, R_S, 0x100, imm);
+	op_imm(EXT_SUB, R_S, 1);
+	zero_extend(R_S);
+}
+
+static void pull_byte(int reg)
+{
+	op_imm(EXT_ADD, R_S, 1);
+	zero_extend(R_S);
+	op_mem(0, OP_MOVZX8, reg, R_MEM, R_S, 0x100);
+}
+
+static void generate_stubs(void)
+{
+	static const int saved[] = { RBX, RBP, R12, R13, R14, R15 };
+	int i;
+
+	/* void enter(JIT_state_t *state, const void *native) */
+	memcpy(&enter, &out, sizeof(enter));	/* ISO C has no cast from data to function pointers */
+	for (i = 0; i < 6; i++)
+		push(saved[i]);
+	rex(1, 0, 0, RAX);
+	emit(0x8b);
+	emit(0xc6);		/* mov rax, rsi */
+	mov_imm64(R_MEM, MEMORY_mem);
+	mov_imm64(R_ATTRIB, MEMORY_attrib);
+	mov_imm64(R_CODE, CPU_code);
+	mov_imm64(R_DIRTY, MEMORY_dirty);
+	mov_imm64(R_ENTRY, JIT_entry);
+	op_mem(0, OP_LD32, R_XPOS, R_STATE, NONE, OFFSET(xpos));
+	op_mem(0, OP_LD32, R_LIMIT, R_STATE, NONE, OFFSET(xpos_limit));
+	load_state(R_A, OFFSET(a));
+	load_state(R_X, OFFSET(x));
+	load_state(R_Y, OFFSET(y));
+	load_state(R_S, OFFSET(s));
+	emit(0xff);
+	emit(0xe0);		/* jmp rax */
+
+	exit_stub = out;
+	emit(0x66);
+	op_mem(0, OP_ST32, RAX, R_STATE, NONE, OFFSET(pc));
+	op_mem(0, OP_ST32, R_XPOS, R_STATE, NONE, OFFSET(xpos));
+	store_state(R_A, OFFSET(a));
+	store_state(R_X, OFFSET(x));
+	store_state(R_Y, OFFSET(y));
+	store_state(R_S, OFFSET(s));
+	for (i = 5; i >= 0; i--)
+		pop(saved[i]);
+	emit(0xc3);		/* ret */
+
+	chain_stub = out;
+	/* mov rcx, [R_ENTRY + rax * 8] */
+	rex(1, RCX, RAX, R_ENTRY);
+	emit(0x8b);
+	modrm_mem(RCX, R_ENTRY, RAX, 3, 0);
+	rex(1, RCX, 0, RCX);
+	emit(OP_TEST);
+	emit(0xc9);		/* test rcx, rcx */
+	patch(jcc(CC_E), exit_stub);
+	emit(0xff);
+	emit(0xe1);		/* jmp rcx */
+
+	code_start = out;
+}
+
+/* Translation --------------------------------------------------------------- */
+
+typedef struct {
+	UWORD pc;
+	UBYTE op;
+	UWORD operand;
+	UBYTE *native;
+} insn_t;
+
+static insn_t insns[MAX_BLOCK_INSNS];
+static int n_insns;
+
+/* Jumps to be patched: to the exit of instruction INSN (TARGET < 0), or to
+   the instruction at 6502 address TARGET. */
+static struct {
+	UBYTE *rel;
+	int insn;
+	int target;
+} fixups[MAX_BLOCK_INSNS * 6];
+static int n_fixups;
+
+static void exit_if(int cc, int insn)
+{
+	fixups[n_fixups].rel = jcc(cc);
+	fixups[n_fixups].insn = insn;
+	fixups[n_fixups].target = -1;
+	n_fixups++;
+}
+
+static int find_insn(int pc)
+{
+	int i;
+	for (i = 0; i < n_insns; i++)
+		if (insns[i].pc == pc)
+			return i;
+	return -1;
+}
+
+/* Continues at 6502 address TARGET. */
+static void jump_to(UWORD target)
+{
+	int i = find_insn(target);
+	if (i >= 0) {
+		fixups[n_fixups].rel = jmp();
+		fixups[n_fixups].insn = i;
+		fixups[n_fixups].target = target;
+		n_fixups++;
+	}
+	else {
+		mov_imm(RAX, target);
+		patch(jmp(), chain_stub);
+	}
+}
+
+/* Checks for a write of the instruction at EA (EAX if -1). */
+static void check_write(int i, int mode, int ea)
+{
+	if (mode != M_ZP && mode != M_ZPX) {
+		op_ea_imm8(0x80, EXT_CMP, R_ATTRIB, ea, MEMORY_RAM);
+		exit_if(CC_NE, i);
+	}
+	op_ea_imm8(0x80, EXT_CMP, R_CODE, ea, 0);
+	exit_if(CC_NE, i);
+}
+
+/* Stores the byte in REG at EA (EAX if -1). */
+static void store(int reg, int ea)
+{
+	op_ea(OP_ST8, reg, R_MEM, ea);
+	if (ea >= 0)
+		op_mem_imm8(0xc6, 0, R_DIRTY, NONE, ea >> 8, MEMORY_DIRTY_ALL);
+	else {
+		op_reg(OP_LD32, RDX, RAX);
+		shift(EXT_SHR, RDX, 8);
+		op_mem_imm8(0xc6, 0, R_DIRTY, RDX, 0, MEMORY_DIRTY_ALL);
+	}
+}
+
+/* ASL, LSR, ROL, ROR, INC, DEC of REG, using RDX. */
+static void modify(int kind, int reg)
+{
+	switch (kind) {
+	case K_ASL:
+		op_reg(OP_LD32, RDX, reg);
+		shift(EXT_SHR, RDX, 7);
+		store_state(RDX, OFFSET(c));
+		shift(EXT_SHL, reg, 1);
+		break;
+	case K_LSR:
+		op_reg(OP_LD32, RDX, reg);
+		op_imm(EXT_AND, RDX, 1);
+		store_state(RDX, OFFSET(c));
+		shift(EXT_SHR, reg, 1);
+		break;
+	case K_ROL:
+		load_state(RDX, OFFSET(c));
+		shift(EXT_SHL, reg, 1);
+		op_reg(OP_OR, reg, RDX);
+		op_reg(OP_LD32, RDX, reg);
+		shift(EXT_SHR, RDX, 8);
+		store_state(RDX, OFFSET(c));
+		break;
+	case K_ROR:
+		load_state(RDX, OFFSET(c));
+		shift(EXT_SHL, RDX, 8);
+		op_reg(OP_OR, reg, RDX);
+		op_reg(OP_LD32, RDX, reg);
+		op_imm(EXT_AND, RDX, 1);
+		store_state(RDX, OFFSET(c));
+		shift(EXT_SHR, reg, 1);
+		break;
+	case K_INC:
+		op_imm(EXT_ADD, reg, 1);
+		break;
+	case K_DEC:
+		op_imm(EXT_SUB, reg, 1);
+		break;
+	}
+	zero_extend(reg);
+	set_nz(reg);
+}
+
+static void translate_insn(int i)
+{
+	UWORD pc = insns[i].pc;
+	int op = insns[i].op;
+	int kind = op_kind[op];
+	int mode = op_mode[op];
+	int operand = insns[i].operand;
+	int ea = -1;
+	int penalty = FALSE;
+	int reg;
+
+	insns[i].native = out;
+
+	op_reg(OP_CMP, R_XPOS, R_LIMIT);
+	exit_if(CC_GE, i);
+
+	/* Effective address, and in EDX the extra cycle for crossing a page */
+	switch (mode) {
+	case M_ZP:
+		ea = operand & 0xff;
+		break;
+	case M_ABS:
+		ea = operand;
+		break;
+	case M_ZPX:
+	case M_ZPY:
+		op_mem(0, OP_LEA, RAX, mode == M_ZPX ? R_X : R_Y, NONE, operand & 0xff);
+		zero_extend(RAX);
+		break;
+	case M_ABSX:
+	case M_ABSY:
+		reg = mode == M_ABSX ? R_X : R_Y;
+		op_mem(0, OP_LEA, RAX, reg, NONE, operand);
+		op_reg(OP_MOVZX16, RAX, RAX);
+		if (reads_memory(kind) && (operand & 0xff) != 0) {
+			op_mem(0, OP_LEA, RDX, reg, NONE, operand & 0xff);
+			shift(EXT_SHR, RDX, 8);
+			penalty = TRUE;
+		}
+		break;
+	case M_INDX:
+		op_mem(0, OP_LEA, RAX, R_X, NONE, operand & 0xff);
+		zero_extend(RAX);
+		op_mem(0, OP_MOVZX16, RAX, R_MEM, RAX, 0);
+		break;
+	case M_INDY:
+		op_mem(0, OP_MOVZX16, RCX, R_MEM, NONE, operand & 0xff);
+		if (reads_memory(kind)) {
+			op_reg(OP_MOVZX8, RDX, RCX);
+			op_reg(OP_ADD, RDX, R_Y);
+			shift(EXT_SHR, RDX, 8);
+			penalty = TRUE;
+		}
+		op_mem(0, OP_LEA, RAX, RCX, R_Y, 0);
+		op_reg(OP_MOVZX16, RAX, RAX);
+		break;
+	default:
+		break;
+	}
+
+	/* Conditions for leaving translated code */
+	if (reads_memory(kind) && mode != M_IMM && mode != M_ZP && mode != M_ZPX) {
+		op_ea_imm8(0x80, EXT_CMP, R_ATTRIB, ea, MEMORY_HARDWARE);
+		exit_if(CC_E, i);
+	}
+	if (kind == K_STA || kind == K_STX || kind == K_STY || (is_rmw(kind) && mode != M_IMP))
+		check_write(i, mode, ea);
+	if (kind == K_ADC || kind == K_SBC) {
+		op_mem_imm8(0xf6, 0, R_STATE, NONE, OFFSET(p), CPU_D_FLAG);
+		exit_if(CC_NE, i);
+	}
+	if (kind == K_RTS) {
+		mov_imm64(RCX, &CPU_rts_handler);
+		rex(1, 0, 0, RCX);
+		emit(0x83);
+		modrm_mem(EXT_CMP, RCX, NONE, 0, 0);
+		emit(0);
+		exit_if(CC_NE, i);
+	}
+
+	/* From here on the instruction is executed */
+	if (JIT_mode == JIT_VERIFY) {
+		emit(0xff);
+		modrm_mem(0, R_STATE, NONE, 0, OFFSET(insns));	/* inc dword */
+	}
+	op_imm(EXT_ADD, R_XPOS, op_cycles[op]);
+	if (penalty)
+		op_reg(OP_ADD, R_XPOS, RDX);
+
+	/* The operand in ECX */
+	if (reads_memory(kind) || is_rmw(kind)) {
+		if (mode == M_IMM)
+			mov_imm(RCX, operand & 0xff);
+		else if (mode != M_IMP)
+			op_ea(OP_MOVZX8, RCX, R_MEM, ea);
+	}
+
+	switch (kind) {
+	case K_LDA:
+	case K_LDX:
+	case K_LDY:
+		reg = kind == K_LDA ? R_A : kind == K_LDX ? R_X : R_Y;
+		op_reg(OP_LD32, reg, RCX);
+		set_nz(reg);
+		break;
+	case K_STA:
+	case K_STX:
+	case K_STY:
+		store(kind == K_STA ? R_A : kind == K_STX ? R_X : R_Y, ea);
+		break;
+	case K_AND:
+	case K_ORA:
+	case K_EOR:
+		op_reg(kind == K_AND ? OP_AND : kind == K_ORA ? OP_OR : OP_XOR, R_A, RCX);
+		set_nz(R_A);
+		break;
+	case K_CMP:
+	case K_CPX:
+	case K_CPY:
+		reg = kind == K_CMP ? R_A : kind == K_CPX ? R_X : R_Y;
+		op_reg(OP_CMP, reg, RCX);
+		setcc_state(CC_AE, OFFSET(c));
+		op_reg(OP_LD32, RAX, reg);
+		op_reg(OP_SUB, RAX, RCX);
+		set_nz(RAX);
+		break;
+	case K_BIT:
+		store_state(RCX, OFFSET(n));
+		op_reg(OP_LD32, RAX, RCX);
+		op_imm(EXT_AND, RAX, 0x40);
+		store_state(RAX, OFFSET(v));
+		op_mem_imm8(0x80, EXT_AND, R_STATE, NONE, OFFSET(p), 0xbf);
+		op_mem(0, OP_OR_M8, RAX, R_STATE, NONE, OFFSET(p));
+		op_reg(OP_LD32, RAX, R_A);
+		op_reg(OP_AND, RAX, RCX);
+		store_state(RAX, OFFSET(z));
+		break;
+	case K_ADC:
+		/* tmp = A + data + C */
+		load_state(RAX, OFFSET(c));
+		op_reg(OP_ADD, RAX, R_A);
+		op_reg(OP_ADD, RAX, RCX);
+		op_imm(EXT_CMP, RAX, 0xff);
+		setcc_state(CC_A, OFFSET(c));
+		/* V = !((A ^ data) & 0x80) && ((data ^ tmp) & 0x80) */
+		op_reg(OP_LD32, RDX, R_A);
+		op_reg(OP_XOR, RDX, RCX);
+		op_imm(EXT_XOR, RDX, -1);
+		op_reg(OP_XOR, RCX, RAX);
+		op_reg(OP_AND, RDX, RCX);
+		shift(EXT_SHR, RDX, 7);
+		op_imm(EXT_AND, RDX, 1);
+		store_state(RDX, OFFSET(v));
+		op_reg(OP_MOVZX8, R_A, RAX);
+		set_nz(R_A);
+		break;
+	case K_SBC:
+		/* tmp = A - data - 1 + C */
+		load_state(RAX, OFFSET(c));
+		op_reg(OP_ADD, RAX, R_A);
+		op_reg(OP_SUB, RAX, RCX);
+		op_imm(EXT_SUB, RAX, 1);
+		op_imm(EXT_CMP, RAX, 0x100);
+		setcc_state(CC_B, OFFSET(c));
+		/* V = ((A ^ data) & 0x80) && ((A ^ tmp) & 0x80) */
+		op_reg(OP_LD32, RDX, R_A);
+		op_reg(OP_XOR, RDX, RCX);
+		op_reg(OP_LD32, RCX, R_A);
+		op_reg(OP_XOR, RCX, RAX);
+		op_reg(OP_AND, RDX, RCX);
+		shift(EXT_SHR, RDX, 7);
+		op_imm(EXT_AND, RDX, 1);
+		store_state(RDX, OFFSET(v));
+		op_reg(OP_MOVZX8, R_A, RAX);
+		set_nz(R_A);
+		break;
+	case K_ASL:
+	case K_LSR:
+	case K_ROL:
+	case K_ROR:
+	case K_INC:
+	case K_DEC:
+		if (mode == M_IMP)
+			modify(kind, R_A);
+		else {
+			modify(kind, RCX);
+			store(RCX, ea);
+		}
+		break;
+	case K_INX:
+	case K_INY:
+	case K_DEX:
+	case K_DEY:
+		reg = kind == K_INX || kind == K_DEX ? R_X : R_Y;
+		op_imm(kind == K_INX || kind == K_INY ? EXT_ADD : EXT_SUB, reg, 1);
+		zero_extend(reg);
+		set_nz(reg);
+		break;
+	case K_TAX:
+		op_reg(OP_LD32, R_X, R_A);
+		set_nz(R_X);
+		break;
+	case K_TAY:
+		op_reg(OP_LD32, R_Y, R_A);
+		set_nz(R_Y);
+		break;
+	case K_TXA:
+		op_reg(OP_LD32, R_A, R_X);
+		set_nz(R_A);
+		break;
+	case K_TYA:
+		op_reg(OP_LD32, R_A, R_Y);
+		set_nz(R_A);
+		break;
+	case K_TSX:
+		op_reg(OP_LD32, R_X, R_S);
+		set_nz(R_X);
+		break;
+	case K_TXS:
+		op_reg(OP_LD32, R_S, R_X);
+		break;
+	case K_CLC:
+	case K_SEC:
+		op_mem_imm8(0xc6, 0, R_STATE, NONE, OFFSET(c), kind == K_SEC);
+		break;
+	case K_CLV:
+		op_mem_imm8(0xc6, 0, R_STATE, NONE, OFFSET(v), 0);
+		op_mem_imm8(0x80, EXT_AND, R_STATE, NONE, OFFSET(p), 0xff & ~CPU_V_FLAG);
+		break;
+	case K_CLD:
+		op_mem_imm8(0x80, EXT_AND, R_STATE, NONE, OFFSET(p), 0xff & ~CPU_D_FLAG);
+		break;
+	case K_SED:
+		op_mem_imm8(0x80, EXT_OR, R_STATE, NONE, OFFSET(p), CPU_D_FLAG);
+		break;
+	case K_SEI:
+		op_mem_imm8(0x80, EXT_OR, R_STATE, NONE, OFFSET(p), CPU_I_FLAG);
+		break;
+	case K_NOP:
+		break;
+	case K_PHA:
+		push_byte(R_A);
+		break;
+	case K_PLA:
+		pull_byte(R_A);
+		set_nz(R_A);
+		break;
+	case K_PHP:
+		/* (N & 0x80) + (V ? 0x40 : 0) + (P & 0x3c) + (Z == 0 ? 0x02 : 0) + C */
+		load_state(RAX, OFFSET(n));
+		op_imm(EXT_AND, RAX, 0x80);
+		load_state(RCX, OFFSET(p));
+		op_imm(EXT_AND, RCX, 0x3c);
+		op_reg(OP_OR, RAX, RCX);
+		load_state(RCX, OFFSET(c));
+		op_reg(OP_OR, RAX, RCX);
+		op_mem_imm8(0x80, EXT_CMP, R_STATE, NONE, OFFSET(v), 0);
+		setcc_reg(CC_NE, RCX);
+		zero_extend(RCX);
+		shift(EXT_SHL, RCX, 6);
+		op_reg(OP_OR, RAX, RCX);
+		op_mem_imm8(0x80, EXT_CMP, R_STATE, NONE, OFFSET(z), 0);
+		setcc_reg(CC_E, RCX);
+		zero_extend(RCX);
+		shift(EXT_SHL, RCX, 1);
+		op_reg(OP_OR, RAX, RCX);
+		push_byte(RAX);
+		break;
+	case K_BRANCH:
+		{
+			UWORD next = pc + 2;
+			UWORD target = next + (SBYTE) operand;
+			int taken;
+			UBYTE *skip;
+			switch (op) {
+			case 0x10: /* BPL */
+			case 0x30: /* BMI */
+				op_mem_imm8(0xf6, 0, R_STATE, NONE, OFFSET(n), 0x80);
+				taken = op == 0x10 ? CC_E : CC_NE;
+				break;
+			case 0x50: /* BVC */
+			case 0x70: /* BVS */
+				op_mem_imm8(0x80, EXT_CMP, R_STATE, NONE, OFFSET(v), 0);
+				taken = op == 0x50 ? CC_E : CC_NE;
+				break;
+			case 0x90: /* BCC */
+			case 0xb0: /* BCS */
+				op_mem_imm8(0x80, EXT_CMP, R_STATE, NONE, OFFSET(c), 0);
+				taken = op == 0x90 ? CC_E : CC_NE;
+				break;
+			default: /* BNE, BEQ */
+				op_mem_imm8(0x80, EXT_CMP, R_STATE, NONE, OFFSET(z), 0);
+				taken = op == 0xd0 ? CC_NE : CC_E;
+				break;
+			}
+			skip = jcc(taken ^ 1);
+			op_imm(EXT_ADD, R_XPOS, ((target ^ next) & 0xff00) ? 2 : 1);
+			jump_to(target);
+			patch(skip, out);
+		}
+		break;
+	case K_JMP:
+		jump_to((UWORD) operand);
+		break;
+	case K_JSR:
+		push_imm((pc + 2) >> 8);
+		push_imm((pc + 2) & 0xff);
+		jump_to((UWORD) operand);
+		break;
+	case K_RTS:
+		pull_byte(RAX);
+		pull_byte(RCX);
+		shift(EXT_SHL, RCX, 8);
+		op_reg(OP_OR, RAX, RCX);
+		op_imm(EXT_ADD, RAX, 1);
+		op_reg(OP_MOVZX16, RAX, RAX);
+		patch(jmp(), chain_stub);
+		break;
+	}
+}
+
+void JIT_InvalidatePage(int page)
+{
+	memset(JIT_entry + (page << 8), 0, 256 * sizeof(JIT_entry[0]));
+}
+
+void JIT_Flush(void)
+{
+	memset(JIT_entry, 0, sizeof(JIT_entry));
+	if (code != NULL)
+		out = code_start;
+}
+
+int JIT_Translate(UWORD pc)
+{
+	int page = pc >> 8;
+	UWORD start = pc;
+	int i;
+
+	if (JIT_mode == JIT_OFF || refused[page])
+		return FALSE;
+	if (out + MAX_BLOCK_CODE > code + CODE_SIZE)
+		JIT_Flush();
+
+	/* Decode the block */
+	n_insns = 0;
+	while (n_insns < MAX_BLOCK_INSNS) {
+		int op = MEMORY_dGetByte(pc);
+		int kind = op_kind[op];
+		int len = mode_length[op_mode[op]];
+		if (kind == K_NONE || (pc & 0xff) + len > 0x100)
+			break;
+		insns[n_insns].pc = pc;
+		insns[n_insns].op = op;
+		insns[n_insns].operand = MEMORY_dGetByte((UWORD) (pc + 1)) + (MEMORY_dGetByte((UWORD) (pc + 2)) << 8);
+		/* Hardware registers accessed by absolute address always leave
+		   translated code; let the interpreter start there. */
+		if (op_mode[op] == M_ABS && kind != K_JMP && kind != K_JSR
+		    && MEMORY_attrib[insns[n_insns].operand] == MEMORY_HARDWARE)
+			break;
+		n_insns++;
+		pc += len;
+		if (ends_block(kind) || (pc & 0xff) == 0)
+			break;
+	}
+	if (n_insns == 0)
+		return FALSE;
+
+	/* Generate code */
+	n_fixups = 0;
+	for (i = 0; i < n_insns; i++)
+		translate_insn(i);
+	if (!ends_block(op_kind[insns[n_insns - 1].op]))
+		jump_to(pc);
+
+	/* Exits, and jumps forward inside the block */
+	for (i = 0; i < n_insns; i++) {
+		UBYTE *stub = NULL;
+		int j;
+		for (j = 0; j < n_fixups; j++) {
+			if (fixups[j].insn != i)
+				continue;
+			if (fixups[j].target >= 0)
+				patch(fixups[j].rel, insns[i].native);
+			else {
+				if (stub == NULL) {
+					stub = out;
+					mov_imm(RAX, insns[i].pc);
+					patch(jmp(), exit_stub);
+				}
+				patch(fixups[j].rel, stub);
+			}
+		}
+	}
+
+	for (i = 0; i < n_insns; i++)
+		memset(CPU_code + insns[i].pc, 1, mode_length[op_mode[insns[i].op]]);
+	CPU_code_page[page] = 1;
+	JIT_entry[start] = insns[0].native;
+	return TRUE;
+}
+
+int JIT_Run(JIT_state_t *state)
+{
+	JIT_state_t before;
+
+	if (JIT_mode != JIT_VERIFY) {
+		enter(state, JIT_entry[state->pc]);
+		return 0;
+	}
+	before = *state;
+	memcpy(verify_mem, MEMORY_mem, 65536);
+	state->insns = 0;
+	enter(state, JIT_entry[state->pc]);
+	verify_result = *state;
+	memcpy(verify_result_mem, MEMORY_mem, 65536);
+	memcpy(MEMORY_mem, verify_mem, 65536);
+	*state = before;
+	verify_pc = before.pc;
+	return verify_result.insns;
+}
+
+static int packed_flags(const JIT_state_t *state)
+{
+	return (state->n & 0x80) + (state->v ? 0x40 : 0) + (state->p & 0x3c)
+		+ (state->z == 0 ? 0x02 : 0) + state->c;
+}
+
+void JIT_VerifyEnd(const JIT_state_t *state, int missing)
+{
+	const JIT_state_t *r = &verify_result;
+	int addr;
+
+	if (missing == 0 && state->pc == r->pc && state->a == r->a && state->x == r->x
+	    && state->y == r->y && state->s == r->s && state->xpos == r->xpos
+	    && packed_flags(state) == packed_flags(r)
+	    && memcmp(MEMORY_mem, verify_result_mem, 65536) == 0)
+		return;
+
+	verify_mismatches++;
+	Log_print("JIT: translated code at %04X differs from the interpreter", verify_pc);
+	if (missing != 0)
+		Log_print("JIT:   the interpreter stopped %d instructions early", missing);
+	Log_print("JIT:   interpreter PC=%04X A=%02X X=%02X Y=%02X S=%02X P=%02X xpos=%d",
+		state->pc, state->a, state->x, state->y, state->s, packed_flags(state), state->xpos);
+	Log_print("JIT:   translated  PC=%04X A=%02X X=%02X Y=%02X S=%02X P=%02X xpos=%d",
+		r->pc, r->a, r->x, r->y, r->s, packed_flags(r), r->xpos);
+	for (addr = 0; addr < 65536; addr++)
+		if (MEMORY_mem[addr] != verify_result_mem[addr]) {
+			Log_print("JIT:   memory at %04X: %02X instead of %02X", addr, verify_result_mem[addr], MEMORY_mem[addr]);
+			break;
+		}
+	refused[verify_pc >> 8] = TRUE;
+	JIT_InvalidatePage(verify_pc >> 8);
+}
+
+int JIT_SetMode(int mode)
+{
+	if (mode != JIT_OFF && code == NULL) {
+		int i;
+		void *p = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			Log_print("JIT: cannot allocate memory for translated code");
+			return FALSE;
+		}
+		code = out = (UBYTE *) p;
+		generate_stubs();
+		for (i = 0; i < (int) (sizeof(instructions) / sizeof(instructions[0])); i++) {
+			op_kind[instructions[i].opcode] = instructions[i].kind;
+			op_mode[instructions[i].opcode] = instructions[i].mode;
+			op_cycles[instructions[i].opcode] = instructions[i].cycles;
+		}
+	}
+	if (mode == JIT_VERIFY && verify_mem == NULL) {
+		verify_mem = (UBYTE *) malloc(2 * 65536);
+		if (verify_mem == NULL)
+			return FALSE;
+		verify_result_mem = verify_mem + 65536;
+	}
+	if (mode != JIT_mode) {
+		/* translated code depends on the mode */
+		JIT_mode = mode;
+		JIT_Flush();
+		memset(refused, 0, sizeof(refused));
+	}
+	return TRUE;
+}
+
+int JIT_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	int mode = JIT_mode;
+
+	for (i = j = 1; i < *argc; i++) {
+		if (strcmp(argv[i], "-jit") == 0)
+			mode = JIT_ON;
+		else if (strcmp(argv[i], "-jit-verify") == 0)
+			mode = JIT_VERIFY;
+		else if (strcmp(argv[i], "-nojit") == 0)
+			mode = JIT_OFF;
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-jit             Translate hot 6502 code to native code");
+				Log_print("\t-jit-verify      Translate 6502 code and check it against the interpreter");
+				Log_print("\t-nojit           Interpret all 6502 code");
+			}
+			argv[j++] = argv[i];
+		}
+	}
+	*argc = j;
+
+	return JIT_SetMode(mode);
+}
+
+void JIT_Exit(void)
+{
+	if (verify_mismatches > 0)
+		Log_print("JIT: %d translated blocks differed from the interpreter", verify_mismatches);
+	if (code != NULL) {
+		munmap(code, CODE_SIZE);
+		code = NULL;
+	}
+	free(verify_mem);
+	verify_mem = NULL;
+	JIT_mode = JIT_OFF;
+	memset(JIT_entry, 0, sizeof(JIT_entry));
+}
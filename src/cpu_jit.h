@@ -0,0 +1,83 @@
+#ifndef CPU_JIT_H_
+#define CPU_JIT_H_
+
+#include "config.h"
+#include "atari.h"
+
+/* Translation of hot 6502 code to native x86-64 code.
+
+   CPU_GO() counts how often each block of the predecoded block cache is
+   entered. After JIT_THRESHOLD entries the block is translated: its
+   instructions become native code that keeps the 6502 registers in host
+   registers, counts cycles inline and jumps directly to other translated
+   blocks. Translated code never calls back into the emulator. It returns to
+   CPU_GO() before an instruction it cannot run itself: one that accesses
+   hardware registers, writes to ROM or to code, ADC/SBC in decimal mode, RTS
+   with CPU_rts_handler set, or one reaching ANTIC_xpos_limit. Instructions
+   that are never translated (BRK, RTI, CLI, PLP, JMP (abcd), ESC traps and
+   undocumented opcodes) end a block. CPU_GO() interprets the instruction and
+   looks for translated code again afterwards.
+
+   In JIT_VERIFY mode each run of translated code is undone and repeated by
+   the interpreter, and the resulting registers, cycle counter and memory are
+   compared. Blocks that disagree are reported and not translated again. */
+
+#define JIT_OFF     0
+#define JIT_ON      1
+#define JIT_VERIFY  2
+
+/* Number of entries to a block before it is translated. */
+#define JIT_THRESHOLD  16
+
+extern int JIT_mode;
+
+/* The 6502 state as kept by CPU_GO(); the flags are in the form used by
+   cpu.c. */
+typedef struct {
+	int xpos;
+	int xpos_limit;
+	int insns;		/* instructions run, in JIT_VERIFY mode */
+	UWORD pc;
+	UBYTE a;
+	UBYTE x;
+	UBYTE y;
+	UBYTE s;
+	UBYTE n;
+	UBYTE z;
+	UBYTE c;
+	UBYTE v;
+	UBYTE p;
+} JIT_state_t;
+
+/* Translated code for each 6502 address, NULL if none. */
+extern const void *JIT_entry[65536];
+/* Number of times CPU_GO() entered a block at each address (modulo 256). */
+extern UBYTE JIT_heat[65536];
+
+int JIT_Initialise(int *argc, char *argv[]);
+void JIT_Exit(void);
+
+/* Switches between JIT_OFF, JIT_ON and JIT_VERIFY. Returns FALSE if the
+   translator is not available. */
+int JIT_SetMode(int mode);
+
+/* Translates the code at PC. Returns FALSE if the code cannot be
+   translated. */
+int JIT_Translate(UWORD pc);
+
+/* Runs translated code from STATE->pc, updating STATE. In JIT_VERIFY mode
+   STATE and memory are restored afterwards and the number of instructions
+   the interpreter has to repeat is returned; otherwise 0 is returned. */
+int JIT_Run(JIT_state_t *state);
+
+/* Compares STATE, reached by the interpreter after repeating a run of
+   translated code, with the result of the translated code. MISSING is the
+   number of instructions the interpreter did not get to. */
+void JIT_VerifyEnd(const JIT_state_t *state, int missing);
+
+/* Drops the translated code of blocks starting in PAGE. */
+void JIT_InvalidatePage(int page);
+/* Drops all translated code. */
+void JIT_Flush(void);
+
+#endif /* CPU_JIT_H_ */
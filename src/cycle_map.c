@@ -25,14 +25,14 @@
 #include <stdio.h>
 #include "cycle_map.h"
 
-int CYCLE_MAP_cpu2antic[CYCLE_MAP_SIZE * (17 * 7 + 1)];
-int CYCLE_MAP_antic2cpu[CYCLE_MAP_SIZE * (17 * 7 + 1)];
+SBYTE CYCLE_MAP_cpu2antic[CYCLE_MAP_SIZE * (17 * 7 + 1)];
+SBYTE CYCLE_MAP_antic2cpu[CYCLE_MAP_SIZE * (17 * 7 + 1)];
 static void try_all_scroll(int md, int use_char_index,
-	int use_font, int use_bitmap, int *cpu2antic, int *antic2cpu);
+	int use_font, int use_bitmap, SBYTE *cpu2antic, SBYTE *antic2cpu);
 static void antic_steal_map(int width, int md, int scroll_offset, int use_char_index,
-	int use_font, int use_bitmap, char *antic_cycles, int *cpucycles,
-	int *actualcycles);
-static void cpu_cycle_map(char *antic_cycles_orig, int *cpu_cycles, int *actual_cycles);
+	int use_font, int use_bitmap, char *antic_cycles, SBYTE *cpucycles,
+	SBYTE *actualcycles);
+static void cpu_cycle_map(char *antic_cycles_orig, SBYTE *cpu_cycles, SBYTE *actual_cycles);
 
 #undef TEST_CYCLE_MAP
 #ifdef TEST_CYCLE_MAP
@@ -43,7 +43,7 @@ int main()
 };
 #endif
 
-static void cpu_cycle_map(char *antic_cycles_orig, int *cpu_cycles, int *actual_cycles)
+static void cpu_cycle_map(char *antic_cycles_orig, SBYTE *cpu_cycles, SBYTE *actual_cycles)
 {
 	int i;
 	char antic_cycles[CYCLE_MAP_SIZE];
@@ -70,8 +70,8 @@ void CYCLE_MAP_Create(void)
 {
 #ifdef TEST_CYCLE_MAP
 	int i, j;
-	int *cpu_cycles;
-	int *actual_cycles;
+	SBYTE *cpu_cycles;
+	SBYTE *actual_cycles;
 #endif
 	char antic_cycles[115];
 	int k = 0;
@@ -103,7 +103,7 @@ void CYCLE_MAP_Create(void)
 }
 
 static void try_all_scroll(int md, int use_char_index,
-	int use_font, int use_bitmap, int *cpu2antic, int *antic2cpu)
+	int use_font, int use_bitmap, SBYTE *cpu2antic, SBYTE *antic2cpu)
 {
 	char antic_cycles[115];
 	int width;
@@ -126,8 +126,8 @@ static void try_all_scroll(int md, int use_char_index,
 }
 
 static void antic_steal_map(int width, int md, int scroll_offset, int use_char_index,
-	int use_font, int use_bitmap, char *antic_cycles, int *cpu_cycles,
-	int *actual_cycles)
+	int use_font, int use_bitmap, char *antic_cycles, SBYTE *cpu_cycles,
+	SBYTE *actual_cycles)
 {
 	int char_start;
 	int bitmap_start;
@@ -29,6 +29,7 @@
 #include "devices.h"
 #include "esc.h"
 #include "log.h"
+#include "mathpack.h"
 #include "memory.h"
 #include "pia.h"
 #include "sio.h"
@@ -164,6 +165,7 @@ void ESC_Run(UBYTE esc_code)
 void ESC_PatchOS(void)
 {
 	int patched = Devices_PatchOS();
+	MATHPACK_PatchOS();
 	if (ESC_enable_sio_patch) {
 		UWORD addr_l;
 		UWORD addr_s;
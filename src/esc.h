@@ -32,6 +32,16 @@ enum ESC_t {
 	/* Atari executable loader. */
 	ESC_BINLOADER_CONT,
 
+	/* Floating point package. */
+	ESC_AFP = 0x90,
+	ESC_FASC = 0x91,
+	ESC_IFP = 0x92,
+	ESC_FPI = 0x93,
+	ESC_FSUB = 0x94,
+	ESC_FADD = 0x95,
+	ESC_FMUL = 0x96,
+	ESC_FDIV = 0x97,
+
 	/* Cassette emulation. */
 	ESC_COPENLOAD = 0xa8,
 	ESC_COPENSAVE = 0xa9,
@@ -125,6 +125,13 @@ static int cx85_port = 1;
 static int max_scanline_counter;
 static int scanline_counter;
 
+/* State of the previous frame, used by INPUT_Frame to detect changes */
+static int last_key_code = AKEY_NONE;
+static int last_key_break = 0;
+static UBYTE last_stick[4] = {INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE};
+static int last_mouse_buttons = 0;
+static int bit5_5200 = 0;
+
 #ifdef EVENT_RECORDING
 static gzFile recordfp = NULL; /*output file for input recording*/
 static gzFile playbackfp = NULL; /*input file for playback*/
@@ -424,10 +431,6 @@ static UBYTE mouse_step(void)
 void INPUT_Frame(void)
 {
 	int i;
-	static int last_key_code = AKEY_NONE;
-	static int last_key_break = 0;
-	static UBYTE last_stick[4] = {INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE};
-	static int last_mouse_buttons = 0;
 
 	scanline_counter = 10000;	/* do nothing in INPUT_Scanline() */
 
@@ -504,7 +507,6 @@ void INPUT_Frame(void)
 		/* Bit 5 is different for each keypress because it is one
 		 * of the missing lines. */
 		if (Atari800_machine_type == Atari800_MACHINE_5200) {
-			static int bit5_5200 = 0;
 			if (bit5_5200) {
 				INPUT_key_code &= ~0x20;
 			}
@@ -975,6 +977,30 @@ void INPUT_Scanline(void)
 	}
 }
 
+#ifdef LIBATARI800
+void INPUT_SaveContext(INPUT_context_t *context)
+{
+	context->last_key_code = last_key_code;
+	context->last_key_break = last_key_break;
+	memcpy(context->last_stick, last_stick, sizeof(last_stick));
+	context->last_mouse_buttons = last_mouse_buttons;
+	context->bit5_5200 = bit5_5200;
+	context->mouse_x = mouse_x;
+	context->mouse_y = mouse_y;
+}
+
+void INPUT_RestoreContext(const INPUT_context_t *context)
+{
+	last_key_code = context->last_key_code;
+	last_key_break = context->last_key_break;
+	memcpy(last_stick, context->last_stick, sizeof(last_stick));
+	last_mouse_buttons = context->last_mouse_buttons;
+	bit5_5200 = context->bit5_5200;
+	mouse_x = context->mouse_x;
+	mouse_y = context->mouse_y;
+}
+#endif /* LIBATARI800 */
+
 void INPUT_SelectMultiJoy(int no)
 {
 	no &= 3;
@@ -1038,6 +1064,7 @@ void INPUT_DrawMousePointer(void)
 				if (y <= 117)
 					PLOT(0, 2);
 			}
+			ANTIC_RedrawLines(2 * y - 4, 2 * y + 5);
 		}
 	}
 }
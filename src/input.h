@@ -90,4 +90,20 @@ int INPUT_Playingback(void);
 void INPUT_RecordInt(int i);
 int INPUT_PlaybackInt(void);
 
+#ifdef LIBATARI800
+/* Per-machine input state kept between frames, used to switch machines. */
+typedef struct {
+	int last_key_code;
+	int last_key_break;
+	UBYTE last_stick[4];
+	int last_mouse_buttons;
+	int bit5_5200;
+	int mouse_x;
+	int mouse_y;
+} INPUT_context_t;
+
+void INPUT_SaveContext(INPUT_context_t *context);
+void INPUT_RestoreContext(const INPUT_context_t *context);
+#endif /* LIBATARI800 */
+
 #endif /* INPUT_H_ */
@@ -38,6 +38,7 @@
 #include "cpu.h"
 #include "platform.h"
 #include "memory.h"
+#include "rewind.h"
 #include "screen.h"
 #include "sio.h"
 #include "../sound.h"
@@ -58,6 +59,9 @@ jmp_buf libatari800_cpu_crash;
 /* global variable indicating that BRK instruction should exit emulation */
 int libatari800_continue_on_brk = 0;
 
+/* identifies the current base snapshot for delta states, 0 if none */
+static ULONG delta_base_id = 0;
+
 /* global variable indicating last error code */
 int libatari800_error_code;
 
@@ -189,24 +193,8 @@ void libatari800_clear_input_array(input_template_t *input)
 }
 
 
-/** Perform one video frame's worth of emulation
- * 
- * This is the main driver for libatari800. This function runs the emulator for enough
- * CPU cycles to produce one video frame's worth of emulation. Results of the frame
- * can be retrieved using the \a libatari800_get_* functions.
- * 
- * @param input input template structure defining the user input for the frame
- * 
- * @retval 0 successfully emulated frame
- * @retval 1 unidentified cartridge type
- * @retval 2 CPU crash
- * @retval 3 BRK instruction encountered
- * @retval 4 display list error
- * @retval 5 entered self-test mode
- * @retval 6 entered Memo Pad
- * @retval 7 encountered invalid escape opcode
- */
-int libatari800_next_frame(input_template_t *input)
+/* Emulate one frame and set libatari800_error_code */
+static void run_frame(input_template_t *input, int draw_display, int update_sound)
 {
 	LIBATARI800_Input_array = input;
 	INPUT_key_code = PLATFORM_Keyboard();
@@ -220,7 +208,7 @@ int libatari800_next_frame(input_template_t *input)
 #endif /* HAVE_SETJMP */
 	{
 		/* normal operation */
-		LIBATARI800_Frame();
+		LIBATARI800_Frame(draw_display, update_sound);
 		if (CPU_cim_encountered) {
 			libatari800_error_code = LIBATARI800_CPU_CRASH;
 		}
@@ -228,11 +216,82 @@ int libatari800_next_frame(input_template_t *input)
 			libatari800_error_code = LIBATARI800_DLIST_ERROR;
 		}
 	}
+}
+
+
+/** Perform one video frame's worth of emulation
+ * 
+ * This is the main driver for libatari800. This function runs the emulator for enough
+ * CPU cycles to produce one video frame's worth of emulation. Results of the frame
+ * can be retrieved using the \a libatari800_get_* functions.
+ * 
+ * @param input input template structure defining the user input for the frame
+ * 
+ * @retval 0 successfully emulated frame
+ * @retval 1 unidentified cartridge type
+ * @retval 2 CPU crash
+ * @retval 3 BRK instruction encountered
+ * @retval 4 display list error
+ * @retval 5 entered self-test mode
+ * @retval 6 entered Memo Pad
+ * @retval 7 encountered invalid escape opcode
+ */
+int libatari800_next_frame(input_template_t *input)
+{
+	run_frame(input, TRUE, TRUE);
 	PLATFORM_DisplayScreen();
 	return !libatari800_error_code;
 }
 
 
+/** Perform several video frames' worth of emulation
+ * 
+ * Runs up to \a n frames in a single call, which is much faster than calling
+ * \a libatari800_next_frame repeatedly when only every Nth frame is of interest.
+ * The display is drawn only for the last frame; for the other frames ANTIC only
+ * computes player/missile collisions, and only if the ACCURATE_SKIPPED_FRAMES
+ * configuration option is set.
+ * 
+ * Emulation stops at the first frame that results in an error other than
+ * \a LIBATARI800_DLIST_ERROR, which is common while the machine boots.
+ * The frame that stops emulation early is not drawn, because an error is
+ * only known once its frame has run: the screen then still shows the last
+ * frame drawn by an earlier call.
+ * 
+ * @param n number of frames to emulate
+ * @param inputs array of \a n input template structures, one for each frame, or
+ * a single structure if \a LIBATARI800_RUN_REPEAT_INPUT is set in \a flags
+ * @param flags combination of \a LIBATARI800_RUN_REPEAT_INPUT (use the same
+ * input for all frames) and \a LIBATARI800_RUN_SKIP_SOUND (generate audio for
+ * the last frame only)
+ * @param status if not NULL, array of \a n ints that receives the return code of
+ * each frame emulated, using the values documented for \a libatari800_next_frame
+ * 
+ * @returns number of frames emulated; less than \a n if emulation was stopped
+ * by an error
+ */
+int libatari800_run_frames(int n, const input_template_t *inputs, int flags, int *status)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int last = i == n - 1;
+		input_template_t *input = (input_template_t *)
+			((flags & LIBATARI800_RUN_REPEAT_INPUT) ? inputs : &inputs[i]);
+
+		run_frame(input, last, last || !(flags & LIBATARI800_RUN_SKIP_SOUND));
+		if (status)
+			status[i] = libatari800_error_code;
+		if (libatari800_error_code && libatari800_error_code != LIBATARI800_DLIST_ERROR) {
+			i++;
+			break;
+		}
+	}
+	PLATFORM_DisplayScreen();
+	return i;
+}
+
+
 /** Use disk image in a disk drive
  * 
  * Insert a virtual floppy image into one of the emulated disk drives. Currently
@@ -318,6 +377,49 @@ UBYTE *libatari800_get_screen_ptr()
 }
 
 
+/** Register a buffer that receives every frame in a chosen format
+ *
+ * After each drawn frame, the area of the screen starting at \a x, \a y
+ * with size \a width by \a height is converted and written directly into
+ * \a buffer, so the caller needs no separate copy or conversion pass. The
+ * area may also be downscaled by integer factors: each output pixel is the
+ * average of \a scale_x by \a scale_y screen pixels (for palette indices,
+ * the top left one).
+ *
+ * Colors are taken from the current palette. A typical call, exporting the
+ * visible 336x240 area as RGB at half resolution, is
+ * \code{c}
+ * libatari800_set_observation(buf, LIBATARI800_OBS_RGB24, 24, 0, 336, 240, 2, 2);
+ * \endcode
+ *
+ * LIBATARI800_OBS_XRGB32 is written by the emulated ANTIC itself, each
+ * scanline as soon as it is drawn, instead of in a pass over the finished
+ * frame. It needs a 4-byte aligned \a buffer and no downscaling. Scanlines
+ * that have not changed since the previous frame (see the -linecache
+ * option) are not written again, so the buffer must not be modified by
+ * the caller between frames.
+ *
+ * @param buffer destination, or NULL to stop exporting
+ * @param format one of LIBATARI800_OBS_PALETTE (8-bit palette index),
+ * LIBATARI800_OBS_RGB24, LIBATARI800_OBS_RGBA32 (R, G, B, 255 byte order),
+ * LIBATARI800_OBS_LUMINANCE (8-bit) or LIBATARI800_OBS_XRGB32 (32-bit
+ * 0x00RRGGBB values in native byte order, see below)
+ * @param x left edge of the area, 0 - 383
+ * @param y top edge of the area, 0 - 239
+ * @param width width of the area
+ * @param height height of the area
+ * @param scale_x horizontal downscale factor, 1 for none
+ * @param scale_y vertical downscale factor, 1 for none
+ *
+ * @returns number of bytes written to \a buffer per frame, or 0 if the
+ * parameters are invalid (which also stops exporting)
+ */
+int libatari800_set_observation(UBYTE *buffer, int format, int x, int y, int width, int height, int scale_x, int scale_y)
+{
+	return LIBATARI800_Video_SetObservation(&LIBATARI800_observation, buffer, format, x, y, width, height, scale_x, scale_y);
+}
+
+
 /** Return pointer to sound data
  *
  * If sound is used, each emulated frame will fill the sound buffer with samples
@@ -388,6 +490,54 @@ int libatari800_get_sound_sample_size() {
 }
 
 
+/** Turn the POKEY sound engine off or back on
+ *
+ * In silent mode the sound buffer is filled with silence and no time is spent
+ * synthesizing audio. POKEY timers, interrupts and serial I/O are emulated as
+ * usual, so programs run exactly as they do with sound. This is the same as
+ * the -silent command line option, and is useful for headless runs where
+ * nobody listens to the audio.
+ *
+ * When silent mode is turned off, the sound engine is reset and starts
+ * playing whatever the current POKEY registers describe.
+ *
+ * @param silent if True, stop generating audio
+ */
+void libatari800_set_sound_silent(int silent) {
+	Sound_SetSilent(silent);
+}
+
+
+/** Turn skipping of idle loops on or off
+ *
+ * Many programs wait for the vertical blank or a key press in short loops
+ * that read the same memory locations over and over. With idle skipping the
+ * CPU emulation recognises such loops and skips the iterations that cannot
+ * end differently before the next interrupt, instead of emulating each of
+ * them. The emulated machine behaves exactly the same; only less host CPU
+ * time is used. This is the same as the -idleskip command line option.
+ *
+ * @param skip if True, skip idle loops
+ */
+void libatari800_set_idle_skip(int skip) {
+	CPU_idle_skip = skip;
+}
+
+
+/** Return the number of CPU cycles skipped in idle loops
+ *
+ * The count covers all emulation done by this process and wraps around after
+ * 2^32 cycles, so it is meant to be compared between frames; for example the
+ * difference after one frame divided by the number of CPU cycles per frame
+ * tells how idle the emulated program is.
+ *
+ * @returns the number of skipped cycles
+ */
+ULONG libatari800_get_idle_cycles(void) {
+	return CPU_idle_cycles;
+}
+
+
 /** Return the video frame rate
  *
  * It is important to note that libatari800 can run as fast as the host computer will
@@ -454,6 +604,7 @@ void libatari800_get_current_state(emulator_state_t *state)
 {
 	LIBATARI800_StateSave(state->state, &state->tags);
 	state->flags.selftest_enabled = MEMORY_selftest_enabled;
+	state->flags.delta = FALSE;
 	state->flags.nframes = (ULONG)Atari800_nframes;
 	state->flags.sample_residual = (ULONG)(0xffffffff * sample_residual);
 }
@@ -479,6 +630,126 @@ void libatari800_restore_state(emulator_state_t *state)
 }
 
 
+/** Use the current state as the base for delta states
+ *
+ * Record the contents of all emulated RAM (base memory, extended XE, Axlon
+ * and Mosaic banks and RAM hidden under ROMs) as the base snapshot for \a
+ * libatari800_get_delta_state. From then on, writes are tracked per 256-byte
+ * page so that a delta state only needs to hold the pages that differ from
+ * the base snapshot, plus the (small) state of the CPU and custom chips.
+ *
+ * Calling this again replaces the base snapshot and invalidates all delta
+ * states taken relative to the previous one.
+ */
+void libatari800_set_delta_base(void)
+{
+	MEMORY_DeltaBase();
+	delta_base_id++;
+}
+
+
+/** Save a delta state of the emulator
+ *
+ * Like \a libatari800_get_current_state, but only the memory pages that differ
+ * from the base snapshot set by \a libatari800_set_delta_base are saved, so
+ * the state is usually only a few kilobytes. The \a cpu, \a pc, \a antic, \a
+ * gtia, \a pia and \a pokey tags are valid, \a base_ram and \a
+ * base_ram_attrib are set to zero because memory is saved as a list of pages.
+ *
+ * @param state pointer to an already allocated \a emulator_state_t structure
+ *
+ * @returns FALSE if no base snapshot has been set or the state does not fit
+ * into \a state, TRUE otherwise.
+ */
+int libatari800_get_delta_state(emulator_state_t *state)
+{
+	if (delta_base_id == 0)
+		return FALSE;
+	if (!LIBATARI800_StateSaveDelta(state->state, STATESAV_MAX_SIZE, &state->tags))
+		return FALSE;
+	state->tags.base_ram = 0;
+	state->tags.base_ram_attrib = 0;
+	state->flags.selftest_enabled = MEMORY_selftest_enabled;
+	state->flags.delta = TRUE;
+	state->flags.nframes = (ULONG)Atari800_nframes;
+	state->flags.sample_residual = (ULONG)(0xffffffff * sample_residual);
+	state->flags.delta_base = delta_base_id;
+	return TRUE;
+}
+
+
+/** Restore a delta state of the emulator
+ *
+ * Return the emulator to a state saved by \a libatari800_get_delta_state.
+ * Only the pages written since the base snapshot and the pages held in \a
+ * state are copied. The base snapshot must be the same one that was current
+ * when the delta state was saved.
+ *
+ * @param state pointer to a delta state
+ *
+ * @returns FALSE if \a state is not a delta state of the current base
+ * snapshot, TRUE otherwise.
+ */
+int libatari800_restore_delta_state(emulator_state_t *state)
+{
+	if (!state->flags.delta || state->flags.delta_base != delta_base_id || delta_base_id == 0)
+		return FALSE;
+	if (!LIBATARI800_StateLoadDelta(state->state, STATESAV_MAX_SIZE))
+		return FALSE;
+	MEMORY_selftest_enabled = state->flags.selftest_enabled;
+	Atari800_nframes = state->flags.nframes;
+	sample_residual = (double)state->flags.sample_residual / (double)0xffffffff;
+	return TRUE;
+}
+
+
+/** Configure the rewind history
+ *
+ * Set the amount of memory used to record the emulator state for \a
+ * libatari800_rewind, and how often the state is recorded. Each recorded
+ * state is stored as the difference to the one recorded after it, usually a
+ * few kilobytes. When the memory is used up, the oldest states are dropped.
+ * The same settings are available as the \a -rewind and \a -rewind-interval
+ * arguments of \a libatari800_init. The history recorded so far is dropped.
+ *
+ * @param size memory used by the history in kilobytes, 0 to stop recording
+ *
+ * @param interval number of frames between two recorded states
+ */
+void libatari800_set_rewind(int size, int interval)
+{
+	REWIND_SetBuffer(size, interval);
+}
+
+
+/** Step the emulator back in time
+ *
+ * Return the emulator to a state recorded before. The first step goes back to
+ * the most recently recorded state, unless the emulator is still in it; every
+ * further step goes back by the interval set with \a libatari800_set_rewind.
+ * States stepped over are removed from the history.
+ *
+ * @param steps number of recorded states to go back
+ *
+ * @returns number of steps taken, which is less than \a steps if the history
+ * is shorter
+ */
+int libatari800_rewind(int steps)
+{
+	return REWIND_Back(steps);
+}
+
+
+/** Get the length of the rewind history
+ *
+ * @returns the number of steps \a libatari800_rewind can currently take
+ */
+int libatari800_get_rewind_steps(void)
+{
+	return REWIND_Available();
+}
+
+
 /** Free resources used by the emulator.
  *
  * Release any memory or other resources used by the emulator. Further calls to
@@ -488,6 +759,8 @@ void libatari800_restore_state(emulator_state_t *state)
  */
 void libatari800_exit() {
 	Atari800_Exit(0);
+	MEMORY_DeltaFree();
+	delta_base_id = 0;
 }
 
 /*
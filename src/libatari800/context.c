@@ -0,0 +1,415 @@
+/*
+ * libatari800/context.c - Atari800 as a library - multiple emulated machines
+ *
+ * Copyright (C) 2001-2021 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* Atari800 includes */
+#include "antic.h"
+#include "atari.h"
+#include "akey.h"
+#include "binload.h"
+#include "cpu.h"
+#include "../input.h"
+#include "memory.h"
+#include "rewind.h"
+#include "screen.h"
+#include "util.h"
+#include "libatari800/init.h"
+#include "libatari800/sound.h"
+#include "libatari800/statesav.h"
+#include "libatari800/video.h"
+
+/* The emulator core keeps the machine in global variables, so only one
+   machine can be "resident" at a time. Every other context keeps its machine
+   parked in a verbose state save buffer, and is swapped in when it is used.
+   As long as a single context is being stepped, no swapping takes place.
+
+   The screen buffer is owned by the context and handed to ANTIC while the
+   context is resident, so the pointer returned by
+   libatari800_ctx_get_screen_ptr never changes. */
+
+struct libatari800_ctx {
+	/* parked machine state */
+	UBYTE *state;
+	ULONG state_size;
+	statesav_tags_t tags;
+	int selftest_enabled;
+	int nframes;
+	double sample_residual;
+	int cim_encountered;
+	BINLOAD_context_t binload;
+	INPUT_context_t input;
+	LIBATARI800_observation_t observation;
+
+	int error_code;
+
+	UBYTE screen[Screen_HEIGHT * Screen_WIDTH];
+	UBYTE *sound;
+	unsigned int sound_size;
+	unsigned int sound_len;
+};
+
+/* the context whose machine currently lives in the global variables */
+static libatari800_ctx_t *resident = NULL;
+
+/* screen buffer allocated by Screen_Initialise, restored when no context is
+   resident so the non-context API and Atari800_Exit see their own buffer */
+static ULONG *host_screen = NULL;
+
+/* loader state of a machine that is not loading any file */
+static const BINLOAD_context_t binload_idle = {NULL, FALSE, 0, FALSE, FALSE, 0, 0, 0, FALSE, TRUE};
+
+/* input state of a machine that has not seen any input yet */
+static const INPUT_context_t input_idle = {
+	AKEY_NONE, 0,
+	{INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE},
+	0, 0, 0, 0
+};
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t ctx_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define CTX_LOCK() pthread_mutex_lock(&ctx_mutex)
+#define CTX_UNLOCK() pthread_mutex_unlock(&ctx_mutex)
+#else
+#define CTX_LOCK()
+#define CTX_UNLOCK()
+#endif
+
+/* Move the resident machine into its context's state buffer. */
+static void park_resident(void)
+{
+	libatari800_ctx_t *ctx = resident;
+
+	if (ctx == NULL)
+		return;
+	while (!LIBATARI800_StateSaveSized(ctx->state, ctx->state_size, &ctx->tags, TRUE)) {
+		ctx->state_size *= 2;
+		ctx->state = Util_realloc(ctx->state, ctx->state_size);
+	}
+	ctx->selftest_enabled = MEMORY_selftest_enabled;
+	ctx->nframes = Atari800_nframes;
+	ctx->sample_residual = sample_residual;
+	ctx->cim_encountered = CPU_cim_encountered;
+	BINLOAD_SaveContext(&ctx->binload);
+	BINLOAD_RestoreContext(&binload_idle);
+	INPUT_SaveContext(&ctx->input);
+	INPUT_RestoreContext(&input_idle);
+	ctx->observation = LIBATARI800_observation;
+	LIBATARI800_observation.buffer = NULL;
+	Screen_atari = host_screen;
+	resident = NULL;
+	/* the rewind history belongs to the machine that has just been parked */
+	REWIND_Clear();
+}
+
+/* Make the machine of ctx the one the emulator core operates on. */
+static void make_resident(libatari800_ctx_t *ctx)
+{
+	if (resident == ctx)
+		return;
+	park_resident();
+	LIBATARI800_StateLoadSized(ctx->state, ctx->state_size);
+	MEMORY_selftest_enabled = ctx->selftest_enabled;
+	Atari800_nframes = ctx->nframes;
+	sample_residual = ctx->sample_residual;
+	CPU_cim_encountered = ctx->cim_encountered;
+	BINLOAD_RestoreContext(&ctx->binload);
+	INPUT_RestoreContext(&ctx->input);
+	LIBATARI800_observation = ctx->observation;
+	libatari800_error_code = ctx->error_code;
+	Screen_atari = (ULONG *) ctx->screen;
+	resident = ctx;
+}
+
+
+/** Create a new emulated machine
+ *
+ * Initializes a new, independent emulated machine using the supplied
+ * argument list, in the same way as \a libatari800_init. Any number of
+ * contexts may exist at the same time, and they may be used from different
+ * threads. Calls on different contexts are serialized internally; a single
+ * context must not be used from two threads at once.
+ *
+ * Everything that is part of the emulator state (machine type, TV mode, RAM,
+ * hardware registers, cartridge, disk images) belongs to the context. Settings
+ * outside of the emulated machine, like ROM paths and the audio output format,
+ * are shared by all contexts and taken from the most recent call to
+ * \a libatari800_ctx_new or \a libatari800_init.
+ *
+ * The non-context functions must not be used while any context exists, and
+ * all contexts must be freed before calling \a libatari800_exit.
+ *
+ * @param argc number of arguments in @a argv, or -1 if \a argv contains a NULL
+ * terminated list.
+ *
+ * @param argv list of arguments.
+ *
+ * @returns new context, or NULL if error in argument list
+ */
+libatari800_ctx_t *libatari800_ctx_new(int argc, char **argv)
+{
+	libatari800_ctx_t *ctx;
+
+	CTX_LOCK();
+	park_resident();
+	if (!libatari800_init(argc, argv)) {
+		CTX_UNLOCK();
+		return NULL;
+	}
+	if (host_screen == NULL)
+		host_screen = Screen_atari;
+
+	ctx = (libatari800_ctx_t *) Util_malloc(sizeof(libatari800_ctx_t));
+	ctx->state_size = STATESAV_MAX_SIZE;
+	ctx->state = (UBYTE *) Util_malloc(ctx->state_size);
+	memset(&ctx->tags, 0, sizeof(ctx->tags));
+	ctx->binload = binload_idle;
+	ctx->input = input_idle;
+	ctx->observation = LIBATARI800_observation;
+	ctx->error_code = libatari800_error_code;
+	memcpy(ctx->screen, Screen_atari, sizeof(ctx->screen));
+	/* ctx->screen may be where a freed context had its screen */
+	ANTIC_RedrawLines(0, Screen_HEIGHT - 1);
+	ctx->sound_size = sound_hw_buffer_size;
+	ctx->sound = (UBYTE *) Util_malloc(ctx->sound_size > 0 ? ctx->sound_size : 1);
+	ctx->sound_len = 0;
+	Screen_atari = (ULONG *) ctx->screen;
+	resident = ctx;
+	CTX_UNLOCK();
+	return ctx;
+}
+
+
+/** Free an emulated machine
+ *
+ * Releases the memory used by the context. Disk images and files in use by
+ * the machine remain open until the next context is made resident or
+ * \a libatari800_exit is called.
+ *
+ * @param ctx context returned by \a libatari800_ctx_new
+ */
+void libatari800_ctx_free(libatari800_ctx_t *ctx)
+{
+	CTX_LOCK();
+	if (resident == ctx) {
+		Screen_atari = host_screen;
+		resident = NULL;
+	}
+	else if (ctx->binload.bin_file != NULL)
+		fclose(ctx->binload.bin_file);
+	free(ctx->state);
+	free(ctx->sound);
+	free(ctx);
+	CTX_UNLOCK();
+}
+
+
+/** Perform one video frame's worth of emulation on a context
+ *
+ * Equivalent of \a libatari800_next_frame for the machine owned by \a ctx.
+ *
+ * @param ctx context returned by \a libatari800_ctx_new
+ * @param input input template structure defining the user input for the frame
+ *
+ * @returns TRUE if successful, FALSE if an error occurred; the error code can
+ * be retrieved with \a libatari800_ctx_get_error_code
+ */
+int libatari800_ctx_next_frame(libatari800_ctx_t *ctx, input_template_t *input)
+{
+	int status;
+
+	CTX_LOCK();
+	make_resident(ctx);
+	status = libatari800_next_frame(input);
+	ctx->error_code = libatari800_error_code;
+	ctx->sound_len = sound_array_fill < ctx->sound_size ? sound_array_fill : ctx->sound_size;
+	memcpy(ctx->sound, LIBATARI800_Sound_array, ctx->sound_len);
+	CTX_UNLOCK();
+	return status;
+}
+
+
+/** Perform several video frames' worth of emulation on a context
+ *
+ * Equivalent of \a libatari800_run_frames for the machine owned by \a ctx.
+ */
+int libatari800_ctx_run_frames(libatari800_ctx_t *ctx, int n, const input_template_t *inputs, int flags, int *status)
+{
+	int count;
+
+	CTX_LOCK();
+	make_resident(ctx);
+	count = libatari800_run_frames(n, inputs, flags, status);
+	ctx->error_code = libatari800_error_code;
+	ctx->sound_len = sound_array_fill < ctx->sound_size ? sound_array_fill : ctx->sound_size;
+	memcpy(ctx->sound, LIBATARI800_Sound_array, ctx->sound_len);
+	CTX_UNLOCK();
+	return count;
+}
+
+
+/** Return the error code of the latest frame of a context
+ *
+ * @param ctx context returned by \a libatari800_ctx_new
+ *
+ * @returns one of the values documented for \a libatari800_next_frame
+ */
+int libatari800_ctx_get_error_code(libatari800_ctx_t *ctx)
+{
+	return ctx->error_code;
+}
+
+
+/** Use disk image in a disk drive of a context
+ *
+ * Equivalent of \a libatari800_mount_disk_image for the machine owned by
+ * \a ctx.
+ */
+int libatari800_ctx_mount_disk_image(libatari800_ctx_t *ctx, int diskno, const char *filename, int readonly)
+{
+	int status;
+
+	CTX_LOCK();
+	make_resident(ctx);
+	status = libatari800_mount_disk_image(diskno, filename, readonly);
+	CTX_UNLOCK();
+	return status;
+}
+
+
+/** Restart emulation of a context using file
+ *
+ * Equivalent of \a libatari800_reboot_with_file for the machine owned by
+ * \a ctx.
+ */
+int libatari800_ctx_reboot_with_file(libatari800_ctx_t *ctx, const char *filename)
+{
+	int file_type;
+
+	CTX_LOCK();
+	make_resident(ctx);
+	file_type = libatari800_reboot_with_file(filename);
+	CTX_UNLOCK();
+	return file_type;
+}
+
+
+/** Return pointer to screen data of a context
+ *
+ * The layout is the same as described in \a libatari800_get_screen_ptr. The
+ * pointer stays valid until the context is freed.
+ */
+UBYTE *libatari800_ctx_get_screen_ptr(libatari800_ctx_t *ctx)
+{
+	return ctx->screen;
+}
+
+
+/** Register a buffer that receives every frame of a context
+ *
+ * Equivalent of \a libatari800_set_observation for the machine owned by
+ * \a ctx.
+ */
+int libatari800_ctx_set_observation(libatari800_ctx_t *ctx, UBYTE *buffer, int format, int x, int y, int width, int height, int scale_x, int scale_y)
+{
+	int size;
+
+	CTX_LOCK();
+	size = LIBATARI800_Video_SetObservation(resident == ctx ? &LIBATARI800_observation : &ctx->observation,
+	                                        buffer, format, x, y, width, height, scale_x, scale_y);
+	CTX_UNLOCK();
+	return size;
+}
+
+
+/** Return pointer to sound data of the latest frame of a context
+ *
+ * The pointer stays valid until the context is freed.
+ */
+UBYTE *libatari800_ctx_get_sound_buffer(libatari800_ctx_t *ctx)
+{
+	return ctx->sound;
+}
+
+
+/** Return the usable size of the sound buffer of a context
+ *
+ * @returns number of bytes of valid data in the sound buffer
+ */
+int libatari800_ctx_get_sound_buffer_len(libatari800_ctx_t *ctx)
+{
+	return (int)ctx->sound_len;
+}
+
+
+/** Return the number of frames of emulation of a context
+ *
+ * See \a libatari800_get_frame_number.
+ */
+int libatari800_ctx_get_frame_number(libatari800_ctx_t *ctx)
+{
+	int nframes;
+
+	CTX_LOCK();
+	nframes = resident == ctx ? Atari800_nframes : ctx->nframes;
+	CTX_UNLOCK();
+	return nframes;
+}
+
+
+/** Save the state of a context
+ *
+ * Equivalent of \a libatari800_get_current_state for the machine owned by
+ * \a ctx.
+ */
+void libatari800_ctx_get_current_state(libatari800_ctx_t *ctx, emulator_state_t *state)
+{
+	CTX_LOCK();
+	make_resident(ctx);
+	libatari800_get_current_state(state);
+	CTX_UNLOCK();
+}
+
+
+/** Restore the state of a context
+ *
+ * Equivalent of \a libatari800_restore_state for the machine owned by
+ * \a ctx.
+ */
+void libatari800_ctx_restore_state(libatari800_ctx_t *ctx, emulator_state_t *state)
+{
+	CTX_LOCK();
+	make_resident(ctx);
+	libatari800_restore_state(state);
+	CTX_UNLOCK();
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,460 @@
+/*
+ * libatari800/forkserver.c - Atari800 as a library - copy-on-write branches
+ *
+ * Copyright (C) 2001-2021 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Atari800 includes */
+#include "atari.h"
+#include "memory.h"
+#include "screen.h"
+#include "sio.h"
+#include "util.h"
+#include "libatari800/sound.h"
+#include "libatari800/statesav.h"
+
+#if defined(HAVE_FORK) && defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_SYS_SOCKET_H)
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+/* A branch is a child process created by fork(), so it starts out sharing
+   the whole emulator with the parent copy-on-write. The parent sends
+   commands through a socket pair and the child answers through it,
+   leaving the bulky results (screen, RAM, audio) in a shared memory block
+   mapped before the fork. Writes to the socket of a dead branch fail with
+   EPIPE instead of raising SIGPIPE in the calling process. */
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#define CMD_RUN 1
+#define CMD_QUIT 2
+
+typedef struct {
+	int command;
+	int n;
+	int flags;
+} fork_command_t;
+
+typedef struct {
+	int frames;
+	int error_code;
+	int frame_number;
+	unsigned int sound_len;
+	UBYTE screen[Screen_HEIGHT * Screen_WIDTH];
+	UBYTE ram[65536];
+	/* followed by the sound buffer */
+} fork_shared_t;
+
+struct libatari800_fork {
+	pid_t pid;
+	int fd;  /* parent's end of the socket pair */
+	int busy;  /* a command was sent but its reply not yet read */
+	int dead;  /* the child has stopped answering */
+	int *status;  /* per-frame return codes of the last run */
+	int status_size;
+	fork_shared_t *shared;
+	size_t shared_size;
+	libatari800_fork_t *next;
+};
+
+/* all branches of this process, so a new child can close the others' sockets */
+static libatari800_fork_t *branches = NULL;
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = (const char *) buf;
+	while (len > 0) {
+		ssize_t r = send(fd, p, len, SEND_FLAGS);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		p += r;
+		len -= r;
+	}
+	return TRUE;
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+	while (len > 0) {
+		ssize_t r = read(fd, p, len);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		if (r == 0)
+			return FALSE;
+		p += r;
+		len -= r;
+	}
+	return TRUE;
+}
+
+/* Main loop of the child process; never returns. */
+static void serve(int fd, fork_shared_t *shared)
+{
+	input_template_t *inputs = NULL;
+	int *status = NULL;
+	int size = 0;
+	fork_command_t cmd;
+
+	while (read_all(fd, &cmd, sizeof(cmd)) && cmd.command == CMD_RUN) {
+		int num_inputs = (cmd.flags & LIBATARI800_RUN_REPEAT_INPUT) ? 1 : cmd.n;
+		if (cmd.n > size) {
+			size = cmd.n;
+			inputs = (input_template_t *) Util_realloc(inputs, size * sizeof(input_template_t));
+			status = (int *) Util_realloc(status, size * sizeof(int));
+		}
+		if (cmd.n > 0 && !read_all(fd, inputs, num_inputs * sizeof(input_template_t)))
+			break;
+		shared->frames = cmd.n > 0 ? libatari800_run_frames(cmd.n, inputs, cmd.flags, status) : 0;
+		shared->error_code = libatari800_error_code;
+		shared->frame_number = Atari800_nframes;
+		memcpy(shared->screen, Screen_atari, sizeof(shared->screen));
+		memcpy(shared->ram, MEMORY_mem, sizeof(shared->ram));
+		shared->sound_len = sound_array_fill < sound_hw_buffer_size ? sound_array_fill : sound_hw_buffer_size;
+		memcpy(shared + 1, LIBATARI800_Sound_array, shared->sound_len);
+		if (!write_all(fd, &shared->frames, sizeof(int))
+		 || !write_all(fd, status, shared->frames * sizeof(int)))
+			break;
+	}
+	_exit(0);
+}
+
+
+/** Create a copy-on-write branch of the emulator
+ *
+ * Forks a child process that continues from the current state of the
+ * emulator. The child shares all memory with the calling process
+ * copy-on-write, so creating a branch costs about as much as a fork() and
+ * no state has to be saved or restored. The calling process is unaffected
+ * and can keep creating branches from the same state, or continue emulating.
+ *
+ * Emulation in the branch is driven with \a libatari800_fork_run and
+ * \a libatari800_fork_wait. Several branches can run in parallel.
+ *
+ * The mounted disk images are copied to temporary files for the branch,
+ * so that the branch reads and writes its own images. Other files, such as
+ * the cassette image or printer output, are still shared with the calling
+ * process.
+ *
+ * Only available on systems with fork(), mmap() and socketpair().
+ *
+ * @returns handle to the branch, or NULL if the branch could not be created
+ */
+libatari800_fork_t *libatari800_fork_branch(void)
+{
+	libatari800_fork_t *branch;
+	int fds[2];
+	FILE *disks[SIO_MAX_DRIVES];
+	size_t shared_size = sizeof(fork_shared_t) + sound_hw_buffer_size;
+	fork_shared_t *shared;
+
+	shared = (fork_shared_t *) mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED)
+		return NULL;
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		munmap(shared, shared_size);
+		return NULL;
+	}
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+	{
+		int on = 1;
+		setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+		setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+	}
+#endif
+	if (!SIO_CopyImages(disks)) {
+		close(fds[0]);
+		close(fds[1]);
+		munmap(shared, shared_size);
+		return NULL;
+	}
+	fflush(NULL);
+
+	branch = (libatari800_fork_t *) Util_malloc(sizeof(libatari800_fork_t));
+	branch->pid = fork();
+	if (branch->pid == 0) {
+		/* child */
+		libatari800_fork_t *b;
+		for (b = branches; b != NULL; b = b->next) {
+			close(b->fd);
+			munmap(b->shared, b->shared_size);
+		}
+		close(fds[0]);
+		SIO_UseImageCopies(disks);
+		serve(fds[1], shared);
+	}
+	close(fds[1]);
+	SIO_CloseImageCopies(disks);
+	if (branch->pid < 0) {
+		close(fds[0]);
+		munmap(shared, shared_size);
+		free(branch);
+		return NULL;
+	}
+	branch->fd = fds[0];
+	branch->busy = FALSE;
+	branch->dead = FALSE;
+	branch->status = NULL;
+	branch->status_size = 0;
+	branch->shared = shared;
+	branch->shared_size = shared_size;
+	branch->next = branches;
+	branches = branch;
+	return branch;
+}
+
+
+/** Start emulating frames in a branch
+ *
+ * Sends an input sequence to the branch, which emulates it as
+ * \a libatari800_run_frames would. The call returns immediately; use
+ * \a libatari800_fork_wait to wait for the results.
+ *
+ * @param branch handle returned by \a libatari800_fork_branch
+ * @param n number of frames to emulate
+ * @param inputs input templates as described in \a libatari800_run_frames
+ * @param flags flags as described in \a libatari800_run_frames
+ *
+ * @retval FALSE if the branch has died or is still busy
+ * @retval TRUE if successful
+ */
+int libatari800_fork_run(libatari800_fork_t *branch, int n, const input_template_t *inputs, int flags)
+{
+	fork_command_t cmd;
+	int num_inputs = (flags & LIBATARI800_RUN_REPEAT_INPUT) ? 1 : n;
+
+	if (branch->busy || branch->dead || n < 0)
+		return FALSE;
+	cmd.command = CMD_RUN;
+	cmd.n = n;
+	cmd.flags = flags;
+	if (!write_all(branch->fd, &cmd, sizeof(cmd))
+	 || (n > 0 && !write_all(branch->fd, inputs, num_inputs * sizeof(input_template_t)))) {
+		branch->dead = TRUE;
+		return FALSE;
+	}
+	if (n > branch->status_size) {
+		branch->status_size = n;
+		branch->status = (int *) Util_realloc(branch->status, n * sizeof(int));
+	}
+	branch->busy = TRUE;
+	return TRUE;
+}
+
+
+/** Wait for a branch to finish emulating
+ *
+ * After this returns, the results of the frames are available through
+ * \a libatari800_fork_get_screen_ptr and the other accessors.
+ *
+ * @param branch handle returned by \a libatari800_fork_branch
+ *
+ * @returns number of frames emulated as in \a libatari800_run_frames, or -1
+ * if the branch has died
+ */
+int libatari800_fork_wait(libatari800_fork_t *branch)
+{
+	int frames;
+
+	if (branch->dead)
+		return -1;
+	if (!branch->busy)
+		return branch->shared->frames;
+	branch->busy = FALSE;
+	if (!read_all(branch->fd, &frames, sizeof(int))
+	 || !read_all(branch->fd, branch->status, frames * sizeof(int))) {
+		branch->dead = TRUE;
+		return -1;
+	}
+	return frames;
+}
+
+
+/** Return the per-frame return codes of the last run of a branch
+ *
+ * @returns array with one entry for each frame emulated, using the values
+ * documented for \a libatari800_next_frame
+ */
+const int *libatari800_fork_get_status(libatari800_fork_t *branch)
+{
+	return branch->status;
+}
+
+
+/** Return the error code of the last frame emulated by a branch */
+int libatari800_fork_get_error_code(libatari800_fork_t *branch)
+{
+	return branch->shared->error_code;
+}
+
+
+/** Return the frame number of a branch after its last run */
+int libatari800_fork_get_frame_number(libatari800_fork_t *branch)
+{
+	return branch->shared->frame_number;
+}
+
+
+/** Return pointer to screen data of a branch after its last run
+ *
+ * The layout is the same as described in \a libatari800_get_screen_ptr.
+ */
+UBYTE *libatari800_fork_get_screen_ptr(libatari800_fork_t *branch)
+{
+	return branch->shared->screen;
+}
+
+
+/** Return pointer to a copy of the 64k main memory of a branch after its
+ * last run
+ */
+UBYTE *libatari800_fork_get_main_memory_ptr(libatari800_fork_t *branch)
+{
+	return branch->shared->ram;
+}
+
+
+/** Return pointer to sound data of the last frame of a branch */
+UBYTE *libatari800_fork_get_sound_buffer(libatari800_fork_t *branch)
+{
+	return (UBYTE *) (branch->shared + 1);
+}
+
+
+/** Return the usable size of the sound buffer of a branch */
+int libatari800_fork_get_sound_buffer_len(libatari800_fork_t *branch)
+{
+	return (int) branch->shared->sound_len;
+}
+
+
+/** Terminate a branch
+ *
+ * Stops the child process and releases all resources of the branch.
+ *
+ * @param branch handle returned by \a libatari800_fork_branch
+ */
+void libatari800_fork_free(libatari800_fork_t *branch)
+{
+	libatari800_fork_t **b;
+	fork_command_t cmd;
+
+	cmd.command = CMD_QUIT;
+	cmd.n = 0;
+	cmd.flags = 0;
+	if (branch->busy)
+		libatari800_fork_wait(branch);
+	if (!branch->dead)
+		write_all(branch->fd, &cmd, sizeof(cmd));
+	close(branch->fd);
+	while (waitpid(branch->pid, NULL, 0) < 0 && errno == EINTR)
+		;
+	munmap(branch->shared, branch->shared_size);
+	for (b = &branches; *b != NULL; b = &(*b)->next) {
+		if (*b == branch) {
+			*b = branch->next;
+			break;
+		}
+	}
+	free(branch->status);
+	free(branch);
+}
+
+#else /* defined(HAVE_FORK) && defined(HAVE_MMAP) ... */
+
+libatari800_fork_t *libatari800_fork_branch(void)
+{
+	return NULL;
+}
+
+int libatari800_fork_run(libatari800_fork_t *branch, int n, const input_template_t *inputs, int flags)
+{
+	return FALSE;
+}
+
+int libatari800_fork_wait(libatari800_fork_t *branch)
+{
+	return -1;
+}
+
+const int *libatari800_fork_get_status(libatari800_fork_t *branch)
+{
+	return NULL;
+}
+
+int libatari800_fork_get_error_code(libatari800_fork_t *branch)
+{
+	return 0;
+}
+
+int libatari800_fork_get_frame_number(libatari800_fork_t *branch)
+{
+	return 0;
+}
+
+UBYTE *libatari800_fork_get_screen_ptr(libatari800_fork_t *branch)
+{
+	return NULL;
+}
+
+UBYTE *libatari800_fork_get_main_memory_ptr(libatari800_fork_t *branch)
+{
+	return NULL;
+}
+
+UBYTE *libatari800_fork_get_sound_buffer(libatari800_fork_t *branch)
+{
+	return NULL;
+}
+
+int libatari800_fork_get_sound_buffer_len(libatari800_fork_t *branch)
+{
+	return 0;
+}
+
+void libatari800_fork_free(libatari800_fork_t *branch)
+{
+}
+
+#endif /* defined(HAVE_FORK) && defined(HAVE_MMAP) ... */
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -1,6 +1,19 @@
+#include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_FORK) && defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_SIGNAL_H)
+#define GUESS_IN_PARALLEL
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
+#include "crc32.h"
 #include "libatari800.h"
 
 #define MACHINE_TYPE_800 0x01
@@ -223,101 +236,311 @@ exit:
 	return frame;
 }
 
-cart_types_t *get_first_cart(machine_config_t *machine, int cart_kb) {
-	cart_types_t *cart_desc = NULL;
+/* One machine/cartridge combination to be tried on an image. */
+typedef struct {
+	machine_config_t *machine;
+	cart_types_t *cart_desc; /* NULL to run without -cart-type */
+	int num_frames;
+	int result; /* return value of run_emulator */
+	int error_code; /* libatari800_error_code at the end of the run */
+	int done;
+	int pid;
+} candidate_t;
+
+/* Add the candidates for one machine: every cart type matching the size of the
+   image and a final run without a cart type, or only the cart type given in
+   the .car header.
+*/
+int add_candidates(candidate_t *candidates, int count, machine_config_t *machine, int num_frames, int cart_kb) {
+	cart_types_t *cart_desc = (machine->type & MACHINE_TYPE_5200) ? cart_list_5200 : cart_list_a8;
+	candidate_t *c;
 
-	if (cart_kb > 0) {
-		if (machine->type & MACHINE_TYPE_5200) cart_desc = cart_list_5200;
-		else cart_desc = cart_list_a8;
-		while (cart_desc->size < cart_kb) cart_desc++;
-	}
-	else if (cart_kb < 0) {
-		/* cart_kb is the negative cart type */
-		if (machine->type & MACHINE_TYPE_5200) cart_desc = cart_list_5200;
-		else cart_desc = cart_list_a8;
-		while (cart_desc->size && (cart_desc->type != -cart_kb)) cart_desc++;
-
-		/* if we go through the entire list, the cart must not work in this machine */
-		if (!cart_desc->size) cart_desc = NULL;
+	num_frames = num_frames < machine->min_frames ? machine->min_frames : num_frames;
+	while (1) {
+		if (cart_kb < 0) {
+			/* cart_kb is the negative cart type; if it isn't in the list the
+			   cart must not work in this machine */
+			while (cart_desc->size && (cart_desc->type != -cart_kb)) cart_desc++;
+			if (!cart_desc->size) break;
+		}
+		else if (cart_kb > 0) {
+			while (cart_desc->size && (cart_desc->size != cart_kb)) cart_desc++;
+		}
+		c = &candidates[count++];
+		memset(c, 0, sizeof(candidate_t));
+		c->machine = machine;
+		c->cart_desc = (cart_kb != 0 && cart_desc->size) ? cart_desc : NULL;
+		c->num_frames = num_frames;
+		if (!c->cart_desc || (cart_kb < 0)) break;
+		cart_desc++;
 	}
-	return cart_desc;
+	return count;
 }
 
-/* Run the emulator using a given set of command line args. If it could be a
-   cartridge, run it multiple times trying the various cart types corresponding
-   to its size.
-*/
-int run_machine(machine_config_t *machine, char *pathname, int num_frames, int cart_kb, int verbose) {
-	int success;
-	int any_success = 0;
+/* Run the emulator on the image with the command line args of a candidate. */
+void run_candidate(candidate_t *c, char *pathname, int verbose) {
+	int num_args = 0;
 	char **machine_args;
-	cart_types_t *cart_desc = get_first_cart(machine, cart_kb);
 	char cart_type_string[16];
 
-	if (cart_kb < 0 && !cart_desc) {
-		/* have an exact match for a cart type, but not compatible machine */
-		return 0;
+	/* args array is modified by atari800, so need to recreate it each time */
+	while (num_args < (sizeof(default_args) / sizeof(default_args[0]))) {
+		test_args[num_args] = default_args[num_args];
+		num_args++;
 	}
-	num_frames = num_frames < machine->min_frames ? machine->min_frames : num_frames;
-	while (1) {
-		/* args array is modified by atari800, so need to recreate it each time */
-		int num_args = 0;
-		while (num_args < (sizeof(default_args) / sizeof(default_args[0]))) {
-			test_args[num_args] = default_args[num_args];
-			// printf("default arg %d: %s\n", num_args, default_args[num_args]);
-			num_args++;
+	machine_args = c->machine->args;
+	while (*machine_args) {
+		test_args[num_args++] = *machine_args++;
+	}
+	if (c->cart_desc) {
+		test_args[num_args++] = "-cart-type";
+		sprintf(cart_type_string, "%d", c->cart_desc->type);
+		test_args[num_args++] = cart_type_string;
+		test_args[num_args++] = "-cart";
+	}
+	test_args[num_args++] = pathname;
+
+	c->result = run_emulator(num_args, c->num_frames, verbose);
+	c->error_code = libatari800_error_code;
+	c->done = TRUE;
+}
+
+void print_candidate(candidate_t *c, char *pathname, int verbose) {
+	char **machine_args;
+
+	if (!verbose) {
+		if (c->result > 0) {
+			printf("%s: %s (", pathname, c->machine->label);
+			machine_args = c->machine->args;
+			while (*machine_args) {
+				printf("%s", *machine_args);
+				machine_args++;
+				if (*machine_args) printf(" ");
+			}
+			if (c->cart_desc) {
+				printf(" -cart-type %d", c->cart_desc->type);
+			}
+			printf(")\n");
 		}
-		machine_args = machine->args;
-		while (*machine_args) {
-			// printf("arg %d: %s\n", num_args, *machine_args);
-			test_args[num_args++] = *machine_args++;
+	}
+	else {
+		printf("%s: %s", pathname, c->machine->label);
+		if (c->result > 0) printf(" status: OK through %d frames", c->result);
+		else {
+			printf(" status: FAIL");
+			if (c->error_code) {
+				libatari800_error_code = c->error_code;
+				printf(" (%s)", libatari800_error_message());
+			}
 		}
-		if (cart_desc && ((cart_desc->size == cart_kb) || (cart_kb < 0))) {
-			test_args[num_args++] = "-cart-type";
-			sprintf(cart_type_string, "%d", cart_desc->type);
-			test_args[num_args++] = cart_type_string;
-			test_args[num_args++] = "-cart";
+		if (c->cart_desc) {
+			printf(" (cart=%d '%s')", c->cart_desc->type, c->cart_desc->label);
 		}
-		test_args[num_args++] = pathname;
-
-		success = run_emulator(num_args, num_frames, verbose);
-		if (success) any_success++;
-		if (!verbose) {
-			if (success > 0) {
-				printf("%s: %s (", pathname, machine->label);
-				machine_args = machine->args;
-				while (*machine_args) {
-					printf("%s", *machine_args);
-					machine_args++;
-					if (*machine_args) printf(" ");
-				}
-				if (cart_desc) {
-					printf(" -cart-type %d", cart_desc->type);
+		printf("\n");
+	}
+}
+
+/* Results of earlier runs, keyed by the CRC32 of the image. Each line of the
+   cache file holds one candidate:
+
+     crc cart_type num_frames result error_code machine_args
+
+   where cart_type is 0 for a run without -cart-type and machine_args are the
+   args of the machine_config entry joined with commas.
+*/
+typedef struct cache_entry {
+	ULONG crc;
+	int cart_type;
+	int num_frames;
+	int result;
+	int error_code;
+	char machine_args[64];
+	struct cache_entry *next;
+} cache_entry_t;
+
+#define CACHE_HASH_SIZE 4096
+
+cache_entry_t *cache[CACHE_HASH_SIZE];
+
+void join_machine_args(machine_config_t *machine, char *buf, size_t size) {
+	char **machine_args = machine->args;
+
+	buf[0] = '\0';
+	while (*machine_args) {
+		if (buf[0]) strncat(buf, ",", size - strlen(buf) - 1);
+		strncat(buf, *machine_args++, size - strlen(buf) - 1);
+	}
+}
+
+cache_entry_t *cache_add(ULONG crc, int cart_type, int num_frames, int result, int error_code, const char *machine_args) {
+	cache_entry_t *entry = malloc(sizeof(cache_entry_t));
+
+	if (!entry) return NULL;
+	entry->crc = crc;
+	entry->cart_type = cart_type;
+	entry->num_frames = num_frames;
+	entry->result = result;
+	entry->error_code = error_code;
+	strncpy(entry->machine_args, machine_args, sizeof(entry->machine_args) - 1);
+	entry->machine_args[sizeof(entry->machine_args) - 1] = '\0';
+	entry->next = cache[crc % CACHE_HASH_SIZE];
+	cache[crc % CACHE_HASH_SIZE] = entry;
+	return entry;
+}
+
+void cache_load(const char *filename) {
+	FILE *fp = fopen(filename, "r");
+	char line[256];
+	char machine_args[64];
+	unsigned int crc;
+	int cart_type, num_frames, result, error_code;
+
+	if (!fp) return;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%x %d %d %d %d %63s", &crc, &cart_type, &num_frames, &result, &error_code, machine_args) == 6) {
+			cache_add(crc, cart_type, num_frames, result, error_code, machine_args);
+		}
+	}
+	fclose(fp);
+}
+
+/* Fill in the results of candidates found in the cache. */
+void cache_lookup(ULONG crc, candidate_t *candidates, int count) {
+	char machine_args[64];
+	cache_entry_t *entry;
+	candidate_t *c;
+
+	for (c = candidates; c < candidates + count; c++) {
+		join_machine_args(c->machine, machine_args, sizeof(machine_args));
+		for (entry = cache[crc % CACHE_HASH_SIZE]; entry; entry = entry->next) {
+			if (entry->crc == crc && entry->num_frames == c->num_frames
+				&& entry->cart_type == (c->cart_desc ? c->cart_desc->type : 0)
+				&& strcmp(entry->machine_args, machine_args) == 0) {
+				c->result = entry->result;
+				c->error_code = entry->error_code;
+				c->done = TRUE;
+				break;
+			}
+		}
+	}
+}
+
+/* Append the results of candidates that were run to the cache file. */
+void cache_save(const char *filename, ULONG crc, candidate_t *candidates, int count, int *cached) {
+	FILE *fp = fopen(filename, "a");
+	char machine_args[64];
+	int cart_type;
+	int i;
+
+	if (!fp) {
+		printf("WARNING: can't write cache file %s\n", filename);
+		return;
+	}
+	for (i = 0; i < count; i++) {
+		if (!candidates[i].done || cached[i]) continue;
+		join_machine_args(candidates[i].machine, machine_args, sizeof(machine_args));
+		cart_type = candidates[i].cart_desc ? candidates[i].cart_desc->type : 0;
+		fprintf(fp, "%08x %d %d %d %d %s\n", (unsigned int)crc, cart_type, candidates[i].num_frames, candidates[i].result, candidates[i].error_code, machine_args);
+		cache_add(crc, cart_type, candidates[i].num_frames, candidates[i].result, candidates[i].error_code, machine_args);
+	}
+	fclose(fp);
+}
+
+/* Run all candidates that don't have a result yet, up to num_jobs at a time
+   in separate processes, printing the results in order as they become
+   available. With first_only, candidates after the first successful one are
+   stopped (or never started), as they can no longer change the verdict.
+   Returns the number of successful candidates printed.
+*/
+int run_candidates(candidate_t *candidates, int count, char *pathname, int num_jobs, int first_only, int verbose) {
+	int limit = count;
+	int printed = 0;
+	int successful_count = 0;
+	int i;
+#ifdef GUESS_IN_PARALLEL
+	int next = 0;
+	int running = 0;
+	int pid, status;
+	candidate_t *shared = NULL;
+
+	if (num_jobs > 1)
+		shared = (candidate_t *) mmap(NULL, count * sizeof(candidate_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared && shared != MAP_FAILED) {
+		if (first_only) {
+			for (i = 0; i < count; i++) {
+				if (candidates[i].done && candidates[i].result > 0) {
+					limit = i + 1;
+					break;
 				}
-				printf(")\n");
 			}
 		}
-		else {
-			printf("%s: %s", pathname, machine->label);
-			if (success > 0) printf(" status: OK through %d frames", success);
+		while (1) {
+			while (running < num_jobs && next < limit) {
+				if (candidates[next].done) {
+					next++;
+					continue;
+				}
+				fflush(stdout);
+				pid = fork();
+				if (pid == 0) {
+					shared[next] = candidates[next];
+					run_candidate(&shared[next], pathname, verbose);
+					fflush(stdout);
+					_exit(0);
+				}
+				if (pid < 0) {
+					/* out of processes; run it here */
+					run_candidate(&candidates[next], pathname, verbose);
+				}
+				else {
+					candidates[next].pid = pid;
+					running++;
+				}
+				next++;
+			}
+			if (running == 0) break;
+			pid = waitpid(-1, &status, 0);
+			if (pid < 0) break;
+			for (i = 0; i < count && candidates[i].pid != pid; i++);
+			if (i == count) continue;
+			running--;
+			candidates[i].pid = 0;
+			if (i >= limit) {
+				/* stopped after a better candidate succeeded */
+				continue;
+			}
+			if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && shared[i].done) {
+				candidates[i].result = shared[i].result;
+				candidates[i].error_code = shared[i].error_code;
+			}
 			else {
-				printf(" status: FAIL");
-				if (libatari800_error_code) {
-					printf(" (%s)", libatari800_error_message());
+				candidates[i].result = 0;
+				candidates[i].error_code = -1;
+			}
+			candidates[i].done = TRUE;
+			if (first_only && candidates[i].result > 0) {
+				limit = i + 1;
+				for (i = limit; i < count; i++) {
+					if (candidates[i].pid) kill(candidates[i].pid, SIGKILL);
 				}
 			}
-			if (cart_desc) {
-				printf(" (cart=%d '%s')", cart_desc->type, cart_desc->label);
+			while (printed < limit && candidates[printed].done) {
+				if (candidates[printed].result > 0) successful_count++;
+				print_candidate(&candidates[printed++], pathname, verbose);
 			}
-			printf("\n");
 		}
-		if (!cart_desc || (cart_kb < 0)) break;
-		if (cart_desc) {
-			cart_desc++;
-			if (cart_desc->size != cart_kb) cart_desc = NULL;
+		munmap(shared, count * sizeof(candidate_t));
+	}
+#endif
+	for (; printed < limit; printed++) {
+		if (!candidates[printed].done) run_candidate(&candidates[printed], pathname, verbose);
+		if (candidates[printed].result > 0) {
+			successful_count++;
+			if (first_only) limit = printed + 1;
 		}
+		print_candidate(&candidates[printed], pathname, verbose);
 	}
-	return any_success;
+	return successful_count;
 }
 
 #define CHUNK_SIZE 1024
@@ -346,6 +569,7 @@ int guess_cart_kb(char *pathname, int verbose) {
 		}
 		total_len += current_len;
 	} while (current_len == CHUNK_SIZE);
+	fclose(fp);
 	if (total_len == 0) {
 		return INVALID_FILE_SIZE;
 	}
@@ -392,6 +616,29 @@ int main(int argc, char **argv) {
 	int video_flag = MACHINE_VIDEO_ALL;
 	int video_flag_encountered = FALSE;
 	int num_frames = 1000;
+	int num_jobs = 1;
+	int first_only = FALSE;
+	char *cache_filename = NULL;
+	int max_candidates = 0;
+	candidate_t *candidates;
+	machine_config_t *machine;
+	cart_types_t *cart_desc;
+	FILE *fp;
+	ULONG crc;
+	int *cached;
+
+#if defined(GUESS_IN_PARALLEL) && defined(_SC_NPROCESSORS_ONLN)
+	num_jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_jobs < 1) num_jobs = 1;
+#endif
+	for (machine = machine_config; machine->label; machine++) {
+		int carts = 0;
+		for (cart_desc = cart_list_a8; cart_desc->size; cart_desc++) carts++;
+		max_candidates += carts + 1;
+	}
+	candidates = malloc(max_candidates * sizeof(candidate_t));
+	cached = malloc(max_candidates * sizeof(int));
+	if (!candidates || !cached) return 1;
 
 	int i;
 	for (i=1; i<argc; i++) {
@@ -408,6 +655,17 @@ int main(int argc, char **argv) {
 			else if (strcmp(argv[i], "-s") == 0) {
 				verbose = 0;
 			}
+			else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+				num_jobs = atoi(argv[++i]);
+				if (num_jobs < 1) num_jobs = 1;
+			}
+			else if (strcmp(argv[i], "-first") == 0) {
+				first_only = TRUE;
+			}
+			else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc) {
+				cache_filename = argv[++i];
+				cache_load(cache_filename);
+			}
 			else if (strcmp(argv[i], "-800") == 0) {
 				if (!machine_flag_encountered) machine_flag = 0;
 				machine_flag |= MACHINE_TYPE_800;
@@ -453,22 +711,31 @@ int main(int argc, char **argv) {
 			}
 		}
 		else {
-			int successful_count = 0;
-			machine_config_t *machine = machine_config;
+			int successful_count;
+			int count = 0;
+			int j;
 			int cart_kb = guess_cart_kb(argv[i], verbose);
 			if (cart_kb == INVALID_FILE_SIZE) continue;
-			while (machine->label) {
+			for (machine = machine_config; machine->label; machine++) {
 				if (machine->type & machine_flag && machine->type & os_flag && machine->type & video_flag) {
 					if (verbose > 1) {
 						printf("trying %s\n", machine->label);
 					}
-					if (run_machine(machine, argv[i], num_frames, cart_kb, verbose)) successful_count++;
+					count = add_candidates(candidates, count, machine, num_frames, cart_kb);
 				}
 				else if (verbose > 1) {
 					printf("skipping %s\n", machine->label);
 				}
-				machine++;
 			}
+			crc = 0;
+			if (cache_filename && (fp = fopen(argv[i], "rb")) != NULL) {
+				if (!CRC32_FromFile(fp, &crc)) crc = 0;
+				fclose(fp);
+				if (crc) cache_lookup(crc, candidates, count);
+			}
+			for (j = 0; j < count; j++) cached[j] = candidates[j].done;
+			successful_count = run_candidates(candidates, count, argv[i], num_jobs, first_only, verbose);
+			if (cache_filename && crc) cache_save(cache_filename, crc, candidates, count, cached);
 			if (!successful_count && !verbose) printf("%s: FAIL\n", argv[i]);
 		}
 	}
@@ -139,9 +139,11 @@ typedef struct {
 
 typedef struct {
     UBYTE selftest_enabled;
-    UBYTE _align1[3];
+    UBYTE delta;
+    UBYTE _align1[2];
     ULONG nframes;
     ULONG sample_residual;
+    ULONG delta_base;
 } statesav_flags_t;
 
 typedef struct {
@@ -266,6 +268,17 @@ extern int libatari800_error_code;
 #define LIBATARI800_MEMO_PAD 6
 #define LIBATARI800_INVALID_ESCAPE_OPCODE 7
 
+/* formats for libatari800_set_observation */
+#define LIBATARI800_OBS_PALETTE 0
+#define LIBATARI800_OBS_RGB24 1
+#define LIBATARI800_OBS_RGBA32 2
+#define LIBATARI800_OBS_LUMINANCE 3
+#define LIBATARI800_OBS_XRGB32 4
+
+/* flags for libatari800_run_frames */
+#define LIBATARI800_RUN_REPEAT_INPUT 1
+#define LIBATARI800_RUN_SKIP_SOUND 2
+
 int libatari800_init(int argc, char **argv);
 
 const char *libatari800_error_message();
@@ -276,6 +289,8 @@ void libatari800_clear_input_array(input_template_t *input);
 
 int libatari800_next_frame(input_template_t *input);
 
+int libatari800_run_frames(int n, const input_template_t *inputs, int flags, int *status);
+
 int libatari800_mount_disk_image(int diskno, const char *filename, int readonly);
 
 int libatari800_reboot_with_file(const char *filename);
@@ -284,6 +299,8 @@ UBYTE *libatari800_get_main_memory_ptr();
 
 UBYTE *libatari800_get_screen_ptr();
 
+int libatari800_set_observation(UBYTE *buffer, int format, int x, int y, int width, int height, int scale_x, int scale_y);
+
 UBYTE *libatari800_get_sound_buffer();
 
 int libatari800_get_sound_buffer_len();
@@ -296,6 +313,12 @@ int libatari800_get_num_sound_channels();
 
 int libatari800_get_sound_sample_size();
 
+void libatari800_set_sound_silent(int silent);
+
+void libatari800_set_idle_skip(int skip);
+
+ULONG libatari800_get_idle_cycles(void);
+
 float libatari800_get_fps();
 
 int libatari800_get_frame_number();
@@ -304,6 +327,103 @@ void libatari800_get_current_state(emulator_state_t *state);
 
 void libatari800_restore_state(emulator_state_t *state);
 
+void libatari800_set_delta_base(void);
+
+int libatari800_get_delta_state(emulator_state_t *state);
+
+int libatari800_restore_delta_state(emulator_state_t *state);
+
+void libatari800_set_rewind(int size, int interval);
+
+int libatari800_rewind(int steps);
+
+int libatari800_get_rewind_steps(void);
+
 void libatari800_exit();
 
+/* Independent emulated machines; see libatari800/context.c */
+typedef struct libatari800_ctx libatari800_ctx_t;
+
+libatari800_ctx_t *libatari800_ctx_new(int argc, char **argv);
+
+void libatari800_ctx_free(libatari800_ctx_t *ctx);
+
+int libatari800_ctx_next_frame(libatari800_ctx_t *ctx, input_template_t *input);
+
+int libatari800_ctx_run_frames(libatari800_ctx_t *ctx, int n, const input_template_t *inputs, int flags, int *status);
+
+int libatari800_ctx_get_error_code(libatari800_ctx_t *ctx);
+
+int libatari800_ctx_mount_disk_image(libatari800_ctx_t *ctx, int diskno, const char *filename, int readonly);
+
+int libatari800_ctx_reboot_with_file(libatari800_ctx_t *ctx, const char *filename);
+
+UBYTE *libatari800_ctx_get_screen_ptr(libatari800_ctx_t *ctx);
+
+int libatari800_ctx_set_observation(libatari800_ctx_t *ctx, UBYTE *buffer, int format, int x, int y, int width, int height, int scale_x, int scale_y);
+
+UBYTE *libatari800_ctx_get_sound_buffer(libatari800_ctx_t *ctx);
+
+int libatari800_ctx_get_sound_buffer_len(libatari800_ctx_t *ctx);
+
+int libatari800_ctx_get_frame_number(libatari800_ctx_t *ctx);
+
+void libatari800_ctx_get_current_state(libatari800_ctx_t *ctx, emulator_state_t *state);
+
+void libatari800_ctx_restore_state(libatari800_ctx_t *ctx, emulator_state_t *state);
+
+/* Copy-on-write branches of the emulator; see libatari800/forkserver.c */
+typedef struct libatari800_fork libatari800_fork_t;
+
+libatari800_fork_t *libatari800_fork_branch(void);
+
+int libatari800_fork_run(libatari800_fork_t *branch, int n, const input_template_t *inputs, int flags);
+
+int libatari800_fork_wait(libatari800_fork_t *branch);
+
+const int *libatari800_fork_get_status(libatari800_fork_t *branch);
+
+int libatari800_fork_get_error_code(libatari800_fork_t *branch);
+
+int libatari800_fork_get_frame_number(libatari800_fork_t *branch);
+
+UBYTE *libatari800_fork_get_screen_ptr(libatari800_fork_t *branch);
+
+UBYTE *libatari800_fork_get_main_memory_ptr(libatari800_fork_t *branch);
+
+UBYTE *libatari800_fork_get_sound_buffer(libatari800_fork_t *branch);
+
+int libatari800_fork_get_sound_buffer_len(libatari800_fork_t *branch);
+
+void libatari800_fork_free(libatari800_fork_t *branch);
+
+/* Emulators stepped in lockstep by worker processes; see libatari800/pool.c */
+typedef struct libatari800_pool libatari800_pool_t;
+
+libatari800_pool_t *libatari800_pool_new(int n);
+
+input_template_t *libatari800_pool_get_input_array(libatari800_pool_t *pool);
+
+int libatari800_pool_step_all(libatari800_pool_t *pool, const input_template_t *inputs, int frames, int flags);
+
+int libatari800_pool_wait_all(libatari800_pool_t *pool);
+
+void libatari800_pool_reset(libatari800_pool_t *pool, int worker);
+
+int libatari800_pool_get_status(libatari800_pool_t *pool, int worker);
+
+int libatari800_pool_get_error_code(libatari800_pool_t *pool, int worker);
+
+int libatari800_pool_get_frame_number(libatari800_pool_t *pool, int worker);
+
+UBYTE *libatari800_pool_get_screen_ptr(libatari800_pool_t *pool, int worker);
+
+UBYTE *libatari800_pool_get_main_memory_ptr(libatari800_pool_t *pool, int worker);
+
+UBYTE *libatari800_pool_get_sound_buffer(libatari800_pool_t *pool, int worker);
+
+int libatari800_pool_get_sound_buffer_len(libatari800_pool_t *pool, int worker);
+
+void libatari800_pool_free(libatari800_pool_t *pool);
+
 #endif /* LIBATARI800_H_ */
@@ -140,6 +140,68 @@ int wavWrite()
 	return 0;
 }
 
+/* A 5200 and an XL machine run side by side, and a 5200 state is restored
+   into an XL machine. Both must keep running like a 5200 run alone. */
+
+#define SCREEN_SIZE (384 * 240)
+
+static emulator_state_t machine_state;
+
+/* Copies the RAM of CTX to RAM. The RAM is compared rather than the screen,
+   as a frame that ends in a CPU crash is not drawn. */
+static void get_ram(libatari800_ctx_t *ctx, unsigned char *ram)
+{
+	static emulator_state_t state;
+
+	libatari800_ctx_get_current_state(ctx, &state);
+	memcpy(ram, &state.state[state.tags.base_ram], 65536);
+}
+
+static int test_machine_switch(void)
+{
+	char *args_5200[] = { "-5200", NULL };
+	char *args_xl[] = { "-xl", NULL };
+	static unsigned char screen[SCREEN_SIZE];
+	static unsigned char ram[65536];
+	static unsigned char ram_restored[65536];
+	input_template_t input;
+	libatari800_ctx_t *a5200, *axl;
+	int i, ok, restored;
+
+	libatari800_clear_input_array(&input);
+
+	a5200 = libatari800_ctx_new(-1, args_5200);
+	libatari800_ctx_next_frame(a5200, &input);
+	libatari800_ctx_get_current_state(a5200, &machine_state);
+	for (i = 1; i < 300; i++)
+		libatari800_ctx_next_frame(a5200, &input);
+	memcpy(screen, libatari800_ctx_get_screen_ptr(a5200), SCREEN_SIZE);
+	get_ram(a5200, ram);
+	libatari800_ctx_free(a5200);
+
+	a5200 = libatari800_ctx_new(-1, args_5200);
+	axl = libatari800_ctx_new(-1, args_xl);
+	for (i = 0; i < 300; i++) {
+		libatari800_ctx_next_frame(a5200, &input);
+		libatari800_ctx_next_frame(axl, &input);
+	}
+	ok = memcmp(screen, libatari800_ctx_get_screen_ptr(a5200), SCREEN_SIZE) == 0;
+	printf("5200 next to XL: %s\n", ok ? "OK" : "FAILED");
+	libatari800_ctx_free(a5200);
+
+	/* the state is from the first frame, while the 5200 BIOS is starting */
+	libatari800_ctx_restore_state(axl, &machine_state);
+	for (i = 1; i < 300; i++)
+		libatari800_ctx_next_frame(axl, &input);
+	get_ram(axl, ram_restored);
+	restored = memcmp(ram, ram_restored, sizeof(ram)) == 0;
+	printf("5200 state in XL: %s\n", restored ? "OK" : "FAILED");
+	libatari800_ctx_free(axl);
+
+	libatari800_exit();
+	return ok && restored;
+}
+
 int main(int argc, char **argv) {
 	input_template_t input;
 	int i;
@@ -151,6 +213,8 @@ int main(int argc, char **argv) {
 			save_wav = TRUE;
 			show_screen = FALSE;
 		}
+		else if (strcmp(argv[i], "-machine-switch") == 0)
+			return test_machine_switch() ? 0 : 1;
 	}
 
 	/* force the 400/800 OS to get the Memo Pad */
@@ -57,6 +57,8 @@
 #include "devices.h"
 #include "gtia.h"
 #include "pokey.h"
+#include "rewind.h"
+#include "shmstream.h"
 #ifdef PBI_BB
 #include "pbi_bb.h"
 #endif
@@ -102,7 +104,7 @@ int PLATFORM_Initialise(int *argc, char *argv[])
 }
 
 
-void LIBATARI800_Frame(void)
+void LIBATARI800_Frame(int draw_display, int update_sound)
 {
 	switch (INPUT_key_code) {
 	case AKEY_COLDSTART:
@@ -114,6 +116,9 @@ void LIBATARI800_Frame(void)
 	case AKEY_UI:
 		PLATFORM_Exit(TRUE);  /* run monitor */
 		break;
+	case AKEY_REWIND:
+		REWIND_Back(1);
+		break;
 	default:
 		break;
 	}
@@ -127,13 +132,24 @@ void LIBATARI800_Frame(void)
 	Devices_Frame();
 	INPUT_Frame();
 	GTIA_Frame();
-	ANTIC_Frame(TRUE);
-	INPUT_DrawMousePointer();
-	Screen_DrawAtariSpeed(Util_time());
-	Screen_DrawDiskLED();
-	Screen_Draw1200LED();
+	LIBATARI800_Video_StartFrame();
+	if (draw_display) {
+		ANTIC_Frame(TRUE);
+		LIBATARI800_Video_Observe();
+		INPUT_DrawMousePointer();
+		Screen_DrawAtariSpeed(Util_time());
+		Screen_DrawDiskLED();
+		Screen_Draw1200LED();
+	}
+	else
+		ANTIC_Frame(Atari800_collisions_in_skipped_frames ? ANTIC_COLLISIONS_ONLY : FALSE);
 	POKEY_Frame();
-	Sound_Update();
+	REWIND_Frame();
+	if (update_sound)
+		Sound_Update();
+	else
+		LIBATARI800_Sound_SkipFrame();
+	SHMSTREAM_Frame(draw_display);
 	Atari800_nframes++;
 }
 
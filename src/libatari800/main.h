@@ -5,6 +5,9 @@
 
 #include "config.h"
 
-void LIBATARI800_Frame(void);
+/* Emulate one frame. If draw_display is FALSE, the screen is not updated
+   (collisions are still computed if Atari800_collisions_in_skipped_frames is
+   set); if update_sound is FALSE, no audio samples are generated. */
+void LIBATARI800_Frame(int draw_display, int update_sound);
 
 #endif /* LIBATARI800_VIDEO_H_ */
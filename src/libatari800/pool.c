@@ -0,0 +1,536 @@
+/*
+ * libatari800/pool.c - Atari800 as a library - emulators stepped in lockstep
+ *
+ * Copyright (C) 2001-2021 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Atari800 includes */
+#include "atari.h"
+#include "cpu.h"
+#include "memory.h"
+#include "screen.h"
+#include "util.h"
+#include "libatari800/sound.h"
+#include "libatari800/statesav.h"
+
+#if defined(HAVE_FORK) && defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_WAIT_H)
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#if defined(HAVE_LINUX_FUTEX_H) && defined(HAVE_SYS_SYSCALL_H)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#define USE_FUTEX
+#endif
+
+/* A pool is a set of worker processes forked from the calling process, so
+   they all start from its current emulator state. Everything they exchange
+   with the parent lives in one shared memory arena mapped before the fork:
+   a control block per worker, followed by the input templates, screens, RAM
+   copies and sound buffers of all workers. The parent starts a step by
+   bumping the command sequence number of each worker, and a worker reports
+   completion by storing that number in its done field. Both sides sleep on
+   these words with futexes where available. */
+
+#define CMD_RUN 1
+#define CMD_QUIT 2
+
+/* how long to sleep before checking that the other side is still alive */
+#define POLL_MS 100
+
+typedef struct {
+	volatile int seq;  /* command number, written by the parent */
+	volatile int done;  /* number of the last completed command, written by the worker */
+	int command;
+	int frames;
+	int flags;
+	int reset;  /* return to the initial state before running */
+	int result;  /* frames emulated as in libatari800_run_frames */
+	int status;  /* return code of the last frame */
+	int error_code;
+	int frame_number;
+	unsigned int sound_len;
+	/* padded so that every control block has its own cache line */
+	char pad[64 - 11 * sizeof(int)];
+} pool_control_t;
+
+struct libatari800_pool {
+	int n;
+	int busy;  /* a step was started but not yet waited for */
+	pid_t *pids;
+	UBYTE *arena;
+	size_t arena_size;
+	pool_control_t *control;
+	input_template_t *inputs;
+	UBYTE *screens;
+	UBYTE *ram;
+	UBYTE *sound;
+	size_t sound_size;  /* per worker */
+	libatari800_pool_t *next;
+};
+
+/* all pools of this process, so a new worker can unmap the others' arenas */
+static libatari800_pool_t *pools = NULL;
+
+#ifdef __GNUC__
+#define BARRIER() __sync_synchronize()
+#else
+#define BARRIER()
+#endif
+
+/* Sleeps until *addr no longer holds value, or about POLL_MS passed. */
+static void wait_change(volatile int *addr, int value)
+{
+#ifdef USE_FUTEX
+	struct timespec timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_nsec = POLL_MS * 1000000L;
+	syscall(SYS_futex, (int *) addr, FUTEX_WAIT, value, &timeout, NULL, 0);
+#else
+	int i;
+	for (i = 0; i < POLL_MS * 10 && *addr == value; i++)
+		usleep(100);
+#endif
+}
+
+static void wake(volatile int *addr)
+{
+#ifdef USE_FUTEX
+	syscall(SYS_futex, (int *) addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
+
+static size_t align(size_t size)
+{
+	return (size + 63) & ~(size_t) 63;
+}
+
+/* Main loop of a worker process; never returns. */
+static void serve(libatari800_pool_t *pool, int index)
+{
+	pool_control_t *ctl = &pool->control[index];
+	pid_t parent = getppid();
+	int seq = ctl->seq;
+	int *status = NULL;
+	int status_size = 0;
+	UBYTE *state;
+	ULONG state_size = STATESAV_MAX_SIZE;
+	statesav_tags_t tags;
+	int nframes = Atari800_nframes;
+	int selftest_enabled = MEMORY_selftest_enabled;
+
+	/* keep the initial state for libatari800_pool_reset */
+	state = (UBYTE *) Util_malloc(state_size);
+	while (!LIBATARI800_StateSaveSized(state, state_size, &tags, TRUE)) {
+		state_size *= 2;
+		state = (UBYTE *) Util_realloc(state, state_size);
+	}
+
+	for (;;) {
+		while (ctl->seq == seq) {
+			wait_change(&ctl->seq, seq);
+			if (getppid() != parent)
+				_exit(0);
+		}
+		BARRIER();
+		seq = ctl->seq;
+		if (ctl->command != CMD_RUN)
+			break;
+		if (ctl->reset) {
+			LIBATARI800_StateLoadSized(state, state_size);
+			Atari800_nframes = nframes;
+			MEMORY_selftest_enabled = selftest_enabled;
+			CPU_cim_encountered = FALSE;
+			libatari800_error_code = 0;
+			ctl->reset = FALSE;
+		}
+		if (ctl->frames > status_size) {
+			status_size = ctl->frames;
+			status = (int *) Util_realloc(status, status_size * sizeof(int));
+		}
+		ctl->result = ctl->frames > 0
+			? libatari800_run_frames(ctl->frames, &pool->inputs[index], ctl->flags | LIBATARI800_RUN_REPEAT_INPUT, status)
+			: 0;
+		ctl->status = ctl->result > 0 ? status[ctl->result - 1] : 0;
+		ctl->error_code = libatari800_error_code;
+		ctl->frame_number = Atari800_nframes;
+		memcpy(pool->screens + (size_t) index * Screen_HEIGHT * Screen_WIDTH, Screen_atari, Screen_HEIGHT * Screen_WIDTH);
+		memcpy(pool->ram + (size_t) index * 65536, MEMORY_mem, 65536);
+		ctl->sound_len = sound_array_fill < pool->sound_size ? sound_array_fill : pool->sound_size;
+		memcpy(pool->sound + index * pool->sound_size, LIBATARI800_Sound_array, ctl->sound_len);
+		BARRIER();
+		ctl->done = seq;
+		wake(&ctl->done);
+	}
+	_exit(0);
+}
+
+/* Returns FALSE if the worker has died. */
+static int worker_alive(libatari800_pool_t *pool, int index)
+{
+	pid_t pid = pool->pids[index];
+	if (pid <= 0)
+		return FALSE;
+	if (waitpid(pid, NULL, WNOHANG) == pid) {
+		pool->pids[index] = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/** Create a pool of emulators stepped in lockstep
+ *
+ * Forks \a n worker processes that each continue from the current state of
+ * the emulator, like \a libatari800_fork_branch. All of them are stepped
+ * together with \a libatari800_pool_step_all and \a libatari800_pool_wait_all,
+ * so a batch of emulators runs on all cores with a single call. Inputs and
+ * results are exchanged through one shared memory arena, without copying
+ * through pipes or sockets.
+ *
+ * Only available on systems with fork() and mmap().
+ *
+ * @param n number of workers
+ *
+ * @returns handle to the pool, or NULL if it could not be created
+ */
+libatari800_pool_t *libatari800_pool_new(int n)
+{
+	libatari800_pool_t *pool;
+	size_t control_size = align(n * sizeof(pool_control_t));
+	size_t inputs_size = align(n * sizeof(input_template_t));
+	size_t screens_size = align((size_t) n * Screen_HEIGHT * Screen_WIDTH);
+	size_t ram_size = (size_t) n * 65536;
+	size_t sound_size = align(sound_hw_buffer_size);
+	int i;
+
+	if (n <= 0)
+		return NULL;
+	pool = (libatari800_pool_t *) Util_malloc(sizeof(libatari800_pool_t));
+	pool->n = n;
+	pool->busy = FALSE;
+	pool->sound_size = sound_size;
+	pool->arena_size = control_size + inputs_size + screens_size + ram_size + n * sound_size;
+	pool->arena = (UBYTE *) mmap(NULL, pool->arena_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (pool->arena == MAP_FAILED) {
+		free(pool);
+		return NULL;
+	}
+	pool->control = (pool_control_t *) pool->arena;
+	pool->inputs = (input_template_t *) (pool->arena + control_size);
+	pool->screens = pool->arena + control_size + inputs_size;
+	pool->ram = pool->screens + screens_size;
+	pool->sound = pool->ram + ram_size;
+	for (i = 0; i < n; i++)
+		libatari800_clear_input_array(&pool->inputs[i]);
+	pool->pids = (pid_t *) Util_malloc(n * sizeof(pid_t));
+	fflush(NULL);
+
+	for (i = 0; i < n; i++) {
+		pool->pids[i] = fork();
+		if (pool->pids[i] == 0) {
+			/* worker */
+			libatari800_pool_t *p;
+			for (p = pools; p != NULL; p = p->next)
+				munmap(p->arena, p->arena_size);
+			serve(pool, i);
+		}
+		if (pool->pids[i] < 0) {
+			pool->n = i;
+			libatari800_pool_free(pool);
+			return NULL;
+		}
+	}
+	pool->next = pools;
+	pools = pool;
+	return pool;
+}
+
+
+/** Return the shared input templates of a pool
+ *
+ * The array has one \a input_template_t for each worker. Inputs written here
+ * are used by the next \a libatari800_pool_step_all called with NULL inputs,
+ * which avoids copying them.
+ */
+input_template_t *libatari800_pool_get_input_array(libatari800_pool_t *pool)
+{
+	return pool->inputs;
+}
+
+
+/** Start a step of all workers of a pool
+ *
+ * Every worker emulates \a frames frames as \a libatari800_run_frames would,
+ * using its own input template for all of them. The call returns immediately;
+ * use \a libatari800_pool_wait_all to wait for the results.
+ *
+ * @param pool handle returned by \a libatari800_pool_new
+ * @param inputs array of one input template per worker, or NULL to use the
+ * templates already in the array returned by \a libatari800_pool_get_input_array
+ * @param frames number of frames to emulate
+ * @param flags \a LIBATARI800_RUN_SKIP_SOUND or 0, as described in \a
+ * libatari800_run_frames
+ *
+ * @retval FALSE if the pool is still busy
+ * @retval TRUE if successful
+ */
+int libatari800_pool_step_all(libatari800_pool_t *pool, const input_template_t *inputs, int frames, int flags)
+{
+	int i;
+
+	if (pool->busy || frames < 0)
+		return FALSE;
+	if (inputs != NULL && inputs != pool->inputs)
+		memcpy(pool->inputs, inputs, pool->n * sizeof(input_template_t));
+	for (i = 0; i < pool->n; i++) {
+		pool_control_t *ctl = &pool->control[i];
+		ctl->command = CMD_RUN;
+		ctl->frames = frames;
+		ctl->flags = flags;
+		BARRIER();
+		ctl->seq++;
+		wake(&ctl->seq);
+	}
+	pool->busy = TRUE;
+	return TRUE;
+}
+
+
+/** Wait for all workers of a pool to finish their step
+ *
+ * After this returns, the results are available through \a
+ * libatari800_pool_get_screen_ptr and the other accessors.
+ *
+ * @param pool handle returned by \a libatari800_pool_new
+ *
+ * @retval FALSE if a worker has died; its results are not updated
+ * @retval TRUE if all workers finished
+ */
+int libatari800_pool_wait_all(libatari800_pool_t *pool)
+{
+	int ok = TRUE;
+	int i;
+
+	if (!pool->busy)
+		return TRUE;
+	for (i = 0; i < pool->n; i++) {
+		pool_control_t *ctl = &pool->control[i];
+		int done;
+		while ((done = ctl->done) != ctl->seq) {
+			wait_change(&ctl->done, done);
+			if (ctl->done == done && !worker_alive(pool, i)) {
+				ok = FALSE;
+				break;
+			}
+		}
+	}
+	BARRIER();
+	pool->busy = FALSE;
+	return ok;
+}
+
+
+/** Return a worker of a pool to its initial state
+ *
+ * The worker goes back to the state the emulator was in when \a
+ * libatari800_pool_new was called, at the start of the next step.
+ */
+void libatari800_pool_reset(libatari800_pool_t *pool, int worker)
+{
+	pool->control[worker].reset = TRUE;
+}
+
+
+/** Return the return code of the last frame emulated by a worker
+ *
+ * Uses the values documented for \a libatari800_next_frame.
+ */
+int libatari800_pool_get_status(libatari800_pool_t *pool, int worker)
+{
+	return pool->control[worker].status;
+}
+
+
+/** Return the error code of the last frame emulated by a worker */
+int libatari800_pool_get_error_code(libatari800_pool_t *pool, int worker)
+{
+	return pool->control[worker].error_code;
+}
+
+
+/** Return the frame number of a worker after its last step */
+int libatari800_pool_get_frame_number(libatari800_pool_t *pool, int worker)
+{
+	return pool->control[worker].frame_number;
+}
+
+
+/** Return pointer to screen data of a worker after its last step
+ *
+ * The layout is the same as described in \a libatari800_get_screen_ptr. The
+ * screens of all workers follow each other in memory.
+ */
+UBYTE *libatari800_pool_get_screen_ptr(libatari800_pool_t *pool, int worker)
+{
+	return pool->screens + (size_t) worker * Screen_HEIGHT * Screen_WIDTH;
+}
+
+
+/** Return pointer to a copy of the 64k main memory of a worker after its last
+ * step
+ *
+ * The copies of all workers follow each other in memory.
+ */
+UBYTE *libatari800_pool_get_main_memory_ptr(libatari800_pool_t *pool, int worker)
+{
+	return pool->ram + (size_t) worker * 65536;
+}
+
+
+/** Return pointer to sound data of the last frame of a worker */
+UBYTE *libatari800_pool_get_sound_buffer(libatari800_pool_t *pool, int worker)
+{
+	return pool->sound + worker * pool->sound_size;
+}
+
+
+/** Return the usable size of the sound buffer of a worker */
+int libatari800_pool_get_sound_buffer_len(libatari800_pool_t *pool, int worker)
+{
+	return (int) pool->control[worker].sound_len;
+}
+
+
+/** Terminate a pool
+ *
+ * Stops all worker processes and releases all resources of the pool.
+ *
+ * @param pool handle returned by \a libatari800_pool_new
+ */
+void libatari800_pool_free(libatari800_pool_t *pool)
+{
+	libatari800_pool_t **p;
+	int i;
+
+	libatari800_pool_wait_all(pool);
+	for (i = 0; i < pool->n; i++) {
+		pool_control_t *ctl = &pool->control[i];
+		ctl->command = CMD_QUIT;
+		BARRIER();
+		ctl->seq++;
+		wake(&ctl->seq);
+	}
+	for (i = 0; i < pool->n; i++) {
+		if (pool->pids[i] > 0) {
+			while (waitpid(pool->pids[i], NULL, 0) < 0 && errno == EINTR)
+				;
+		}
+	}
+	munmap(pool->arena, pool->arena_size);
+	for (p = &pools; *p != NULL; p = &(*p)->next) {
+		if (*p == pool) {
+			*p = pool->next;
+			break;
+		}
+	}
+	free(pool->pids);
+	free(pool);
+}
+
+#else /* defined(HAVE_FORK) && defined(HAVE_MMAP) ... */
+
+libatari800_pool_t *libatari800_pool_new(int n)
+{
+	return NULL;
+}
+
+input_template_t *libatari800_pool_get_input_array(libatari800_pool_t *pool)
+{
+	return NULL;
+}
+
+int libatari800_pool_step_all(libatari800_pool_t *pool, const input_template_t *inputs, int frames, int flags)
+{
+	return FALSE;
+}
+
+int libatari800_pool_wait_all(libatari800_pool_t *pool)
+{
+	return FALSE;
+}
+
+void libatari800_pool_reset(libatari800_pool_t *pool, int worker)
+{
+}
+
+int libatari800_pool_get_status(libatari800_pool_t *pool, int worker)
+{
+	return 0;
+}
+
+int libatari800_pool_get_error_code(libatari800_pool_t *pool, int worker)
+{
+	return 0;
+}
+
+int libatari800_pool_get_frame_number(libatari800_pool_t *pool, int worker)
+{
+	return 0;
+}
+
+UBYTE *libatari800_pool_get_screen_ptr(libatari800_pool_t *pool, int worker)
+{
+	return NULL;
+}
+
+UBYTE *libatari800_pool_get_main_memory_ptr(libatari800_pool_t *pool, int worker)
+{
+	return NULL;
+}
+
+UBYTE *libatari800_pool_get_sound_buffer(libatari800_pool_t *pool, int worker)
+{
+	return NULL;
+}
+
+int libatari800_pool_get_sound_buffer_len(libatari800_pool_t *pool, int worker)
+{
+	return 0;
+}
+
+void libatari800_pool_free(libatari800_pool_t *pool)
+{
+}
+
+#endif /* defined(HAVE_FORK) && defined(HAVE_MMAP) ... */
+
+/*
+vim:ts=4:sw=4:
+*/
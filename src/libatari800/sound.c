@@ -109,3 +109,13 @@ void PLATFORM_SoundWrite(UBYTE const *buffer, unsigned int size)
 	memcpy(LIBATARI800_Sound_array, buffer, size);
 	sound_array_fill = size;
 }
+
+/* Called instead of Sound_Update for frames whose audio is not wanted. Keeps
+   the frame-to-frame variation of the buffer size in step with the frames
+   that are synthesized. */
+void LIBATARI800_Sound_SkipFrame(void)
+{
+	if (Sound_enabled)
+		PLATFORM_SoundAvailable();
+	sound_array_fill = 0;
+}
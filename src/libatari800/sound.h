@@ -12,4 +12,6 @@ extern unsigned int sound_hw_buffer_size;
 
 extern double sample_residual;
 
+void LIBATARI800_Sound_SkipFrame(void);
+
 #endif /* LIBATARI800_SOUND_H_ */
@@ -27,11 +27,13 @@
 #include <string.h>
 
 #include "platform.h"
+#include "memory.h"
 #include "libatari800/statesav.h"
 #include "libatari800/init.h"
 
 UBYTE *LIBATARI800_StateSav_buffer = NULL;
 statesav_tags_t *LIBATARI800_StateSav_tags = NULL;
+ULONG LIBATARI800_StateSav_size = STATESAV_MAX_SIZE;
 
 
 void LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags) {
@@ -44,3 +46,42 @@ void LIBATARI800_StateLoad(UBYTE *buffer) {
     LIBATARI800_StateSav_buffer = buffer;
 	StateSav_ReadAtariState(NULL, NULL);
 }
+
+int LIBATARI800_StateSaveSized(UBYTE *buffer, ULONG size, statesav_tags_t *tags, int verbose) {
+	int status;
+
+	LIBATARI800_StateSav_buffer = buffer;
+	LIBATARI800_StateSav_tags = tags;
+	LIBATARI800_StateSav_size = size;
+	status = StateSav_SaveAtariState(NULL, NULL, (UBYTE)verbose);
+	LIBATARI800_StateSav_size = STATESAV_MAX_SIZE;
+	return status;
+}
+
+int LIBATARI800_StateLoadSized(UBYTE *buffer, ULONG size) {
+	int status;
+
+	LIBATARI800_StateSav_buffer = buffer;
+	LIBATARI800_StateSav_size = size;
+	status = StateSav_ReadAtariState(NULL, NULL);
+	LIBATARI800_StateSav_size = STATESAV_MAX_SIZE;
+	return status;
+}
+
+int LIBATARI800_StateSaveDelta(UBYTE *buffer, ULONG size, statesav_tags_t *tags) {
+	int status;
+
+	MEMORY_state_delta = TRUE;
+	status = LIBATARI800_StateSaveSized(buffer, size, tags, FALSE);
+	MEMORY_state_delta = FALSE;
+	return status;
+}
+
+int LIBATARI800_StateLoadDelta(UBYTE *buffer, ULONG size) {
+	int status;
+
+	MEMORY_state_delta = TRUE;
+	status = LIBATARI800_StateLoadSized(buffer, size);
+	MEMORY_state_delta = FALSE;
+	return status;
+}
@@ -11,8 +11,20 @@
 
 extern UBYTE *LIBATARI800_StateSav_buffer;
 extern statesav_tags_t *LIBATARI800_StateSav_tags;
+extern ULONG LIBATARI800_StateSav_size;
 
 void LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags);
 void LIBATARI800_StateLoad(UBYTE *buffer);
 
+/* Save/load using a buffer of the given size. Verbose saves include the
+   OS and BASIC ROMs, so they are suitable for moving between machines of
+   different types. Return FALSE if the buffer is too small. */
+int LIBATARI800_StateSaveSized(UBYTE *buffer, ULONG size, statesav_tags_t *tags, int verbose);
+int LIBATARI800_StateLoadSized(UBYTE *buffer, ULONG size);
+
+/* Save/load a delta state holding only the memory pages that differ from
+   the base snapshot taken by MEMORY_DeltaBase(), plus the chip state. */
+int LIBATARI800_StateSaveDelta(UBYTE *buffer, ULONG size, statesav_tags_t *tags);
+int LIBATARI800_StateLoadDelta(UBYTE *buffer, ULONG size);
+
 #endif /* LIBATARI800_STATESAV_H_ */
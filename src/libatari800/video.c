@@ -27,9 +27,16 @@
 #include <string.h>
 
 #include "platform.h"
+#include "antic.h"
+#include "colours.h"
 #include "screen.h"
+#include "libatari800/libatari800.h"
 #include "libatari800/video.h"
 
+LIBATARI800_observation_t LIBATARI800_observation = {NULL, LIBATARI800_OBS_PALETTE, 0, 0, 0, 0, 1, 1};
+
+static const int bytes_per_pixel[] = {1, 3, 4, 1, 4};
+
 void PLATFORM_DisplayScreen(void){
 }
 
@@ -39,3 +46,109 @@ int LIBATARI800_Video_Initialise(int *argc, char *argv[]) {
 
 void LIBATARI800_Video_Exit(void) {
 }
+
+int LIBATARI800_Video_SetObservation(LIBATARI800_observation_t *obs, UBYTE *buffer, int format,
+                                     int x, int y, int width, int height, int scale_x, int scale_y)
+{
+	if (format < LIBATARI800_OBS_PALETTE || format > LIBATARI800_OBS_XRGB32
+		|| x < 0 || y < 0 || x + width > Screen_WIDTH || y + height > Screen_HEIGHT
+		|| scale_x < 1 || scale_y < 1 || width < scale_x || height < scale_y
+		/* ANTIC writes XRGB32 pixels itself, as longs */
+		|| (format == LIBATARI800_OBS_XRGB32 && (scale_x != 1 || scale_y != 1 || ((size_t) buffer & 3) != 0))) {
+		obs->buffer = NULL;
+		return 0;
+	}
+	obs->buffer = buffer;
+	obs->format = format;
+	obs->x = x;
+	obs->y = y;
+	obs->width = width;
+	obs->height = height;
+	obs->scale_x = scale_x;
+	obs->scale_y = scale_y;
+	return (width / scale_x) * (height / scale_y) * bytes_per_pixel[format];
+}
+
+void LIBATARI800_Video_StartFrame(void)
+{
+	const LIBATARI800_observation_t *obs = &LIBATARI800_observation;
+
+	if (obs->buffer != NULL && obs->format == LIBATARI800_OBS_XRGB32)
+		ANTIC_SetRGBScreen((ULONG *) obs->buffer, obs->width, obs->x, obs->y, obs->width, obs->height);
+	else
+		ANTIC_SetRGBScreen(NULL, 0, 0, 0, 0, 0);
+}
+
+void LIBATARI800_Video_Observe(void)
+{
+	const LIBATARI800_observation_t *obs = &LIBATARI800_observation;
+	const UBYTE *src = (const UBYTE *) Screen_atari + obs->y * Screen_WIDTH + obs->x;
+	UBYTE *dest = obs->buffer;
+	int out_width = obs->width / obs->scale_x;
+	int out_height = obs->height / obs->scale_y;
+	int bpp;
+	int block = obs->scale_x * obs->scale_y;
+	int value[256][3];
+	int row;
+	int col;
+	int i;
+
+	/* XRGB32 has been written by ANTIC, scanline by scanline */
+	if (dest == NULL || obs->format == LIBATARI800_OBS_XRGB32)
+		return;
+
+	if (obs->format == LIBATARI800_OBS_PALETTE) {
+		/* no meaningful average of palette indices; take the top left pixel */
+		for (row = 0; row < out_height; row++) {
+			if (obs->scale_x == 1)
+				memcpy(dest, src, out_width);
+			else {
+				for (col = 0; col < out_width; col++)
+					dest[col] = src[col * obs->scale_x];
+			}
+			dest += out_width;
+			src += Screen_WIDTH * obs->scale_y;
+		}
+		return;
+	}
+
+	/* components of every palette entry, from the current Colours_table */
+	if (obs->format == LIBATARI800_OBS_LUMINANCE) {
+		bpp = 1;
+		for (i = 0; i < 256; i++)
+			value[i][0] = (Colours_GetR(i) * 77 + Colours_GetG(i) * 150 + Colours_GetB(i) * 29) >> 8;
+	}
+	else {
+		bpp = 3;
+		for (i = 0; i < 256; i++) {
+			value[i][0] = Colours_GetR(i);
+			value[i][1] = Colours_GetG(i);
+			value[i][2] = Colours_GetB(i);
+		}
+	}
+
+	for (row = 0; row < out_height; row++) {
+		for (col = 0; col < out_width; col++) {
+			int sum[3] = {0, 0, 0};
+			const UBYTE *p = src + col * obs->scale_x;
+			int bx;
+			int by;
+			for (by = 0; by < obs->scale_y; by++) {
+				for (bx = 0; bx < obs->scale_x; bx++) {
+					const int *v = value[p[bx]];
+					sum[0] += v[0];
+					if (bpp == 3) {
+						sum[1] += v[1];
+						sum[2] += v[2];
+					}
+				}
+				p += Screen_WIDTH;
+			}
+			for (i = 0; i < bpp; i++)
+				*dest++ = (UBYTE) (sum[i] / block);
+			if (obs->format == LIBATARI800_OBS_RGBA32)
+				*dest++ = 0xff;
+		}
+		src += Screen_WIDTH * obs->scale_y;
+	}
+}
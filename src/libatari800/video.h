@@ -4,8 +4,34 @@
 #include <stdio.h>
 
 #include "config.h"
+#include "atari.h"
 
 int LIBATARI800_Video_Initialise(int *argc, char *argv[]);
 void LIBATARI800_Video_Exit(void);
 
+/* Caller-supplied buffer that receives a converted copy of every drawn frame */
+typedef struct {
+	UBYTE *buffer;
+	int format;
+	int x;
+	int y;
+	int width;
+	int height;
+	int scale_x;
+	int scale_y;
+} LIBATARI800_observation_t;
+
+extern LIBATARI800_observation_t LIBATARI800_observation;
+
+/* Validates the parameters and stores them in obs. Returns the number of
+   bytes written to buffer per frame, or 0 if the parameters are invalid. */
+int LIBATARI800_Video_SetObservation(LIBATARI800_observation_t *obs, UBYTE *buffer, int format,
+                                     int x, int y, int width, int height, int scale_x, int scale_y);
+
+/* Prepares the observation of the frame that ANTIC is about to draw. */
+void LIBATARI800_Video_StartFrame(void);
+
+/* Writes the current screen into the observation buffer, if any. */
+void LIBATARI800_Video_Observe(void);
+
 #endif /* LIBATARI800_VIDEO_H_ */
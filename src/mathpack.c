@@ -0,0 +1,1254 @@
+/*
+ * mathpack.c - Native floating point package
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* The routines below are the AltirraOS floating point package
+   (emuos/src/mathpack.s) rewritten in C, instruction by instruction.
+   Programs not only use the results left in FR0 but also rely on
+   the scratch bytes, the registers and the flags, so everything the 6502
+   code leaves behind is reproduced - only the stack below S and the time
+   taken differ. The patches are therefore installed only if the package
+   in the OS is byte for byte the one translated here. */
+
+#include "config.h"
+#include "atari.h"
+#include "cpu.h"
+#include "crc32.h"
+#include "esc.h"
+#include "mathpack.h"
+#include "memory.h"
+
+int MATHPACK_enable_patch = FALSE;
+
+/* CRC32 of $D800-$DFFF of AltirraOS (both the 800 and the XL version). */
+#define ALTIRRA_CRC 0x1cbd5c95
+
+/* Page zero variables. */
+#define FR0      0xd4
+#define FR3      0xda
+#define FR1      0xe0
+#define FR2      0xe6
+#define CIX      0xf2
+#define INBUFF   0xf3
+#define ZTEMP4   0xf7
+#define FLPTR    0xfc
+#define LBUFF    0x0580
+
+/* Tables in the ROM. */
+#define TAB_LO_100    0xd8db
+#define TAB_MUL10     0xda39
+#define TAB_LO_1000   0xdf48
+#define TAB_HI_1000   0xdf52
+#define TAB_HI_100    0xdf5c
+#define TAB_HI_10000  0xdf66
+#define TAB_DECTOBIN  0xdff6
+
+/* 6502 registers. As in CPU_GO, the N flag is bit 7 of N
+   and the Z flag is set if Z == 0. */
+static UBYTE A, X, Y, N, Z;
+static int C, V, D;
+
+/* Unpatched $D800-$FFFF, so that tables are read as the ROM reads them,
+   even past their ends. */
+static const UBYTE *rom;
+
+#define ZP(addr)           MEMORY_dGetByte((UBYTE) (addr))
+#define PUT_ZP(addr, byte) MEMORY_dPutByte((UBYTE) (addr), byte)
+/* LDA/ADC/SBC/STA have no zero page,Y mode: abs,Y does not wrap. */
+#define ABS_Y(addr)        MEMORY_dGetByte((addr) + Y)
+#define PUT_ABS_Y(addr, byte) MEMORY_dPutByte((addr) + Y, byte)
+#define ROM(addr)          rom[(addr) - 0xd800]
+
+/* (INBUFF),Y */
+static UWORD InbuffY(void)
+{
+	return (UWORD) (ZP(INBUFF) + (ZP(INBUFF + 1) << 8) + Y);
+}
+
+static UBYTE GetInbuffY(void)
+{
+	UWORD addr = InbuffY();
+	return MEMORY_GetByte(addr);
+}
+
+static void PutInbuffY(UBYTE byte)
+{
+	UWORD addr = InbuffY();
+	MEMORY_PutByte(addr, byte);
+}
+
+static void Lda(UBYTE data)
+{
+	A = N = Z = data;
+}
+
+static void Ldx(UBYTE data)
+{
+	X = N = Z = data;
+}
+
+static void Ldy(UBYTE data)
+{
+	Y = N = Z = data;
+}
+
+static void Inx(void)
+{
+	N = Z = ++X;
+}
+
+static void Dex(void)
+{
+	N = Z = --X;
+}
+
+static void Iny(void)
+{
+	N = Z = ++Y;
+}
+
+static void Dey(void)
+{
+	N = Z = --Y;
+}
+
+static void Cmp(UBYTE reg, UBYTE data)
+{
+	C = reg >= data;
+	N = Z = (UBYTE) (reg - data);
+}
+
+static void Bit(UBYTE data)
+{
+	N = data;
+	V = (data & 0x40) != 0;
+	Z = A & data;
+}
+
+static void AslA(void)
+{
+	C = A >> 7;
+	A = N = Z = (UBYTE) (A << 1);
+}
+
+static void Asl(UBYTE addr)
+{
+	UBYTE data = ZP(addr);
+	C = data >> 7;
+	data <<= 1;
+	PUT_ZP(addr, data);
+	N = Z = data;
+}
+
+static void Rol(UBYTE addr)
+{
+	UBYTE data = ZP(addr);
+	int old_c = C;
+	C = data >> 7;
+	data = (UBYTE) ((data << 1) + old_c);
+	PUT_ZP(addr, data);
+	N = Z = data;
+}
+
+static void Lsr(UBYTE addr)
+{
+	UBYTE data = ZP(addr);
+	C = data & 1;
+	data >>= 1;
+	PUT_ZP(addr, data);
+	N = Z = data;
+}
+
+static void Ror(UBYTE addr)
+{
+	UBYTE data = ZP(addr);
+	int old_c = C;
+	C = data & 1;
+	data = (UBYTE) ((data >> 1) + (old_c << 7));
+	PUT_ZP(addr, data);
+	N = Z = data;
+}
+
+static void Inc(UBYTE addr)
+{
+	UBYTE data = ZP(addr) + 1;
+	PUT_ZP(addr, data);
+	N = Z = data;
+}
+
+static void Dec(UBYTE addr)
+{
+	UBYTE data = ZP(addr) - 1;
+	PUT_ZP(addr, data);
+	N = Z = data;
+}
+
+/* Same as the adc/sbc code in CPU_GO. */
+static void Adc(UBYTE data)
+{
+	if (!D) {
+		unsigned int tmp = A + data + C;
+		C = tmp > 0xff;
+		V = !((A ^ data) & 0x80) && ((data ^ tmp) & 0x80);
+		Z = N = A = (UBYTE) tmp;
+	}
+	else {
+		unsigned int tmp = (A & 0x0f) + (data & 0x0f) + C;
+		if (tmp >= 0x0a)
+			tmp = ((tmp + 0x06) & 0x0f) + 0x10;
+		tmp += (A & 0xf0) + (data & 0xf0);
+		Z = A + data + C;
+		N = (UBYTE) tmp;
+		V = !((A ^ data) & 0x80) && ((data ^ tmp) & 0x80);
+		if (tmp >= 0xa0)
+			tmp += 0x60;
+		C = tmp > 0xff;
+		A = (UBYTE) tmp;
+	}
+}
+
+static void Sbc(UBYTE data)
+{
+	if (!D) {
+		unsigned int tmp = A - data - 1 + C;
+		C = tmp < 0x100;
+		V = ((A ^ data) & 0x80) && ((A ^ tmp) & 0x80);
+		Z = N = A = (UBYTE) tmp;
+	}
+	else {
+		unsigned int tmp = (A & 0x0f) - (data & 0x0f) - 1 + C;
+		if (tmp & 0x10)
+			tmp = ((tmp - 0x06) & 0x0f) - 0x10;
+		tmp += (A & 0xf0) - (data & 0xf0);
+		if (tmp & 0x100)
+			tmp -= 0x60;
+		Z = N = A - data - 1 + C;
+		V = ((A ^ data) & 0x80) && ((A ^ Z) & 0x80);
+		C = ((unsigned int) (A - data - 1 + C)) <= 0xff;
+		A = (UBYTE) tmp;
+	}
+}
+
+/* ZFL: clears Y bytes of page zero from X. */
+static void Zfl(void)
+{
+	A = 0;
+	do {
+		PUT_ZP(X, A);
+		X++;
+		Dey();
+	} while (Y != 0);
+}
+
+static void Zfr0(void)
+{
+	X = FR0;
+	Y = 6;
+	Zfl();
+}
+
+/* ZF1 */
+static void Zf1(void)
+{
+	Y = 6;
+	Zfl();
+}
+
+/* NORMALIZE: shifts zero bytes out of the mantissa of FR0 (with $DA as
+   the sixth byte) and checks the exponent range. */
+static void Normalize(void)
+{
+	Y = 5;
+	for (;;) {
+		Lda(ZP(FR0) & 0x7f);
+		if (A == 0) {
+			C = 0;
+			Zfr0();
+			return;
+		}
+		Ldx(ZP(FR0 + 1));
+		if (X != 0) {
+			Cmp(A, 64 - 49);
+			if (!C) {
+				Zfr0();
+				return;
+			}
+			Cmp(A, 64 + 49);
+			return;
+		}
+		Dec(FR0);
+		for (X = 0xfb; X != 0; Inx()) {
+			Lda(ZP(FR0 + 7 + X));
+			PUT_ZP(FR0 + 6 + X, A);
+		}
+		PUT_ZP(FR0 + 6, X);
+		Dey();
+		if (Y == 0)
+			break;
+	}
+	PUT_ZP(FR0, Y);
+	PUT_ZP(FR0 + 1, Y);
+	C = 0;
+}
+
+static void NormalizeCld(void)
+{
+	D = 0;
+	Normalize();
+}
+
+/* Exchanges FR0 and FR1. */
+static void Swap(void)
+{
+	X = 5;
+	do {
+		A = ZP(FR0 + X);
+		Y = ZP(FR1 + X);
+		PUT_ZP(FR1 + X, A);
+		PUT_ZP(FR0 + X, Y);
+		Dex();
+	} while (!(N & 0x80));
+}
+
+/* Shifts the mantissa of FR0 right by a byte and puts $01 on top. */
+static void CarryExpUp(void)
+{
+	Inc(FR0);
+	X = 4;
+	do {
+		Lda(ZP(FR0 + X));
+		PUT_ZP(FR0 + 1 + X, A);
+		Dex();
+	} while (X != 0);
+	Inx();
+	PUT_ZP(FR0 + 1, X);
+}
+
+/* FADD: FR0 + FR1 -> FR0. */
+static void Fadd(void)
+{
+	for (;;) {
+		Lda(ZP(FR1));
+		if (A == 0)
+			goto sum_xit;
+		Lda(ZP(FR0));
+		if (A != 0) {
+			/* Difference of exponents, ignoring signs. */
+			A = (ZP(FR1) ^ ZP(FR0)) & 0x80;
+			X = A;
+			A ^= ZP(FR1);
+			C = 0;
+			Sbc(ZP(FR0));
+			if (!C)
+				break;
+		}
+		Swap();
+	}
+	Adc(6);
+	Y = N = Z = A;
+	if (N & 0x80)
+		goto sum_xit;
+	D = 1;
+	Cmp(X, 0x80);
+	Ldx(5);
+	if (C)
+		goto do_subtract;
+
+	/* Rounding. */
+	Lda(0);
+	Cmp(Y, 5);
+	if (!C)
+		Lda(ABS_Y(FR1 + 1));
+	Cmp(A, 0x50);
+	A = N = Z = Y;
+	while (Y != 0) {
+		Lda(ABS_Y(FR1));
+		Adc(ZP(FR0 + X));
+		PUT_ZP(FR0 + X, A);
+		Dex();
+		Dey();
+	}
+	if (!C)
+		goto sum_xit;
+	goto sum_carryloop_start;
+sum_carryloop:
+	Lda(ZP(FR0 + 1 + X));
+	Adc(0);
+	PUT_ZP(FR0 + 1 + X, A);
+	if (!C)
+		goto sum_xit;
+sum_carryloop_start:
+	Dex();
+	if (!(N & 0x80))
+		goto sum_carryloop;
+	CarryExpUp();
+sum_xit:
+	NormalizeCld();
+	return;
+
+do_subtract:
+	PUT_ZP(FR1, Y);
+	for (;;) {
+		Dey();
+		if (N & 0x80)
+			break;
+		Lda(ZP(FR0 + X));
+		Sbc(ABS_Y(FR1 + 1));
+		PUT_ZP(FR0 + X, A);
+		Dex();
+	}
+	if (!C) {
+		/* Propagate the borrow up. */
+		for (;;) {
+			Dex();
+			if (N & 0x80) {
+				/* The difference is negative: negate it. */
+				X = 5;
+				C = 1;
+				do {
+					A = 0;
+					Sbc(ZP(FR0 + X));
+					PUT_ZP(FR0 + X, A);
+					Dex();
+				} while (X != 0);
+				Lda(ZP(FR0) ^ 0x80);
+				PUT_ZP(FR0, A);
+				break;
+			}
+			Lda(ZP(FR0 + 1 + X));
+			Sbc(0);
+			PUT_ZP(FR0 + 1 + X, A);
+			if (C)
+				break;
+		}
+	}
+	for (;;) {
+		Lda(ZP(FR0) & 0x7f);
+		Cmp(A, 64 - 49);
+		if (!C)
+			break;
+		Ldx(ZP(FR0 + 1));
+		if (X != 0) {
+			Ldx(ZP(FR1));
+			Cmp(X, 4);
+			if (!C) {
+				Lda(ZP(FR1 + 2 + X));
+				Cmp(A, 0x50);
+				if (C) {
+					Ldx(5);
+					goto sum_carryloop;
+				}
+			}
+			C = 0;
+			D = 0;
+			return;
+		}
+		/* Find the first non-zero byte of the mantissa. */
+		for (X = 0xfc; ; ) {
+			Dec(FR0);
+			Ldy(ZP(FR0 + 6 + X));
+			if (Y != 0)
+				break;
+			Inx();
+			if (X == 0) {
+				C = 0;
+				D = 0;
+				Zfr0();
+				return;
+			}
+		}
+		Y = 0;
+		do {
+			Lda(ZP(FR0 + 6 + X));
+			PUT_ABS_Y(FR0 + 1, A);
+			Iny();
+			Inx();
+		} while (X != 0);
+		do {
+			PUT_ZP(FR0 + 1 + Y, X);
+			Iny();
+			Cmp(Y, 6);
+		} while (Y != 6);
+	}
+	D = 0;
+	Zfr0();
+}
+
+/* FSUB: FR0 - FR1 -> FR0. */
+static void Fsub(void)
+{
+	Lda(ZP(FR1) ^ 0x80);
+	PUT_ZP(FR1, A);
+	Fadd();
+}
+
+/* Propagates a carry from the byte before X up through FR0,
+   adding A to byte X first if ADD. */
+static void FmulCarryUp(int add)
+{
+	for (;;) {
+		if (add) {
+			Adc(ZP(FR0 + X));
+			PUT_ZP(FR0 + X, A);
+		}
+		add = TRUE;
+		Dex();
+		Lda(0);
+		if (!C)
+			return;
+	}
+}
+
+/* Computes the exponent of a product (C = 0) or quotient (C = 1) from
+   A and the exponent of FR0. Returns FALSE if it is out of range;
+   FR0 is cleared then and C is set on overflow. */
+static int AdjustExponent(void)
+{
+	X = A;
+	PUT_ZP(FR1, (A ^ ZP(FR0)) & 0x80);
+	Adc(ZP(FR0));
+	X = A;
+	A ^= ZP(FR1);
+	Cmp(A, 128 - 49);
+	if (C) {
+		Cmp(A, 128 + 49);
+		if (!C) {
+			A = X;
+			Sbc(0x40 - 1);
+			return TRUE;
+		}
+	}
+	Zfr0();
+	return FALSE;
+}
+
+/* FMUL: FR0 * FR1 -> FR0. */
+static void Fmul(void)
+{
+	int i;
+	Lda(ZP(FR0));
+	if (A == 0) {
+		C = 0;
+		return;
+	}
+	Lda(ZP(FR1));
+	C = 0;
+	if (A == 0) {
+		Zfr0();
+		return;
+	}
+
+	/* Inverted binary digit pairs of FR0 into FR2. */
+	X = 4;
+	do {
+		Y = ZP(FR0 + 1 + X) >> 4;
+		C = 0;
+		Lda(ZP(FR0 + 1 + X));
+		Adc(ROM(TAB_DECTOBIN + Y));
+		A ^= 0xff;
+		PUT_ZP(FR2 + 1 + X, A);
+		Dex();
+	} while (!(N & 0x80));
+
+	Lda(ZP(FR1));
+	C = 0;
+	if (!AdjustExponent())
+		return;
+	PUT_ZP(FR0, A);
+	Inc(FR0);
+
+	/* Clear the accumulator FR0+1 to FR1. */
+	X = FR0 + 1;
+	Y = 12;
+	D = 1;
+	Zfl();
+	Y = 7;
+	A = 0x50;
+	PUT_ZP(FR0 + 7, A);
+	do {
+		X = 5;
+		do {
+			Lsr(FR2 + X);
+			if (!C) {
+				for (i = 5; i >= 0; i--) {
+					Lda(ZP(FR0 + i + X));
+					Adc(ZP(FR1 + i));
+					PUT_ZP(FR0 + i + X, A);
+				}
+				if (C) {
+					PUT_ZP(FR2, X);
+					FmulCarryUp(FALSE);
+					Ldx(ZP(FR2));
+				}
+			}
+			Dex();
+		} while (X != 0);
+		/* Double FR1. */
+		C = 0;
+		for (i = 5; i >= 0; i--) {
+			Lda(ZP(FR1 + i));
+			Adc(A);
+			PUT_ZP(FR1 + i, A);
+		}
+		Dey();
+	} while (Y != 0);
+
+	Lda(ZP(FR0 + 1));
+	if (A != 0) {
+		A = 0x50;
+		X = 6;
+		FmulCarryUp(TRUE);
+	}
+	NormalizeCld();
+}
+
+/* FDIV: FR0 / FR1 -> FR0. */
+#define FDIV_DIGIT (FR3 + 1)
+#define FDIV_INDEX (FR3 + 2)
+
+static void Fdiv(void)
+{
+	int i;
+	Lda(ZP(FR1));
+	if (A == 0) {
+		C = 1;
+		return;
+	}
+	Lda(ZP(FR0));
+	if (A == 0) {
+		C = 0;
+		return;
+	}
+	Lda(ZP(FR1) ^ 0x7f);
+	C = 1;
+	if (!AdjustExponent())
+		return;
+
+	PUT_ZP(FR3, A);
+	X = FR2 + 1;
+	Zf1();
+	A = 0x50;
+	PUT_ZP(FR2 + 7, A);
+	PUT_ZP(FR2, A);
+	Ldx(0);
+	PUT_ZP(FR0, X);
+	PUT_ZP(FR1, X);
+	Lda(ZP(FR1 + 1));
+	Cmp(A, 0x10);
+	if (!C) {
+		Y = 4;
+		do {
+			Asl(FR1 + 5);
+			Rol(FR1 + 4);
+			Rol(FR1 + 3);
+			Rol(FR1 + 2);
+			Rol(FR1 + 1);
+			Dey();
+		} while (Y != 0);
+		Ldx(0x09);
+	}
+	PUT_ZP(FDIV_DIGIT, X);
+	D = 1;
+	Ldx(0xf9);
+	PUT_ZP(FDIV_INDEX, X);
+	C = 1;
+
+	for (;;) {
+		int saved_c;
+		Lda(ZP(FR0) | ZP(FR0 + 1));
+		if (A != 0) {
+			if (C) {
+				do {
+					Lda(ZP(FDIV_DIGIT));
+					Ldx(ZP(FDIV_INDEX));
+					do {
+						Adc(ZP(FR2 + 8 + X));
+						PUT_ZP(FR2 + 8 + X, A);
+						Lda(0);
+						Dex();
+					} while (C);
+					C = 1;
+					for (i = 5; i >= 1; i--) {
+						Lda(ZP(FR0 + i));
+						Sbc(ZP(FR1 + i));
+						PUT_ZP(FR0 + i, A);
+					}
+					Lda(ZP(FR0));
+					Sbc(0);
+					PUT_ZP(FR0, A);
+				} while (C);
+			}
+			else {
+				do {
+					Lda(0);
+					Sbc(ZP(FDIV_DIGIT));
+					Ldx(ZP(FDIV_INDEX));
+					do {
+						Adc(ZP(FR2 + 8 + X));
+						PUT_ZP(FR2 + 8 + X, A);
+						Lda(0x99);
+						Dex();
+					} while (!C);
+					C = 0;
+					for (i = 5; i >= 0; i--) {
+						Lda(ZP(FR0 + i));
+						Adc(ZP(FR1 + i));
+						PUT_ZP(FR0 + i, A);
+					}
+				} while (!C);
+			}
+		}
+		/* Shift the dividend, keeping the carry (PHP/PLP). */
+		saved_c = C;
+		X = 4;
+		do {
+			Asl(FR0 + 5);
+			Rol(FR0 + 4);
+			Rol(FR0 + 3);
+			Rol(FR0 + 2);
+			Rol(FR0 + 1);
+			Rol(FR0);
+			Dex();
+		} while (X != 0);
+		C = saved_c;
+		Lda(ZP(FDIV_DIGIT) ^ 0x09);
+		PUT_ZP(FDIV_DIGIT, A);
+		if (A == 0)
+			continue;
+		Inc(FDIV_INDEX);
+		if (Z == 0)
+			break;
+	}
+
+	/* Move the quotient back to FR0. */
+	Ldx(FR2);
+	Ldy(ZP(FR3));
+	Lda(ZP(FR2 + 1));
+	if (A == 0) {
+		Inx();
+		Dey();
+	}
+	PUT_ZP(X, Y);
+	Ldy(0);
+	PUT_ZP(FLPTR, X);
+	PUT_ZP(FLPTR + 1, Y);
+	Y = 5;
+	do {
+		Lda(ZP(X + Y));
+		PUT_ABS_Y(FR0, A);
+		Dey();
+	} while (!(N & 0x80));
+	D = 0;
+	C = 0;
+}
+
+/* IFP: integer in FR0 -> FR0. */
+static void Ifp(void)
+{
+	D = 1;
+	X = FR0 + 2;
+	Y = 5;
+	Zfl();
+	Y = 16;
+	do {
+		Asl(FR0);
+		Rol(FR0 + 1);
+		Lda(ZP(FR0 + 4));
+		Adc(A);
+		PUT_ZP(FR0 + 4, A);
+		Lda(ZP(FR0 + 3));
+		Adc(A);
+		PUT_ZP(FR0 + 3, A);
+		Rol(FR0 + 2);
+		Dey();
+	} while (Y != 0);
+	A = 0x43;
+	PUT_ZP(FR0, A);
+	NormalizeCld();
+}
+
+/* FPI: FR0 -> integer in FR0, rounded. */
+static void Fpi(void)
+{
+	UBYTE hi;
+	Lda(ZP(FR0));
+	Cmp(A, 0x43);
+	if (C)
+		return;
+	Sbc(0x3f - 1);
+	if (!C) {
+		Zfr0();
+		return;
+	}
+	X = A;
+
+	/* Rounding. */
+	Ldy(ZP(FR0 + 1 + X));
+	Cmp(Y, 0x50);
+	Lda((UBYTE) C);
+	C = 0;
+	PUT_ZP(FR0, A);
+	Lda(0);
+	Dex();
+	if (N & 0x80)
+		goto done;
+
+	/* Ones and tens. */
+	Lda(ZP(FR0 + 1 + X));
+	Y = A >> 4;
+	C = 0;
+	Adc(ZP(FR0));
+	Adc(ROM(TAB_DECTOBIN + Y));
+	C = 0;
+	PUT_ZP(FR0, A);
+	Lda(0);
+	Dex();
+	if (N & 0x80)
+		goto done;
+
+	/* Hundreds and thousands. */
+	Y = ZP(FR0 + 1 + X) >> 4;
+	C = 0;
+	Lda(ZP(FR0));
+	Adc(ROM(TAB_LO_1000 + Y));
+	PUT_ZP(FR0, A);
+	Lda(ROM(TAB_HI_1000 + Y));
+	Adc(0);
+	hi = A;
+	Y = ZP(FR0 + 1 + X) & 0x0f;
+	Lda(ZP(FR0));
+	Adc(ROM(TAB_LO_100 + Y));
+	PUT_ZP(FR0, A);
+	Lda(hi);
+	Adc(ROM(TAB_HI_100 + Y));
+	Dex();
+	if (N & 0x80)
+		goto done;
+
+	/* Ten thousands. */
+	Ldy(ZP(FR0 + 1 + X));
+	Cmp(Y, 0x07);
+	if (C)
+		return;
+	X = A;
+	A = Y;
+	AslA();
+	AslA();
+	AslA();
+	AslA();
+	Adc(ZP(FR0));
+	PUT_ZP(FR0, A);
+	A = X;
+	Adc(ROM(TAB_HI_10000 - 1 + Y));
+done:
+	PUT_ZP(FR0 + 1, A);
+}
+
+/* Compares the character at (INBUFF),Y with '0' to '9'. */
+static void IsDigitY(void)
+{
+	Lda(GetInbuffY());
+	C = 1;
+	Sbc('0');
+	Cmp(A, 10);
+}
+
+/* Skips characters A at (INBUFF),Y and stores Y in CIX. */
+static void SkipChar(void)
+{
+	for (;;) {
+		Cmp(A, GetInbuffY());
+		if (Z != 0)
+			break;
+		Iny();
+		if (Y == 0)
+			break;
+	}
+	PUT_ZP(CIX, Y);
+}
+
+/* AFP: text at (INBUFF),CIX -> FR0. */
+#define AFP_DOTFLAG FR2
+#define AFP_XINVERT (FR2 + 1)
+#define AFP_CIX0    (FR2 + 2)
+#define AFP_SIGN    (FR2 + 3)
+#define AFP_DIGIT2  (FR2 + 4)
+
+static void Afp(void)
+{
+	A = ' ';
+	Ldy(ZP(CIX));
+	SkipChar();
+
+	Lda(0x7f);
+	PUT_ZP(FR0, A);
+	PUT_ZP(AFP_DIGIT2, A);
+	X = FR0 + 1;
+	Zf1();
+	PUT_ZP(AFP_DOTFLAG, A);
+	PUT_ZP(AFP_SIGN, A);
+
+	/* Sign. */
+	Ldy(ZP(CIX));
+	Lda(GetInbuffY());
+	Cmp(A, '+');
+	if (Z == 0)
+		Iny();
+	else {
+		Cmp(A, '-');
+		if (Z == 0) {
+			Ror(AFP_SIGN);
+			Iny();
+		}
+	}
+	PUT_ZP(AFP_CIX0, Y);
+
+	/* Leading zeroes. */
+	Lda('0');
+	SkipChar();
+	Lda(GetInbuffY());
+	Cmp(A, '.');
+	if (Z == 0) {
+		Iny();
+		Ror(AFP_DOTFLAG);
+		Inc(AFP_CIX0);
+		Lda('0');
+		for (;;) {
+			Cmp(A, GetInbuffY());
+			if (Z != 0)
+				break;
+			Dec(FR0);
+			Iny();
+			if (Y == 0)
+				break;
+		}
+	}
+
+	/* Digits. */
+	Ldx(1);
+	for (;;) {
+		Lda(GetInbuffY());
+		Cmp(A, 'E');
+		if (Z == 0)
+			goto isexp;
+		Iny();
+		Cmp(A, '.');
+		if (Z == 0) {
+			Lda(ZP(AFP_DOTFLAG));
+			if (A != 0)
+				break;
+			Ror(AFP_DOTFLAG);
+			continue;
+		}
+		A ^= '0';
+		Cmp(A, 10);
+		if (C)
+			break;
+		Cmp(X, 6);
+		if (!C) {
+			Bit(ZP(AFP_DIGIT2));
+			if (N & 0x80) {
+				Dec(AFP_DIGIT2);
+				Lda(A | ZP(FR0 + X));
+				PUT_ZP(FR0 + X, A);
+				Inx();
+			}
+			else {
+				Inc(AFP_DIGIT2);
+				AslA();
+				AslA();
+				AslA();
+				AslA();
+				PUT_ZP(FR0 + X, A);
+			}
+		}
+		Bit(ZP(AFP_DOTFLAG));
+		if (!(N & 0x80))
+			Inc(FR0);
+	}
+	/* termcheck */
+	Dey();
+	Cmp(Y, ZP(AFP_CIX0));
+	if (Z == 0)
+		return;
+term:
+	PUT_ZP(CIX, Y);
+term_rollback_exp:
+	/* Halve the digit exponent and merge in the sign. */
+	Rol(AFP_SIGN);
+	Ror(FR0);
+	if (!C) {
+		X = 4;
+		do {
+			Lsr(FR0 + 1);
+			Ror(FR0 + 2);
+			Ror(FR0 + 3);
+			Ror(FR0 + 4);
+			Ror(FR0 + 5);
+			Dex();
+		} while (X != 0);
+	}
+	Normalize();
+	return;
+
+isexp:
+	Cmp(Y, ZP(AFP_CIX0));
+	if (Z == 0)
+		return;
+	PUT_ZP(CIX, Y);
+	Ldx(0);
+	Iny();
+	Lda(GetInbuffY());
+	Cmp(A, '+');
+	if (Z == 0)
+		Iny();
+	else {
+		Cmp(A, '-');
+		if (Z == 0) {
+			Dex();
+			Iny();
+		}
+	}
+	PUT_ZP(AFP_XINVERT, X);
+	IsDigitY();
+	Iny();
+	if (C)
+		goto term_rollback_exp;
+	X = A;
+	IsDigitY();
+	if (!C) {
+		Iny();
+		Adc(ROM(TAB_MUL10 + X));
+		X = A;
+	}
+	Lda(X);
+	if (A == 0)
+		goto term_rollback_exp;
+	A ^= ZP(AFP_XINVERT);
+	Rol(AFP_XINVERT);
+	Adc(ZP(FR0));
+	PUT_ZP(FR0, A);
+	goto term;
+}
+
+/* FASC: FR0 -> text at LBUFF, (INBUFF) points to it. */
+#define FASC_DOTCNTR  ZTEMP4
+#define FASC_EXPVAL   (ZTEMP4 + 1)
+#define FASC_TRIMBASE (ZTEMP4 + 2)
+
+static void Fasc(void)
+{
+	PUT_ZP(INBUFF, LBUFF & 0xff);
+	Lda(LBUFF >> 8);
+	PUT_ZP(INBUFF + 1, A);
+	Ldy(0);
+	Lda(ZP(FR0));
+	if (A == 0) {
+		Lda(0xb0);
+		PutInbuffY(A);
+		return;
+	}
+	PUT_ZP(FASC_EXPVAL, Y);
+	PUT_ZP(FASC_TRIMBASE, Y);
+	/* Sixth mantissa byte. */
+	PUT_ZP(FR0, Y);
+	if (N & 0x80) {
+		Ldx('-');
+		Dec(INBUFF);
+		MEMORY_dPutByte(LBUFF - 1, X);
+		Inc(FASC_TRIMBASE);
+		Iny();
+	}
+	Ldx(0xfb);
+
+	/* Where to put the dot, and whether to use an exponent. */
+	AslA();
+	C = 1;
+	Sbc(125);
+	Cmp(A, 12);
+	if (C) {
+		Sbc(2);
+		PUT_ZP(FASC_EXPVAL, A);
+		Lda(2);
+		Inc(FASC_TRIMBASE);
+		Inc(FASC_TRIMBASE);
+	}
+	Cmp(A, 2);
+	if (!C) {
+		Adc(2);
+		Dex();
+	}
+	PUT_ZP(FASC_DOTCNTR, A);
+
+	Lda(ZP(FR0 + 6 + X));
+	Cmp(A, 0x10);
+	if (!C) {
+		/* Skip the leading zero digit. */
+		Dec(FASC_TRIMBASE);
+		Lsr(FASC_EXPVAL);
+		Asl(FASC_EXPVAL);
+		if (Z == 0)
+			Dec(FASC_DOTCNTR);
+		goto writelow;
+	}
+	do {
+		Dec(FASC_DOTCNTR);
+		if (Z == 0) {
+			Lda('.');
+			PutInbuffY(A);
+			Iny();
+		}
+		A = ZP(FR0 + 6 + X);
+		C = (A >> 3) & 1;
+		Lda((A >> 4) | 0x30);
+		PutInbuffY(A);
+		Iny();
+	writelow:
+		Dec(FASC_DOTCNTR);
+		if (Z == 0) {
+			Lda('.');
+			PutInbuffY(A);
+			Iny();
+		}
+		Lda((ZP(FR0 + 6 + X) & 0x0f) | 0x30);
+		PutInbuffY(A);
+		Iny();
+		Inx();
+	} while (X != 0);
+
+	Lda(ZP(FASC_DOTCNTR));
+	if (N & 0x80) {
+		/* Trim trailing zeroes and the dot. */
+		Lda('0');
+		for (;;) {
+			Cmp(Y, ZP(FASC_TRIMBASE));
+			if (Z == 0)
+				break;
+			Dey();
+			Cmp(A, GetInbuffY());
+			if (Z != 0)
+				break;
+		}
+		Lda(GetInbuffY());
+		Cmp(A, '.');
+		if (Z != 0)
+			goto no_trailing_dot;
+	}
+	Dey();
+	Lda(GetInbuffY());
+no_trailing_dot:
+
+	Ldx(ZP(FASC_EXPVAL));
+	if (X != 0) {
+		UBYTE ones;
+		Lda('E');
+		Iny();
+		PutInbuffY(A);
+		Lda(X);
+		if (N & 0x80) {
+			X = A ^ 0xff;
+			Inx();
+			Lda('-');
+			/* The following LDA #'+' is skipped as the operand of BIT $2BA9. */
+			Bit(MEMORY_GetByte(0x2ba9));
+		}
+		else
+			Lda('+');
+		Iny();
+		PutInbuffY(A);
+		A = X;
+		C = 1;
+		X = 0x2f;
+		do {
+			Inx();
+			Sbc(10);
+		} while (C);
+		ones = A;
+		A = X;
+		Iny();
+		PutInbuffY(A);
+		Lda(ones);
+		Adc(0x3a);
+		Iny();
+	}
+	/* Set the high bit on the last character. */
+	Lda(A | 0x80);
+	PutInbuffY(A);
+}
+
+static void GetRegs(void)
+{
+	A = CPU_regA;
+	X = CPU_regX;
+	Y = CPU_regY;
+	N = CPU_regP;
+	Z = (CPU_regP & CPU_Z_FLAG) ^ CPU_Z_FLAG;
+	V = (CPU_regP & CPU_V_FLAG) != 0;
+	D = (CPU_regP & CPU_D_FLAG) != 0;
+	C = CPU_regP & CPU_C_FLAG;
+}
+
+static void PutRegs(void)
+{
+	CPU_regA = A;
+	CPU_regX = X;
+	CPU_regY = Y;
+	CPU_regP = (CPU_regP & ~(CPU_N_FLAG | CPU_V_FLAG | CPU_D_FLAG | CPU_Z_FLAG | CPU_C_FLAG))
+	         | (N & CPU_N_FLAG) | (V ? CPU_V_FLAG : 0) | (D ? CPU_D_FLAG : 0)
+	         | (Z == 0 ? CPU_Z_FLAG : 0) | (C ? CPU_C_FLAG : 0);
+}
+
+static void AfpHandler(void)  { GetRegs(); Afp();  PutRegs(); }
+static void FascHandler(void) { GetRegs(); Fasc(); PutRegs(); }
+static void IfpHandler(void)  { GetRegs(); Ifp();  PutRegs(); }
+static void FpiHandler(void)  { GetRegs(); Fpi();  PutRegs(); }
+static void FsubHandler(void) { GetRegs(); Fsub(); PutRegs(); }
+static void FaddHandler(void) { GetRegs(); Fadd(); PutRegs(); }
+static void FmulHandler(void) { GetRegs(); Fmul(); PutRegs(); }
+static void FdivHandler(void) { GetRegs(); Fdiv(); PutRegs(); }
+
+void MATHPACK_PatchOS(void)
+{
+	if (MATHPACK_enable_patch && Atari800_machine_type != Atari800_MACHINE_5200) {
+		int const os_rom_start = Atari800_machine_type == Atari800_MACHINE_800 ? 0xd800 : 0xc000;
+		rom = MEMORY_os + 0xd800 - os_rom_start;
+		if ((CRC32_Update(0xffffffff, rom, 0x800) ^ 0xffffffff) == ALTIRRA_CRC) {
+			ESC_AddEscRts(0xd800, ESC_AFP, AfpHandler);
+			ESC_AddEscRts(0xd8e6, ESC_FASC, FascHandler);
+			ESC_AddEscRts(0xd9aa, ESC_IFP, IfpHandler);
+			ESC_AddEscRts(0xd9d2, ESC_FPI, FpiHandler);
+			ESC_AddEscRts(0xda60, ESC_FSUB, FsubHandler);
+			ESC_AddEscRts(0xda66, ESC_FADD, FaddHandler);
+			ESC_AddEscRts(0xdadb, ESC_FMUL, FmulHandler);
+			ESC_AddEscRts(0xdb28, ESC_FDIV, FdivHandler);
+			return;
+		}
+	}
+	ESC_Remove(ESC_AFP);
+	ESC_Remove(ESC_FASC);
+	ESC_Remove(ESC_IFP);
+	ESC_Remove(ESC_FPI);
+	ESC_Remove(ESC_FSUB);
+	ESC_Remove(ESC_FADD);
+	ESC_Remove(ESC_FMUL);
+	ESC_Remove(ESC_FDIV);
+}
@@ -0,0 +1,12 @@
+#ifndef MATHPACK_H_
+#define MATHPACK_H_
+
+/* TRUE to replace the routines of the OS floating point package with
+   native code, if the package is a known one. */
+extern int MATHPACK_enable_patch;
+
+/* Installs (or removes, if disabled) the floating point patches.
+   Called by ESC_PatchOS when the OS has just been restored. */
+void MATHPACK_PatchOS(void);
+
+#endif /* MATHPACK_H_ */
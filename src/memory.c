@@ -102,6 +102,9 @@ static void MosaicPutByte(UWORD addr, UBYTE byte);
 static UBYTE MosaicGetByte(UWORD addr, int no_side_effects);
 static void AxlonPutByte(UWORD addr, UBYTE byte);
 static UBYTE AxlonGetByte(UWORD addr, int no_side_effects);
+#ifndef PAGED_MEM
+static void InitHwMaps(void);
+#endif
 static UBYTE *axlon_ram = NULL;
 static int axlon_current_bankmask = 0;
 int axlon_curbank = 0;
@@ -117,6 +120,90 @@ int MEMORY_enable_mapram = FALSE;
 /* Buffer for storing of MapRAM memory. */
 static UBYTE *mapram_memory = NULL;
 
+/* Banked RAM blocks, saved page by page in delta state snapshots. */
+enum {
+	BLOCK_UNDER_OS,
+	BLOCK_UNDER_CARTA0BF,
+	BLOCK_XE,
+	BLOCK_ANTIC_UNDER_SELFTEST,
+	BLOCK_MAPRAM,
+	BLOCK_AXLON,
+	BLOCK_MOSAIC,
+	BLOCK_COUNT
+};
+
+UBYTE MEMORY_dirty[256];
+
+#ifdef LIBATARI800
+/* Delta state snapshots: pages written since the base snapshot are flagged in
+   MEMORY_dirty (base RAM) and in the dirty arrays of the banked RAM blocks
+   below, so that a delta only needs to save the pages that differ. */
+int MEMORY_state_delta = FALSE;
+
+typedef struct {
+	UBYTE *base;	/* contents at the time of the base snapshot */
+	ULONG size;		/* size of the block at the time of the base snapshot */
+	UBYTE *dirty;	/* one flag per page, NULL when there is no base snapshot */
+} delta_block_t;
+
+static delta_block_t delta_blocks[BLOCK_COUNT];
+static UBYTE *base_mem = NULL;
+#ifndef PAGED_ATTRIB
+static UBYTE *base_attrib = NULL;
+#else
+static MEMORY_rdfunc base_readmap[256];
+static MEMORY_wrfunc base_writemap[256];
+#endif
+
+static void mark_block(int block, ULONG offset, ULONG size);
+static void mark_all_dirty(void);
+#define MARK_BLOCK(block, offset, size) mark_block(block, offset, size)
+#else
+#define MARK_BLOCK(block, offset, size)
+#endif /* LIBATARI800 */
+
+/* Banked RAM windows. MEMORY_mem holds the bank that is switched in, and
+   the bank's own buffer is only updated when it is switched out. Each window
+   owns a bit of MEMORY_dirty, cleared when a bank is switched in, so that
+   switching the bank out only copies back the pages written in between.
+   bank_in comes after MEMORY_SetRAM, which flags the pages dirty again. */
+
+/* Copies the bank at FROM to SIZE bytes at ADDR and marks them clean for BIT. */
+static void bank_in(UBYTE const *from, UWORD addr, int size, UBYTE bit)
+{
+	MEMORY_dCopyToMem(from, addr, size);
+#ifndef FALCON_CPUASM
+	/* (the assembler CPU core does not flag the pages it writes to) */
+	{
+		int page;
+		for (page = addr >> 8; page < (addr + size) >> 8; page++)
+			MEMORY_dirty[page] &= ~bit;
+	}
+#endif
+}
+
+/* Copies the pages of SIZE bytes at ADDR that are dirty for BIT back to
+   the bank at TO, which is at OFFSET in BLOCK. */
+static void bank_out(UBYTE *to, UWORD addr, int size, UBYTE bit, int block, ULONG offset)
+{
+	int i;
+	for (i = 0; i < size; i += 0x100) {
+		if (MEMORY_dirty[(addr + i) >> 8] & bit) {
+			memcpy(to + i, MEMORY_mem + addr + i, 0x100);
+			MARK_BLOCK(block, offset + i, 0x100);
+		}
+	}
+}
+
+/* Flags all pages dirty for the banked RAM windows, after their buffers
+   were reallocated or read from a state file. */
+static void mark_banks_dirty(void)
+{
+	int i;
+	for (i = 0; i < 256; i++)
+		MEMORY_dirty[i] |= MEMORY_DIRTY_ALL & ~MEMORY_DIRTY_DELTA;
+}
+
 static void alloc_axlon_memory(void){
 	if (MEMORY_axlon_num_banks > 0 && Atari800_machine_type == Atari800_MACHINE_800) {
 		int size = MEMORY_axlon_num_banks * 0x4000;
@@ -125,6 +212,7 @@ static void alloc_axlon_memory(void){
 			axlon_ram = (UBYTE *)Util_realloc(axlon_ram, size);
 		}
 		memset(axlon_ram, 0, size);
+		MARK_BLOCK(BLOCK_AXLON, 0, size);
 	} else {
 		if (axlon_ram != NULL) {
 			free(axlon_ram);
@@ -142,6 +230,7 @@ static void alloc_mosaic_memory(void){
 			mosaic_ram = (UBYTE *)Util_realloc(mosaic_ram, size);
 		}
 		memset(mosaic_ram, 0, size);
+		MARK_BLOCK(BLOCK_MOSAIC, 0, size);
 	} else {
 		if (mosaic_ram != NULL) {
 			free(mosaic_ram);
@@ -208,7 +297,10 @@ void MEMORY_InitialiseMachine(void)
 		if (GTIA_GRACTL & 4)
 			GTIA_TRIG_latch[3] = 0;
 	}
-	memcpy(MEMORY_mem + os_rom_start, MEMORY_os, os_size);
+	MEMORY_dCopyToMem(MEMORY_os, os_rom_start, os_size);
+#ifndef PAGED_MEM
+	InitHwMaps();
+#endif
 	switch (Atari800_machine_type) {
 	case Atari800_MACHINE_5200:
 		MEMORY_dFillMem(0x0000, 0x00, 0xf800);
@@ -334,11 +426,399 @@ void MEMORY_InitialiseMachine(void)
 	axlon_curbank = 0;
 	mosaic_curbank = 0x3f;
 	AllocMapRAM();
+	mark_banks_dirty();
+#ifdef LIBATARI800
+	mark_all_dirty();
+#endif
 	Atari800_Coldstart();
 }
 
+void MEMORY_MarkDirty(UWORD addr1, UWORD addr2)
+{
+	int page;
+	for (page = addr1 >> 8; page <= addr2 >> 8; page++) {
+		MEMORY_dirty[page] = MEMORY_DIRTY_ALL;
+#ifdef CPU_BLOCK_CACHE
+		if (CPU_code_page[page])
+			CPU_InvalidateCode(page, FALSE);
+#endif
+	}
+}
+
+#ifdef LIBATARI800
+
+static void mark_block(int block, ULONG offset, ULONG size)
+{
+	delta_block_t *b = &delta_blocks[block];
+	ULONG page;
+	if (b->dirty == NULL || size == 0 || offset >= b->size)
+		return;
+	if (offset + size > b->size)
+		size = b->size - offset;
+	for (page = offset >> 8; page <= (offset + size - 1) >> 8; page++)
+		b->dirty[page] = 1;
+}
+
+static void mark_all_dirty(void)
+{
+	int i;
+	memset(MEMORY_dirty, MEMORY_DIRTY_ALL, sizeof(MEMORY_dirty));
+	for (i = 0; i < BLOCK_COUNT; i++)
+		mark_block(i, 0, delta_blocks[i].size);
+}
+
+/* Returns the current contents and size of a banked RAM block. */
+static UBYTE *block_data(int block, ULONG *size)
+{
+	switch (block) {
+	case BLOCK_UNDER_OS:
+		*size = sizeof(under_atarixl_os);
+		return under_atarixl_os;
+	case BLOCK_UNDER_CARTA0BF:
+		*size = sizeof(under_cartA0BF);
+		return under_cartA0BF;
+	case BLOCK_XE:
+		*size = atarixe_memory == NULL ? 0 : atarixe_memory_size;
+		return atarixe_memory;
+	case BLOCK_ANTIC_UNDER_SELFTEST:
+		*size = sizeof(antic_bank_under_selftest);
+		return antic_bank_under_selftest;
+	case BLOCK_MAPRAM:
+		*size = mapram_memory == NULL ? 0 : 0x800;
+		return mapram_memory;
+	case BLOCK_AXLON:
+		*size = axlon_ram == NULL ? 0 : (axlon_current_bankmask + 1) * 0x4000;
+		return axlon_ram;
+	case BLOCK_MOSAIC:
+		*size = mosaic_ram == NULL ? 0 : mosaic_current_num_banks * 0x1000;
+		return mosaic_ram;
+	}
+	*size = 0;
+	return NULL;
+}
+
+void MEMORY_DeltaBase(void)
+{
+	int i;
+	if (base_mem == NULL)
+		base_mem = (UBYTE *) Util_malloc(65536);
+	memcpy(base_mem, MEMORY_mem, 65536);
+#ifndef PAGED_ATTRIB
+	if (base_attrib == NULL)
+		base_attrib = (UBYTE *) Util_malloc(65536);
+	memcpy(base_attrib, MEMORY_attrib, 65536);
+#else
+	memcpy(base_readmap, MEMORY_readmap, sizeof(base_readmap));
+	memcpy(base_writemap, MEMORY_writemap, sizeof(base_writemap));
+#endif
+	for (i = 0; i < 256; i++)
+		MEMORY_dirty[i] &= ~MEMORY_DIRTY_DELTA;
+	for (i = 0; i < BLOCK_COUNT; i++) {
+		delta_block_t *b = &delta_blocks[i];
+		UBYTE *data = block_data(i, &b->size);
+		if (b->size == 0)
+			continue;
+		b->base = (UBYTE *) Util_realloc(b->base, b->size);
+		b->dirty = (UBYTE *) Util_realloc(b->dirty, b->size >> 8);
+		memcpy(b->base, data, b->size);
+		memset(b->dirty, 0, b->size >> 8);
+	}
+}
+
+void MEMORY_DeltaFree(void)
+{
+	int i;
+	free(base_mem);
+	base_mem = NULL;
+#ifndef PAGED_ATTRIB
+	free(base_attrib);
+	base_attrib = NULL;
+#endif
+	for (i = 0; i < BLOCK_COUNT; i++) {
+		free(delta_blocks[i].base);
+		free(delta_blocks[i].dirty);
+		delta_blocks[i].base = NULL;
+		delta_blocks[i].dirty = NULL;
+		delta_blocks[i].size = 0;
+	}
+}
+#endif /* LIBATARI800 */
+
 #ifndef BASIC
 
+#ifdef PAGED_ATTRIB
+/* Saves the attributes of page I, reconstructed from the memory maps. */
+static void SaveAttribPage(int i)
+{
+	UBYTE attrib_page[256];
+	if (MEMORY_writemap[i] == NULL)
+		memset(attrib_page, MEMORY_RAM, 256);
+	else if (MEMORY_writemap[i] == MEMORY_ROM_PutByte)
+		memset(attrib_page, MEMORY_ROM, 256);
+	else if (i == 0x4f || i == 0x5f || i == 0x8f || i == 0x9f) {
+		/* special case: Bounty Bob bank switching registers */
+		memset(attrib_page, MEMORY_ROM, 256);
+		attrib_page[0xf6] = MEMORY_HARDWARE;
+		attrib_page[0xf7] = MEMORY_HARDWARE;
+		attrib_page[0xf8] = MEMORY_HARDWARE;
+		attrib_page[0xf9] = MEMORY_HARDWARE;
+	}
+	else {
+		memset(attrib_page, MEMORY_HARDWARE, 256);
+	}
+	StateSav_SaveUBYTE(&attrib_page[0], 256);
+}
+
+/* Reads the attributes of page I and sets up the memory maps accordingly. */
+static void ReadAttribPage(int i)
+{
+	UBYTE attrib_page[256];
+	StateSav_ReadUBYTE(&attrib_page[0], 256);
+	/* note: 0x40 is intentional here:
+	   we want ROM on page 0xd1 if H: patches are enabled */
+	switch (attrib_page[0x40]) {
+	case MEMORY_RAM:
+		MEMORY_readmap[i] = NULL;
+		MEMORY_writemap[i] = NULL;
+		break;
+	case MEMORY_ROM:
+		if (i != 0xd1 && attrib_page[0xf6] == MEMORY_HARDWARE) {
+			if (i == 0x4f || i == 0x8f) {
+				MEMORY_readmap[i] = CARTRIDGE_BountyBob1GetByte;
+				MEMORY_writemap[i] = CARTRIDGE_BountyBob1PutByte;
+			}
+			else if (i == 0x5f || i == 0x9f) {
+				MEMORY_readmap[i] = CARTRIDGE_BountyBob2GetByte;
+				MEMORY_writemap[i] = CARTRIDGE_BountyBob2PutByte;
+			}
+			else if (i == 0xbf) {
+				MEMORY_readmap[i] = CARTRIDGE_5200SuperCartGetByte;
+				MEMORY_writemap[i] = CARTRIDGE_5200SuperCartPutByte;
+			}
+			/* else something's wrong, so we keep current values */
+		}
+		else {
+			MEMORY_readmap[i] = NULL;
+			MEMORY_writemap[i] = MEMORY_ROM_PutByte;
+		}
+		break;
+	case MEMORY_HARDWARE:
+		switch (i) {
+		case 0xc0:
+		case 0xd0:
+			MEMORY_readmap[i] = GTIA_GetByte;
+			MEMORY_writemap[i] = GTIA_PutByte;
+			break;
+		case 0xd1:
+			MEMORY_readmap[i] = PBI_D1GetByte;
+			MEMORY_writemap[i] = PBI_D1PutByte;
+			break;
+		case 0xd2:
+		case 0xe8:
+		case 0xeb:
+			MEMORY_readmap[i] = POKEY_GetByte;
+			MEMORY_writemap[i] = POKEY_PutByte;
+			break;
+		case 0xd3:
+			MEMORY_readmap[i] = PIA_GetByte;
+			MEMORY_writemap[i] = PIA_PutByte;
+			break;
+		case 0xd4:
+			MEMORY_readmap[i] = ANTIC_GetByte;
+			MEMORY_writemap[i] = ANTIC_PutByte;
+			break;
+		case 0xd5:
+			MEMORY_readmap[i] = CARTRIDGE_GetByte;
+			MEMORY_writemap[i] = CARTRIDGE_PutByte;
+			break;
+		case 0xd6:
+			MEMORY_readmap[i] = PBI_D6GetByte;
+			MEMORY_writemap[i] = PBI_D6PutByte;
+			break;
+		case 0xd7:
+			MEMORY_readmap[i] = PBI_D7GetByte;
+			MEMORY_writemap[i] = PBI_D7PutByte;
+			break;
+		case 0xff:
+			if (MEMORY_mosaic_num_banks > 0) MEMORY_writemap[0xff] = MosaicPutByte;
+			break;
+		case 0xcf:
+			if (MEMORY_axlon_num_banks > 0) MEMORY_writemap[0xcf] = AxlonPutByte;
+			break;
+		case 0x0f:
+			if (MEMORY_axlon_num_banks > 0 && MEMORY_axlon_0f_mirror) MEMORY_writemap[0x0f] = AxlonPutByte;
+			break;
+		default:
+			/* something's wrong, so we keep current values */
+			break;
+		}
+		break;
+	default:
+		/* something's wrong, so we keep current values */
+		break;
+	}
+}
+#endif /* PAGED_ATTRIB */
+
+#ifdef LIBATARI800
+/* Flags the pages of base RAM whose memory maps differ from the base
+   snapshot, and the stack page, whose pushes are not tracked. */
+static void mark_untracked_pages(void)
+{
+#ifdef PAGED_ATTRIB
+	int i;
+	for (i = 0; i < 256; i++)
+		if (MEMORY_readmap[i] != base_readmap[i] || MEMORY_writemap[i] != base_writemap[i])
+			MEMORY_dirty[i] |= MEMORY_DIRTY_DELTA;
+#endif
+	MEMORY_dirty[0x01] |= MEMORY_DIRTY_DELTA;
+}
+
+static int page_changed(int page)
+{
+	int const offset = page << 8;
+	if (base_mem == NULL)
+		return TRUE;
+	if (!(MEMORY_dirty[page] & MEMORY_DIRTY_DELTA))
+		return FALSE;
+#ifndef PAGED_ATTRIB
+	if (memcmp(MEMORY_attrib + offset, base_attrib + offset, 256) != 0)
+		return TRUE;
+#else
+	if (MEMORY_readmap[page] != base_readmap[page] || MEMORY_writemap[page] != base_writemap[page])
+		return TRUE;
+#endif
+	return memcmp(MEMORY_mem + offset, base_mem + offset, 256) != 0;
+}
+
+/* Saves the pages of base RAM (contents and attributes) that differ from
+   the base snapshot. */
+static void SaveBaseRAMDelta(void)
+{
+	int count = 0;
+	int i;
+	mark_untracked_pages();
+	for (i = 0; i < 256; i++)
+		if (page_changed(i))
+			count++;
+	StateSav_SaveINT(&count, 1);
+	for (i = 0; i < 256; i++) {
+		if (!page_changed(i))
+			continue;
+		StateSav_SaveINT(&i, 1);
+		StateSav_SaveUBYTE(MEMORY_mem + (i << 8), 256);
+#ifndef PAGED_ATTRIB
+		StateSav_SaveUBYTE(MEMORY_attrib + (i << 8), 256);
+#else
+		SaveAttribPage(i);
+#endif
+	}
+}
+
+/* Reverts the pages of base RAM changed since the base snapshot and then
+   reads the pages saved by SaveBaseRAMDelta(). */
+static void ReadBaseRAMDelta(void)
+{
+	int count;
+	int i;
+	mark_untracked_pages();
+	if (base_mem != NULL) {
+		for (i = 0; i < 256; i++) {
+			if (!(MEMORY_dirty[i] & MEMORY_DIRTY_DELTA))
+				continue;
+			memcpy(MEMORY_mem + (i << 8), base_mem + (i << 8), 256);
+#ifndef PAGED_ATTRIB
+			memcpy(MEMORY_attrib + (i << 8), base_attrib + (i << 8), 256);
+#else
+			MEMORY_readmap[i] = base_readmap[i];
+			MEMORY_writemap[i] = base_writemap[i];
+#endif
+			MEMORY_dirty[i] = MEMORY_DIRTY_ALL & ~MEMORY_DIRTY_DELTA;
+		}
+	}
+	StateSav_ReadINT(&count, 1);
+	while (--count >= 0) {
+		StateSav_ReadINT(&i, 1);
+		i &= 0xff;
+		StateSav_ReadUBYTE(MEMORY_mem + (i << 8), 256);
+#ifndef PAGED_ATTRIB
+		StateSav_ReadUBYTE(MEMORY_attrib + (i << 8), 256);
+#else
+		ReadAttribPage(i);
+#endif
+		MEMORY_dirty[i] = MEMORY_DIRTY_ALL;
+	}
+}
+
+static int block_page_changed(delta_block_t const *b, UBYTE const *data, ULONG size, int page)
+{
+	if (b->dirty == NULL || b->size != size)
+		return TRUE;
+	return b->dirty[page] && memcmp(data + (page << 8), b->base + (page << 8), 256) != 0;
+}
+#endif /* LIBATARI800 */
+
+/* Saves a banked RAM block, or in a delta state only its pages that differ
+   from the base snapshot. */
+static void SaveBlock(int block, UBYTE *data, ULONG size)
+{
+#ifdef LIBATARI800
+	if (MEMORY_state_delta) {
+		delta_block_t const *b = &delta_blocks[block];
+		int const pages = size >> 8;
+		int count = 0;
+		int i;
+		for (i = 0; i < pages; i++)
+			if (block_page_changed(b, data, size, i))
+				count++;
+		StateSav_SaveINT(&count, 1);
+		for (i = 0; i < pages; i++) {
+			if (!block_page_changed(b, data, size, i))
+				continue;
+			StateSav_SaveINT(&i, 1);
+			StateSav_SaveUBYTE(data + (i << 8), 256);
+		}
+		return;
+	}
+#endif
+	StateSav_SaveUBYTE(data, size);
+}
+
+static void ReadBlock(int block, UBYTE *data, ULONG size)
+{
+#ifdef LIBATARI800
+	if (MEMORY_state_delta) {
+		delta_block_t *b = &delta_blocks[block];
+		int const pages = size >> 8;
+		int const tracked = b->dirty != NULL && b->size == size;
+		int count;
+		int i;
+		if (tracked) {
+			for (i = 0; i < pages; i++) {
+				if (b->dirty[i]) {
+					memcpy(data + (i << 8), b->base + (i << 8), 256);
+					b->dirty[i] = 0;
+				}
+			}
+		}
+		StateSav_ReadINT(&count, 1);
+		while (--count >= 0) {
+			StateSav_ReadINT(&i, 1);
+			if (i < 0 || i >= pages) {
+				UBYTE skip[256];
+				StateSav_ReadUBYTE(skip, 256);
+				continue;
+			}
+			StateSav_ReadUBYTE(data + (i << 8), 256);
+			if (tracked)
+				b->dirty[i] = 1;
+		}
+		return;
+	}
+#endif
+	StateSav_ReadUBYTE(data, size);
+}
+
 void MEMORY_StateSave(UBYTE SaveVerbose)
 {
 	int temp;
@@ -350,59 +830,49 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 		if (MEMORY_axlon_num_banks > 0){
 			StateSav_SaveINT(&axlon_curbank, 1);
 			StateSav_SaveINT(&MEMORY_axlon_0f_mirror, 1);
-			StateSav_SaveUBYTE(axlon_ram, MEMORY_axlon_num_banks * 0x4000);
+			SaveBlock(BLOCK_AXLON, axlon_ram, MEMORY_axlon_num_banks * 0x4000);
 		}
 		StateSav_SaveINT(&mosaic_current_num_banks, 1);
 		if (mosaic_current_num_banks > 0) {
 			StateSav_SaveINT(&mosaic_curbank, 1);
-			StateSav_SaveUBYTE(mosaic_ram, mosaic_current_num_banks * 0x1000);
+			SaveBlock(BLOCK_MOSAIC, mosaic_ram, mosaic_current_num_banks * 0x1000);
 		}
 	}
 
 	/* Save amount of base RAM in kilobytes. */
 	temp = MEMORY_ram_size > 64 ? 64 : MEMORY_ram_size;
 	StateSav_SaveINT(&temp, 1);
-	STATESAV_TAG(base_ram);
-	StateSav_SaveUBYTE(&MEMORY_mem[0], 65536);
-	STATESAV_TAG(base_ram_attrib);
+#ifdef LIBATARI800
+	if (MEMORY_state_delta)
+		SaveBaseRAMDelta();
+	else
+#endif
+	{
+		STATESAV_TAG(base_ram);
+		StateSav_SaveUBYTE(&MEMORY_mem[0], 65536);
+		STATESAV_TAG(base_ram_attrib);
 #ifndef PAGED_ATTRIB
-	StateSav_SaveUBYTE(&MEMORY_attrib[0], 65536);
+		StateSav_SaveUBYTE(&MEMORY_attrib[0], 65536);
 #else
-	{
-		/* I assume here that consecutive calls to StateSav_SaveUBYTE()
-		   are equivalent to a single call with all the values
-		   (i.e. StateSav_SaveUBYTE() doesn't write any headers). */
-		UBYTE attrib_page[256];
-		int i;
-		for (i = 0; i < 256; i++) {
-			if (MEMORY_writemap[i] == NULL)
-				memset(attrib_page, MEMORY_RAM, 256);
-			else if (MEMORY_writemap[i] == MEMORY_ROM_PutByte)
-				memset(attrib_page, MEMORY_ROM, 256);
-			else if (i == 0x4f || i == 0x5f || i == 0x8f || i == 0x9f) {
-				/* special case: Bounty Bob bank switching registers */
-				memset(attrib_page, MEMORY_ROM, 256);
-				attrib_page[0xf6] = MEMORY_HARDWARE;
-				attrib_page[0xf7] = MEMORY_HARDWARE;
-				attrib_page[0xf8] = MEMORY_HARDWARE;
-				attrib_page[0xf9] = MEMORY_HARDWARE;
-			}
-			else {
-				memset(attrib_page, MEMORY_HARDWARE, 256);
-			}
-			StateSav_SaveUBYTE(&attrib_page[0], 256);
+		{
+			/* I assume here that consecutive calls to StateSav_SaveUBYTE()
+			   are equivalent to a single call with all the values
+			   (i.e. StateSav_SaveUBYTE() doesn't write any headers). */
+			int i;
+			for (i = 0; i < 256; i++)
+				SaveAttribPage(i);
 		}
-	}
 #endif
+	}
 
 	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 		if (SaveVerbose != 0)
 			StateSav_SaveUBYTE(&MEMORY_basic[0], 8192);
-		StateSav_SaveUBYTE(&under_cartA0BF[0], 8192);
+		SaveBlock(BLOCK_UNDER_CARTA0BF, under_cartA0BF, 8192);
 
 		if (SaveVerbose != 0)
 			StateSav_SaveUBYTE(&MEMORY_os[0], 16384);
-		StateSav_SaveUBYTE(&under_atarixl_os[0], 16384);
+		SaveBlock(BLOCK_UNDER_OS, under_atarixl_os, 16384);
 		if (SaveVerbose != 0)
 			StateSav_SaveUBYTE(MEMORY_xegame, 0x2000);
 	}
@@ -423,16 +893,16 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 	StateSav_SaveINT(&MEMORY_cartA0BF_enabled, 1);
 
 	if (MEMORY_ram_size > 64) {
-		StateSav_SaveUBYTE(&atarixe_memory[0], atarixe_memory_size);
+		SaveBlock(BLOCK_XE, atarixe_memory, atarixe_memory_size);
 		if (ANTIC_xe_ptr != NULL && MEMORY_selftest_enabled)
-			StateSav_SaveUBYTE(antic_bank_under_selftest, 0x800);
+			SaveBlock(BLOCK_ANTIC_UNDER_SELFTEST, antic_bank_under_selftest, 0x800);
 	}
 
 	/* Simius XL/XE MapRAM expansion */
 	if (Atari800_machine_type == Atari800_MACHINE_XLXE && MEMORY_ram_size > 20) {
 		StateSav_SaveINT(&MEMORY_enable_mapram, 1);
 		if (MEMORY_enable_mapram) {
-			StateSav_SaveUBYTE( mapram_memory, 0x800 );
+			SaveBlock(BLOCK_MAPRAM, mapram_memory, 0x800);
 		}
 	}
 }
@@ -460,7 +930,7 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 				StateSav_ReadINT(&temp, 1);
 			}
 			alloc_axlon_memory();
-			StateSav_ReadUBYTE(axlon_ram, MEMORY_axlon_num_banks * 0x4000);
+			ReadBlock(BLOCK_AXLON, axlon_ram, MEMORY_axlon_num_banks * 0x4000);
 		}
 		StateSav_ReadINT(&MEMORY_mosaic_num_banks, 1);
 		if (MEMORY_mosaic_num_banks > 0) {
@@ -473,117 +943,39 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 				StateSav_ReadINT(&temp, 1); /* Ignore Mosaic RAM size - can be derived. */
 			}
 			alloc_mosaic_memory();
-			StateSav_ReadUBYTE(mosaic_ram, mosaic_current_num_banks * 0x1000);
+			ReadBlock(BLOCK_MOSAIC, mosaic_ram, mosaic_current_num_banks * 0x1000);
 		}
 	}
 
 	if (StateVersion >= 7)
 		/* Read amount of base RAM in kilobytes. */
 		StateSav_ReadINT(&base_ram_kb, 1);
-	StateSav_ReadUBYTE(&MEMORY_mem[0], 65536);
+#ifdef LIBATARI800
+	if (MEMORY_state_delta)
+		ReadBaseRAMDelta();
+	else
+#endif
+	{
+		StateSav_ReadUBYTE(&MEMORY_mem[0], 65536);
 #ifndef PAGED_ATTRIB
-	StateSav_ReadUBYTE(&MEMORY_attrib[0], 65536);
+		StateSav_ReadUBYTE(&MEMORY_attrib[0], 65536);
 #else
-	{
-		UBYTE attrib_page[256];
-		int i;
-		for (i = 0; i < 256; i++) {
-			StateSav_ReadUBYTE(&attrib_page[0], 256);
-			/* note: 0x40 is intentional here:
-			   we want ROM on page 0xd1 if H: patches are enabled */
-			switch (attrib_page[0x40]) {
-			case MEMORY_RAM:
-				MEMORY_readmap[i] = NULL;
-				MEMORY_writemap[i] = NULL;
-				break;
-			case MEMORY_ROM:
-				if (i != 0xd1 && attrib_page[0xf6] == MEMORY_HARDWARE) {
-					if (i == 0x4f || i == 0x8f) {
-						MEMORY_readmap[i] = CARTRIDGE_BountyBob1GetByte;
-						MEMORY_writemap[i] = CARTRIDGE_BountyBob1PutByte;
-					}
-					else if (i == 0x5f || i == 0x9f) {
-						MEMORY_readmap[i] = CARTRIDGE_BountyBob2GetByte;
-						MEMORY_writemap[i] = CARTRIDGE_BountyBob2PutByte;
-					}
-					else if (i == 0xbf) {
-						MEMORY_readmap[i] = CARTRIDGE_5200SuperCartGetByte;
-						MEMORY_writemap[i] = CARTRIDGE_5200SuperCartPutByte;
-					}
-					/* else something's wrong, so we keep current values */
-				}
-				else {
-					MEMORY_readmap[i] = NULL;
-					MEMORY_writemap[i] = MEMORY_ROM_PutByte;
-				}
-				break;
-			case MEMORY_HARDWARE:
-				switch (i) {
-				case 0xc0:
-				case 0xd0:
-					MEMORY_readmap[i] = GTIA_GetByte;
-					MEMORY_writemap[i] = GTIA_PutByte;
-					break;
-				case 0xd1:
-					MEMORY_readmap[i] = PBI_D1GetByte;
-					MEMORY_writemap[i] = PBI_D1PutByte;
-					break;
-				case 0xd2:
-				case 0xe8:
-				case 0xeb:
-					MEMORY_readmap[i] = POKEY_GetByte;
-					MEMORY_writemap[i] = POKEY_PutByte;
-					break;
-				case 0xd3:
-					MEMORY_readmap[i] = PIA_GetByte;
-					MEMORY_writemap[i] = PIA_PutByte;
-					break;
-				case 0xd4:
-					MEMORY_readmap[i] = ANTIC_GetByte;
-					MEMORY_writemap[i] = ANTIC_PutByte;
-					break;
-				case 0xd5:
-					MEMORY_readmap[i] = CARTRIDGE_GetByte;
-					MEMORY_writemap[i] = CARTRIDGE_PutByte;
-					break;
-				case 0xd6:
-					MEMORY_readmap[i] = PBI_D6GetByte;
-					MEMORY_writemap[i] = PBI_D6PutByte;
-					break;
-				case 0xd7:
-					MEMORY_readmap[i] = PBI_D7GetByte;
-					MEMORY_writemap[i] = PBI_D7PutByte;
-					break;
-				case 0xff:
-					if (MEMORY_mosaic_num_banks > 0) MEMORY_writemap[0xff] = MosaicPutByte;
-					break;
-				case 0xcf:
-					if (MEMORY_axlon_num_banks > 0) MEMORY_writemap[0xcf] = AxlonPutByte;
-					break;
-				case 0x0f:
-					if (MEMORY_axlon_num_banks > 0 && MEMORY_axlon_0f_mirror) MEMORY_writemap[0x0f] = AxlonPutByte;
-					break;
-				default:
-					/* something's wrong, so we keep current values */
-					break;
-				}
-				break;
-			default:
-				/* something's wrong, so we keep current values */
-				break;
-			}
+		{
+			int i;
+			for (i = 0; i < 256; i++)
+				ReadAttribPage(i);
 		}
-	}
 #endif
+	}
 
 	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 		if (SaveVerbose)
 			StateSav_ReadUBYTE(&MEMORY_basic[0], 8192);
-		StateSav_ReadUBYTE(&under_cartA0BF[0], 8192);
+		ReadBlock(BLOCK_UNDER_CARTA0BF, under_cartA0BF, 8192);
 
 		if (SaveVerbose)
 			StateSav_ReadUBYTE(&MEMORY_os[0], 16384);
-		StateSav_ReadUBYTE(&under_atarixl_os[0], 16384);
+		ReadBlock(BLOCK_UNDER_OS, under_atarixl_os, 16384);
 		if (StateVersion >= 7 && SaveVerbose)
 			StateSav_ReadUBYTE(MEMORY_xegame, 0x2000);
 	}
@@ -645,7 +1037,7 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 	ANTIC_xe_ptr = NULL;
 	AllocXEMemory();
 	if (MEMORY_ram_size > 64) {
-		StateSav_ReadUBYTE(&atarixe_memory[0], atarixe_memory_size);
+		ReadBlock(BLOCK_XE, atarixe_memory, atarixe_memory_size);
 		/* a hack that makes state files compatible with previous versions:
 		   for 130 XE there's written 192 KB of unused data */
 		if (MEMORY_ram_size == 128 && StateVersion <= 6) {
@@ -669,7 +1061,7 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 
 			if (ANTIC_xe_ptr != NULL && MEMORY_selftest_enabled)
 				/* Also read ANTIC-visible memory shadowed by Self Test. */
-				StateSav_ReadUBYTE(antic_bank_under_selftest, 0x800);
+				ReadBlock(BLOCK_ANTIC_UNDER_SELFTEST, antic_bank_under_selftest, 0x800);
 
 		}
 	}
@@ -679,9 +1071,19 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 		StateSav_ReadINT(&MEMORY_enable_mapram, 1);
 		AllocMapRAM();
 		if (mapram_memory != NULL) {
-			StateSav_ReadUBYTE(mapram_memory, 0x800);
+			ReadBlock(BLOCK_MAPRAM, mapram_memory, 0x800);
 		}
 	}
+
+	mark_banks_dirty();
+#ifdef LIBATARI800
+	if (!MEMORY_state_delta)
+		mark_all_dirty();
+#endif
+#ifndef PAGED_MEM
+	/* the state may be of another machine type */
+	InitHwMaps();
+#endif
 }
 
 #endif /* BASIC */
@@ -744,7 +1146,8 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 	if (mapram_selected && !new_mapram_selected) {
 		/* Restore RAM hidden by MapRAM. */
 		memcpy(mapram_memory, MEMORY_mem + 0x5000, 0x800);
-		memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+		MARK_BLOCK(BLOCK_MAPRAM, 0, 0x800);
+		MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
 	}
 
 	/* Switch XE memory bank in 0x4000-0x7fff */
@@ -785,16 +1188,18 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		        || antic_bank != new_antic_bank
 		        || (MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP && (byte & 0x20) == 0))) {
 			/* Disable Self Test ROM */
-			memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-			if (ANTIC_xe_ptr != NULL)
+			MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
+			if (ANTIC_xe_ptr != NULL) {
 				/* Also disable Self Test from XE bank accessed by ANTIC. */
 				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+				MARK_BLOCK(BLOCK_XE, (antic_bank << 14) + 0x1000, 0x800);
+			}
 			MEMORY_SetRAM(0x5000, 0x57ff);
 			MEMORY_selftest_enabled = FALSE;
 		}
 		if (cpu_bank != new_cpu_bank) {
-			memcpy(atarixe_memory + (cpu_bank << 14), MEMORY_mem + 0x4000, 0x4000);
-			memcpy(MEMORY_mem + 0x4000, atarixe_memory + (new_cpu_bank << 14), 0x4000);
+			bank_out(atarixe_memory + (cpu_bank << 14), 0x4000, 0x4000, MEMORY_DIRTY_XE, BLOCK_XE, cpu_bank << 14);
+			bank_in(atarixe_memory + (new_cpu_bank << 14), 0x4000, 0x4000, MEMORY_DIRTY_XE);
 		}
 
 		if (MEMORY_ram_size == 128 || MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)
@@ -809,22 +1214,22 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		if (byte & 0x01) {
 			/* Enable OS ROM */
 			if (MEMORY_ram_size > 48) {
-				memcpy(under_atarixl_os, MEMORY_mem + 0xc000, 0x1000);
-				memcpy(under_atarixl_os + 0x1800, MEMORY_mem + 0xd800, 0x2800);
+				bank_out(under_atarixl_os, 0xc000, 0x1000, MEMORY_DIRTY_UNDER_OS, BLOCK_UNDER_OS, 0);
+				bank_out(under_atarixl_os + 0x1800, 0xd800, 0x2800, MEMORY_DIRTY_UNDER_OS, BLOCK_UNDER_OS, 0x1800);
 				MEMORY_SetROM(0xc000, 0xcfff);
 				MEMORY_SetROM(0xd800, 0xffff);
 			}
-			memcpy(MEMORY_mem + 0xc000, MEMORY_os, 0x1000);
-			memcpy(MEMORY_mem + 0xd800, MEMORY_os + 0x1800, 0x2800);
+			MEMORY_dCopyToMem(MEMORY_os, 0xc000, 0x1000);
+			MEMORY_dCopyToMem(MEMORY_os + 0x1800, 0xd800, 0x2800);
 			ESC_PatchOS();
 		}
 		else {
 			/* Disable OS ROM */
 			if (MEMORY_ram_size > 48) {
-				memcpy(MEMORY_mem + 0xc000, under_atarixl_os, 0x1000);
-				memcpy(MEMORY_mem + 0xd800, under_atarixl_os + 0x1800, 0x2800);
 				MEMORY_SetRAM(0xc000, 0xcfff);
 				MEMORY_SetRAM(0xd800, 0xffff);
+				bank_in(under_atarixl_os, 0xc000, 0x1000, MEMORY_DIRTY_UNDER_OS);
+				bank_in(under_atarixl_os + 0x1800, 0xd800, 0x2800, MEMORY_DIRTY_UNDER_OS);
 			} else {
 				MEMORY_dFillMem(0xc000, 0xff, 0x1000);
 				MEMORY_dFillMem(0xd800, 0xff, 0x2800);
@@ -832,10 +1237,12 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			/* When OS ROM is disabled we also have to disable Self Test - Jindroush */
 			if (MEMORY_selftest_enabled) {
 				if (MEMORY_ram_size > 20) {
-					memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-					if (ANTIC_xe_ptr != NULL)
+					MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
+					if (ANTIC_xe_ptr != NULL) {
 						/* Also disable Self Test from XE bank accessed by ANTIC. */
 						memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+						MARK_BLOCK(BLOCK_XE, (antic_bank << 14) + 0x1000, 0x800);
+					}
 					MEMORY_SetRAM(0x5000, 0x57ff);
 				}
 				else
@@ -851,19 +1258,19 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		UBYTE const *builtin_cart_old = builtin_cart(oldval);
 		if (builtin_cart_old != builtin_cart_new) {
 			if (builtin_cart_old == NULL && MEMORY_ram_size > 40) { /* switching RAM out */
-				memcpy(under_cartA0BF, MEMORY_mem + 0xa000, 0x2000);
+				bank_out(under_cartA0BF, 0xa000, 0x2000, MEMORY_DIRTY_UNDER_BASIC, BLOCK_UNDER_CARTA0BF, 0);
 				MEMORY_SetROM(0xa000, 0xbfff);
 			}
 			if (builtin_cart_new == NULL) { /* switching RAM in */
 				if (MEMORY_ram_size > 40) {
-					memcpy(MEMORY_mem + 0xa000, under_cartA0BF, 0x2000);
 					MEMORY_SetRAM(0xa000, 0xbfff);
+					bank_in(under_cartA0BF, 0xa000, 0x2000, MEMORY_DIRTY_UNDER_BASIC);
 				}
 				else
 					MEMORY_dFillMem(0xa000, 0xff, 0x2000);
 			}
 			else
-				memcpy(MEMORY_mem + 0xa000, builtin_cart_new, 0x2000);
+				MEMORY_dCopyToMem(builtin_cart_new, 0xa000, 0x2000);
 		}
 	}
 
@@ -872,10 +1279,12 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		if (MEMORY_selftest_enabled) {
 			/* Disable Self Test ROM */
 			if (MEMORY_ram_size > 20) {
-				memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-				if (ANTIC_xe_ptr != NULL)
+				MEMORY_dCopyToMem(under_atarixl_os + 0x1000, 0x5000, 0x800);
+				if (ANTIC_xe_ptr != NULL) {
 					/* Also disable Self Test from XE bank accessed by ANTIC. */
 					memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+					MARK_BLOCK(BLOCK_XE, (antic_bank << 14) + 0x1000, 0x800);
+				}
 				MEMORY_SetRAM(0x5000, 0x57ff);
 			}
 			else
@@ -893,21 +1302,27 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			/* Enable Self Test ROM */
 			if (MEMORY_ram_size > 20) {
 				memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
-				if (ANTIC_xe_ptr != NULL)
+				MARK_BLOCK(BLOCK_UNDER_OS, 0x1000, 0x800);
+				if (ANTIC_xe_ptr != NULL) {
 					/* Also backup RAM under Self Test from XE bank accessed by ANTIC. */
 					memcpy(antic_bank_under_selftest, atarixe_memory + (antic_bank << 14) + 0x1000, 0x800);
+					MARK_BLOCK(BLOCK_ANTIC_UNDER_SELFTEST, 0, 0x800);
+				}
 				MEMORY_SetROM(0x5000, 0x57ff);
 			}
-			memcpy(MEMORY_mem + 0x5000, MEMORY_os + 0x1000, 0x800);
-			if (ANTIC_xe_ptr != NULL)
+			MEMORY_dCopyToMem(MEMORY_os + 0x1000, 0x5000, 0x800);
+			if (ANTIC_xe_ptr != NULL) {
 				/* Also enable Self Test in the XE bank accessed by ANTIC. */
 				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, MEMORY_os + 0x1000, 0x800);
+				MARK_BLOCK(BLOCK_XE, (antic_bank << 14) + 0x1000, 0x800);
+			}
 			MEMORY_selftest_enabled = TRUE;
 		}
 		else if (!mapram_selected && new_mapram_selected) {
 			/* Enable MapRAM */
 			memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
-			memcpy(MEMORY_mem + 0x5000, mapram_memory, 0x800);
+			MARK_BLOCK(BLOCK_UNDER_OS, 0x1000, 0x800);
+			MEMORY_dCopyToMem(mapram_memory, 0x5000, 0x800);
 		}
 	}
 }
@@ -931,20 +1346,20 @@ static void MosaicPutByte(UWORD addr, UBYTE byte)
 	if (newbank == mosaic_curbank || (newbank >= mosaic_current_num_banks && mosaic_curbank >= mosaic_current_num_banks)) return; /*same bank or rom -> rom*/
 	if (newbank >= mosaic_current_num_banks && mosaic_curbank < mosaic_current_num_banks) {
 		/*ram ->rom*/
-		memcpy(mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000,0x1000);
+		bank_out(mosaic_ram + mosaic_curbank*0x1000, 0xc000, 0x1000, MEMORY_DIRTY_MOSAIC, BLOCK_MOSAIC, mosaic_curbank*0x1000);
 		MEMORY_dFillMem(0xc000, 0xff, 0x1000);
 		MEMORY_SetROM(0xc000, 0xcfff);
 	}
 	else if (newbank < mosaic_current_num_banks && mosaic_curbank >= mosaic_current_num_banks) {
 		/*rom->ram*/
-		memcpy(MEMORY_mem + 0xc000, mosaic_ram+newbank*0x1000,0x1000);
 		MEMORY_SetRAM(0xc000, 0xcfff);
+		bank_in(mosaic_ram+newbank*0x1000, 0xc000, 0x1000, MEMORY_DIRTY_MOSAIC);
 	}
 	else {
 		/*ram -> ram*/
-		memcpy(mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000, 0x1000);
-		memcpy(MEMORY_mem + 0xc000, mosaic_ram + newbank*0x1000, 0x1000);
+		bank_out(mosaic_ram + mosaic_curbank*0x1000, 0xc000, 0x1000, MEMORY_DIRTY_MOSAIC, BLOCK_MOSAIC, mosaic_curbank*0x1000);
 		MEMORY_SetRAM(0xc000, 0xcfff);
+		bank_in(mosaic_ram + newbank*0x1000, 0xc000, 0x1000, MEMORY_DIRTY_MOSAIC);
 	}
 	mosaic_curbank = newbank;
 }
@@ -972,15 +1387,15 @@ static void AxlonPutByte(UWORD addr, UBYTE byte)
 {
 	int newbank;
 	/*Write-through to RAM if it is the page 0x0f shadow*/
-	if ((addr&0xff00) == 0x0f00) MEMORY_mem[addr] = byte;
+	if ((addr&0xff00) == 0x0f00) MEMORY_dPutByte(addr, byte);
 	if ((addr&0xff) < 0xc0) return; /*0xffc0-0xffff and 0x0fc0-0x0fff only*/
 #ifdef DEBUG
 	Log_print("AxlonPutByte:%4X:%2X", addr, byte);
 #endif
 	newbank = (byte&axlon_current_bankmask);
 	if (newbank == axlon_curbank) return;
-	memcpy(axlon_ram + axlon_curbank*0x4000, MEMORY_mem + 0x4000, 0x4000);
-	memcpy(MEMORY_mem + 0x4000, axlon_ram + newbank*0x4000, 0x4000);
+	bank_out(axlon_ram + axlon_curbank*0x4000, 0x4000, 0x4000, MEMORY_DIRTY_AXLON, BLOCK_AXLON, axlon_curbank*0x4000);
+	bank_in(axlon_ram + newbank*0x4000, 0x4000, 0x4000, MEMORY_DIRTY_AXLON);
 	axlon_curbank = newbank;
 }
 
@@ -996,7 +1411,7 @@ void MEMORY_Cart809fDisable(void)
 {
 	if (cart809F_enabled) {
 		if (MEMORY_ram_size > 32) {
-			memcpy(MEMORY_mem + 0x8000, under_cart809F, 0x2000);
+			MEMORY_dCopyToMem(under_cart809F, 0x8000, 0x2000);
 			MEMORY_SetRAM(0x8000, 0x9fff);
 		}
 		else
@@ -1024,14 +1439,14 @@ void MEMORY_CartA0bfDisable(void)
 		UBYTE const *builtin = builtin_cart(PIA_PORTB | PIA_PORTB_mask);
 		if (builtin == NULL) { /* switch RAM in */
 			if (MEMORY_ram_size > 40) {
-				memcpy(MEMORY_mem + 0xa000, under_cartA0BF, 0x2000);
+				MEMORY_dCopyToMem(under_cartA0BF, 0xa000, 0x2000);
 				MEMORY_SetRAM(0xa000, 0xbfff);
 			}
 			else
 				MEMORY_dFillMem(0xa000, 0xff, 0x2000);
 		}
 		else
-			memcpy(MEMORY_mem + 0xa000, builtin, 0x2000);
+			MEMORY_dCopyToMem(builtin, 0xa000, 0x2000);
 		MEMORY_cartA0BF_enabled = FALSE;
 		if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 			GTIA_TRIG[3] = 0;
@@ -1049,6 +1464,7 @@ void MEMORY_CartA0bfEnable(void)
 		if (MEMORY_ram_size > 40 && builtin_cart(PIA_PORTB | PIA_PORTB_mask) == NULL) {
 			/* Back-up 0xa000-0xbfff RAM */
 			memcpy(under_cartA0BF, MEMORY_mem + 0xa000, 0x2000);
+			MARK_BLOCK(BLOCK_UNDER_CARTA0BF, 0, 0x2000);
 			MEMORY_SetROM(0xa000, 0xbfff);
 		}
 		MEMORY_cartA0BF_enabled = TRUE;
@@ -1066,162 +1482,52 @@ void MEMORY_GetCharset(UBYTE *cs)
 }
 
 #ifndef PAGED_MEM
-UBYTE MEMORY_HwGetByte(UWORD addr, int no_side_effects)
+MEMORY_rdfunc MEMORY_hw_readmap[256];
+MEMORY_wrfunc MEMORY_hw_writemap[256];
+
+static UBYTE NoHwGetByte(UWORD addr, int no_side_effects)
 {
-	UBYTE byte = 0xff;
-	switch (addr & 0xff00) {
-	case 0x4f00:
-	case 0x8f00:
-		byte = CARTRIDGE_BountyBob1GetByte(addr, no_side_effects);
-		break;
-	case 0x5f00:
-	case 0x9f00:
-		byte = CARTRIDGE_BountyBob2GetByte(addr, no_side_effects);
-		break;
-	case 0xbf00:
-		byte = CARTRIDGE_5200SuperCartGetByte(addr, no_side_effects);
-		break;
-	case 0xd000:				/* GTIA */
-	case 0xc000:				/* GTIA - 5200 */
-	case 0xc100:				/* GTIA - 5200 */
-	case 0xc200:				/* GTIA - 5200 */
-	case 0xc300:				/* GTIA - 5200 */
-	case 0xc400:				/* GTIA - 5200 */
-	case 0xc500:				/* GTIA - 5200 */
-	case 0xc600:				/* GTIA - 5200 */
-	case 0xc700:				/* GTIA - 5200 */
-	case 0xc800:				/* GTIA - 5200 */
-	case 0xc900:				/* GTIA - 5200 */
-	case 0xca00:				/* GTIA - 5200 */
-	case 0xcb00:				/* GTIA - 5200 */
-	case 0xcc00:				/* GTIA - 5200 */
-	case 0xcd00:				/* GTIA - 5200 */
-	case 0xce00:				/* GTIA - 5200 */
-		byte = GTIA_GetByte(addr, no_side_effects);
-		break;
-	case 0xd200:				/* POKEY */
-	case 0xe800:				/* POKEY - 5200 */
-	case 0xe900:				/* POKEY - 5200 */
-	case 0xea00:				/* POKEY - 5200 */
-	case 0xeb00:				/* POKEY - 5200 */
-	case 0xec00:				/* POKEY - 5200 */
-	case 0xed00:				/* POKEY - 5200 */
-	case 0xee00:				/* POKEY - 5200 */
-	case 0xef00:				/* POKEY - 5200 */
-		byte = POKEY_GetByte(addr, no_side_effects);
-		break;
-	case 0xd300:				/* PIA */
-		byte = PIA_GetByte(addr, no_side_effects);
-		break;
-	case 0xd400:				/* ANTIC */
-		byte = ANTIC_GetByte(addr, no_side_effects);
-		break;
-	case 0xd500:				/* bank-switching cartridges, RTIME-8 */
-		byte = CARTRIDGE_GetByte(addr, no_side_effects);
-		break;
-	case 0xff00:				/* Mosaic memory expansion for 400/800 */
-		byte = MosaicGetByte(addr, no_side_effects);
-		break;
-	case 0xcf00:				/* Axlon memory expansion for 800 */
-	case 0x0f00:				/* Axlon shadow */
-		if (Atari800_machine_type == Atari800_MACHINE_5200) {
-			byte = GTIA_GetByte(addr, no_side_effects); /* GTIA-5200 cfxx */
-		}
-		else {
-			byte = AxlonGetByte(addr, no_side_effects);
-		}
-		break;
-	case 0xd100:				/* PBI page D1 */
-		byte = PBI_D1GetByte(addr, no_side_effects);
-		break;
-	case 0xd600:				/* PBI page D6 */
-		byte = PBI_D6GetByte(addr, no_side_effects);
-		break;
-	case 0xd700:				/* PBI page D7 */
-		byte = PBI_D7GetByte(addr, no_side_effects);
-		break;
-	default:
-		break;
-	}
+	return 0xff;
+}
 
-	return byte;
+static void NoHwPutByte(UWORD addr, UBYTE byte)
+{
 }
 
-void MEMORY_HwPutByte(UWORD addr, UBYTE byte)
+static void SetHwPages(int page1, int page2, MEMORY_rdfunc rd, MEMORY_wrfunc wr)
 {
-	switch (addr & 0xff00) {
-	case 0x4f00:
-	case 0x8f00:
-		CARTRIDGE_BountyBob1PutByte(addr, byte);
-		break;
-	case 0x5f00:
-	case 0x9f00:
-		CARTRIDGE_BountyBob2PutByte(addr, byte);
-		break;
-	case 0xbf00:
-		CARTRIDGE_5200SuperCartPutByte(addr, byte);
-		break;
-	case 0xd000:				/* GTIA */
-	case 0xc000:				/* GTIA - 5200 */
-	case 0xc100:				/* GTIA - 5200 */
-	case 0xc200:				/* GTIA - 5200 */
-	case 0xc300:				/* GTIA - 5200 */
-	case 0xc400:				/* GTIA - 5200 */
-	case 0xc500:				/* GTIA - 5200 */
-	case 0xc600:				/* GTIA - 5200 */
-	case 0xc700:				/* GTIA - 5200 */
-	case 0xc800:				/* GTIA - 5200 */
-	case 0xc900:				/* GTIA - 5200 */
-	case 0xca00:				/* GTIA - 5200 */
-	case 0xcb00:				/* GTIA - 5200 */
-	case 0xcc00:				/* GTIA - 5200 */
-	case 0xcd00:				/* GTIA - 5200 */
-	case 0xce00:				/* GTIA - 5200 */
-		GTIA_PutByte(addr, byte);
-		break;
-	case 0xd200:				/* POKEY */
-	case 0xe800:				/* POKEY - 5200 */
-	case 0xe900:				/* POKEY - 5200 */
-	case 0xea00:				/* POKEY - 5200 */
-	case 0xeb00:				/* POKEY - 5200 */
-	case 0xec00:				/* POKEY - 5200 */
-	case 0xed00:				/* POKEY - 5200 */
-	case 0xee00:				/* POKEY - 5200 */
-	case 0xef00:				/* POKEY - 5200 */
-		POKEY_PutByte(addr, byte);
-		break;
-	case 0xd300:				/* PIA */
-		PIA_PutByte(addr, byte);
-		break;
-	case 0xd400:				/* ANTIC */
-		ANTIC_PutByte(addr, byte);
-		break;
-	case 0xd500:				/* bank-switching cartridges, RTIME-8 */
-		CARTRIDGE_PutByte(addr, byte);
-		break;
-	case 0xff00:				/* Mosaic memory expansion for 400/800 */
-		MosaicPutByte(addr,byte);
-		break;
-	case 0xcf00:				/* Axlon memory expansion for 800 */
-	case 0x0f00:				/* Axlon shadow */
-		if (Atari800_machine_type == Atari800_MACHINE_5200) {
-			GTIA_PutByte(addr, byte); /* GTIA-5200 cfxx */
-		}
-		else {
-			AxlonPutByte(addr,byte);
-		}
-		break;
-	case 0xd100:				/* PBI page D1 */
-		PBI_D1PutByte(addr, byte);
-		break;
-	case 0xd600:				/* PBI page D6 */
-		PBI_D6PutByte(addr, byte);
-		break;
-	case 0xd700:				/* PBI page D7 */
-		PBI_D7PutByte(addr, byte);
-		break;
-	default:
-		break;
+	for (; page1 <= page2; page1++) {
+		MEMORY_hw_readmap[page1] = rd;
+		MEMORY_hw_writemap[page1] = wr;
+	}
+}
+
+/* Fills MEMORY_hw_readmap and MEMORY_hw_writemap. Only the pages that
+   contain MEMORY_HARDWARE addresses are ever looked up. */
+static void InitHwMaps(void)
+{
+	SetHwPages(0x00, 0xff, NoHwGetByte, NoHwPutByte);
+	SetHwPages(0x4f, 0x4f, CARTRIDGE_BountyBob1GetByte, CARTRIDGE_BountyBob1PutByte);
+	SetHwPages(0x8f, 0x8f, CARTRIDGE_BountyBob1GetByte, CARTRIDGE_BountyBob1PutByte);
+	SetHwPages(0x5f, 0x5f, CARTRIDGE_BountyBob2GetByte, CARTRIDGE_BountyBob2PutByte);
+	SetHwPages(0x9f, 0x9f, CARTRIDGE_BountyBob2GetByte, CARTRIDGE_BountyBob2PutByte);
+	SetHwPages(0xbf, 0xbf, CARTRIDGE_5200SuperCartGetByte, CARTRIDGE_5200SuperCartPutByte);
+	if (Atari800_machine_type == Atari800_MACHINE_5200) {
+		SetHwPages(0xc0, 0xcf, GTIA_GetByte, GTIA_PutByte);
+		SetHwPages(0xe8, 0xef, POKEY_GetByte, POKEY_PutByte);
+	}
+	else {
+		SetHwPages(0x0f, 0x0f, AxlonGetByte, AxlonPutByte);	/* Axlon shadow */
+		SetHwPages(0xcf, 0xcf, AxlonGetByte, AxlonPutByte);	/* Axlon memory expansion for 800 */
+		SetHwPages(0xff, 0xff, MosaicGetByte, MosaicPutByte);	/* Mosaic memory expansion for 400/800 */
 	}
+	SetHwPages(0xd0, 0xd0, GTIA_GetByte, GTIA_PutByte);
+	SetHwPages(0xd1, 0xd1, PBI_D1GetByte, PBI_D1PutByte);
+	SetHwPages(0xd2, 0xd2, POKEY_GetByte, POKEY_PutByte);
+	SetHwPages(0xd3, 0xd3, PIA_GetByte, PIA_PutByte);
+	SetHwPages(0xd4, 0xd4, ANTIC_GetByte, ANTIC_PutByte);
+	SetHwPages(0xd5, 0xd5, CARTRIDGE_GetByte, CARTRIDGE_PutByte);	/* bank-switching cartridges, RTIME-8 */
+	SetHwPages(0xd6, 0xd6, PBI_D6GetByte, PBI_D6PutByte);
+	SetHwPages(0xd7, 0xd7, PBI_D7GetByte, PBI_D7PutByte);
 }
 #endif /* PAGED_MEM */
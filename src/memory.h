@@ -6,18 +6,45 @@
 
 #include "atari.h"
 
+#ifdef CPU_BLOCK_CACHE
+#include "cpu.h"
+/* Drops the CPU's predecoded code if X is part of it. */
+#define MEMORY_MARK_CODE(x)				(CPU_code[(UWORD) (x)] ? CPU_InvalidateCode((UWORD) (x) >> 8, TRUE) : (void) 0)
+#else
+#define MEMORY_MARK_CODE(x)				((void) 0)
+#endif /* CPU_BLOCK_CACHE */
+
+/* One byte per 256-byte page of MEMORY_mem, set to MEMORY_DIRTY_ALL whenever
+   the contents or the attributes of the page change. Each bit is cleared by
+   a different user, so that each can tell which pages changed since it last
+   looked at them. */
+extern UBYTE MEMORY_dirty[256];
+#define MEMORY_DIRTY_DELTA				0x01	/* delta state snapshots (libatari800) */
+#define MEMORY_DIRTY_XE					0x02	/* XE bank in 0x4000-0x7fff */
+#define MEMORY_DIRTY_AXLON				0x04	/* Axlon bank in 0x4000-0x7fff */
+#define MEMORY_DIRTY_MOSAIC				0x08	/* Mosaic bank in 0xc000-0xcfff */
+#define MEMORY_DIRTY_UNDER_OS			0x10	/* RAM under OS ROM */
+#define MEMORY_DIRTY_UNDER_BASIC		0x20	/* RAM under BASIC ROM */
+#define MEMORY_DIRTY_ALL				0xff
+#define MEMORY_MARK_DIRTY(x)			(MEMORY_dirty[((x) >> 8) & 0xff] = MEMORY_DIRTY_ALL, MEMORY_MARK_CODE(x))
+/* Flags the pages between ADDR1 and ADDR2 inclusive. */
+void MEMORY_MarkDirty(UWORD addr1, UWORD addr2);
+
 #define MEMORY_dGetByte(x)				(MEMORY_mem[x])
-#define MEMORY_dPutByte(x, y)			(MEMORY_mem[x] = y)
+#define MEMORY_dPutByte(x, y)			(MEMORY_MARK_DIRTY(x), MEMORY_mem[x] = y)
+/* Stores Y at 0x0100 + S. The stack page is always included in delta
+   snapshots, so the store is not tracked and S is evaluated only once. */
+#define MEMORY_dPushByte(s, y)			(MEMORY_mem[0x0100 + (s)] = y)
 
 #ifndef WORDS_BIGENDIAN
 #ifdef WORDS_UNALIGNED_OK
 #define MEMORY_dGetWord(x)				UNALIGNED_GET_WORD(MEMORY_mem+(x), memory_read_word_stat)
-#define MEMORY_dPutWord(x, y)			UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_word_stat)
+#define MEMORY_dPutWord(x, y)			(MEMORY_MARK_DIRTY(x), MEMORY_MARK_DIRTY((x) + 1), UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_word_stat))
 #define MEMORY_dGetWordAligned(x)		UNALIGNED_GET_WORD(MEMORY_mem+(x), memory_read_aligned_word_stat)
-#define MEMORY_dPutWordAligned(x, y)	UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_aligned_word_stat)
+#define MEMORY_dPutWordAligned(x, y)	(MEMORY_MARK_DIRTY(x), UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_aligned_word_stat))
 #else	/* WORDS_UNALIGNED_OK */
 #define MEMORY_dGetWord(x)				(MEMORY_mem[x] + (MEMORY_mem[(x) + 1] << 8))
-#define MEMORY_dPutWord(x, y)			(MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_MARK_DIRTY(x), MEMORY_MARK_DIRTY((x) + 1), MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
 /* faster versions of MEMORY_jdGetWord and MEMORY_dPutWord for even addresses */
 /* TODO: guarantee that memory is UWORD-aligned and use UWORD access */
 #define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
@@ -26,14 +53,14 @@
 #else	/* WORDS_BIGENDIAN */
 /* can't do any word optimizations for big endian machines */
 #define MEMORY_dGetWord(x)				(MEMORY_mem[x] + (MEMORY_mem[(x) + 1] << 8))
-#define MEMORY_dPutWord(x, y)			(MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_MARK_DIRTY(x), MEMORY_MARK_DIRTY((x) + 1), MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
 #define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
 #define MEMORY_dPutWordAligned(x, y)	MEMORY_dPutWord(x, y)
 #endif	/* WORDS_BIGENDIAN */
 
 #define MEMORY_dCopyFromMem(from, to, size)	memcpy(to, MEMORY_mem + (from), size)
-#define MEMORY_dCopyToMem(from, to, size)		memcpy(MEMORY_mem + (to), from, size)
-#define MEMORY_dFillMem(addr1, value, length)	memset(MEMORY_mem + (addr1), value, length)
+#define MEMORY_dCopyToMem(from, to, size)		(memcpy(MEMORY_mem + (to), from, size), MEMORY_MarkDirty(to, (to) + (size) - 1))
+#define MEMORY_dFillMem(addr1, value, length)	(memset(MEMORY_mem + (addr1), value, length), MEMORY_MarkDirty(addr1, (addr1) + (length) - 1))
 
 extern UBYTE MEMORY_mem[65536 + 2];
 
@@ -50,6 +77,9 @@ extern int MEMORY_ram_size;
 #define MEMORY_ROM       1
 #define MEMORY_HARDWARE  2
 
+typedef UBYTE (*MEMORY_rdfunc)(UWORD addr, int no_side_effects);
+typedef void (*MEMORY_wrfunc)(UWORD addr, UBYTE value);
+
 #ifndef PAGED_ATTRIB
 
 extern UBYTE MEMORY_attrib[65536];
@@ -58,15 +88,13 @@ extern UBYTE MEMORY_attrib[65536];
 #define MEMORY_GetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, FALSE) : MEMORY_mem[addr])
 /* Reads a byte from ADDR, but without any side effects. */
 #define MEMORY_SafeGetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_mem[addr] = byte; else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
-#define MEMORY_SetRAM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_RAM, (addr2) - (addr1) + 1)
-#define MEMORY_SetROM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_ROM, (addr2) - (addr1) + 1)
-#define MEMORY_SetHARDWARE(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_HARDWARE, (addr2) - (addr1) + 1)
+#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) { MEMORY_MARK_DIRTY(addr); MEMORY_mem[addr] = byte; } else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
+#define MEMORY_SetRAM(addr1, addr2) (memset(MEMORY_attrib + (addr1), MEMORY_RAM, (addr2) - (addr1) + 1), MEMORY_MarkDirty(addr1, addr2))
+#define MEMORY_SetROM(addr1, addr2) (memset(MEMORY_attrib + (addr1), MEMORY_ROM, (addr2) - (addr1) + 1), MEMORY_MarkDirty(addr1, addr2))
+#define MEMORY_SetHARDWARE(addr1, addr2) (memset(MEMORY_attrib + (addr1), MEMORY_HARDWARE, (addr2) - (addr1) + 1), MEMORY_MarkDirty(addr1, addr2))
 
 #else /* PAGED_ATTRIB */
 
-typedef UBYTE (*MEMORY_rdfunc)(UWORD addr, int no_side_effects);
-typedef void (*MEMORY_wrfunc)(UWORD addr, UBYTE value);
 extern MEMORY_rdfunc MEMORY_readmap[256];
 extern MEMORY_rdfunc MEMORY_safe_readmap[256];
 extern MEMORY_wrfunc MEMORY_writemap[256];
@@ -76,7 +104,7 @@ void MEMORY_ROM_PutByte(UWORD addr, UBYTE byte);
 #define MEMORY_GetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, FALSE) : MEMORY_mem[addr])
 /* Reads a byte from ADDR, but without any side effects. */
 #define MEMORY_SafeGetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_mem[addr] = byte))
+#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_MARK_DIRTY(addr), MEMORY_mem[addr] = byte))
 #define MEMORY_SetRAM(addr1, addr2) do { \
 		int i; \
 		for (i = (addr1) >> 8; i <= (addr2) >> 8; i++) { \
@@ -109,6 +137,13 @@ int MEMORY_SizeValid(int size);
 void MEMORY_InitialiseMachine(void);
 void MEMORY_StateSave(UBYTE SaveVerbose);
 void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion);
+#ifdef LIBATARI800
+/* When set, MEMORY_StateSave/MEMORY_StateRead save/read only the pages
+   that differ from the base snapshot taken by MEMORY_DeltaBase(). */
+extern int MEMORY_state_delta;
+void MEMORY_DeltaBase(void);
+void MEMORY_DeltaFree(void);
+#endif /* LIBATARI800 */
 void MEMORY_CopyFromMem(UWORD from, UBYTE *to, int size);
 void MEMORY_CopyToMem(const UBYTE *from, UWORD to, int size);
 void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval);
@@ -116,7 +151,7 @@ void MEMORY_Cart809fDisable(void);
 void MEMORY_Cart809fEnable(void);
 void MEMORY_CartA0bfDisable(void);
 void MEMORY_CartA0bfEnable(void);
-#define MEMORY_CopyROM(addr1, addr2, src) memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1)
+#define MEMORY_CopyROM(addr1, addr2, src) (memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1), MEMORY_MarkDirty(addr1, addr2))
 void MEMORY_GetCharset(UBYTE *cs);
 
 /* Mosaic and Axlon 400/800 RAM extensions */
@@ -128,11 +163,16 @@ extern int MEMORY_axlon_num_banks;
 extern int MEMORY_enable_mapram;
 
 #ifndef PAGED_MEM
+/* Handlers of the special addresses, one per 256-byte page, set up by
+   MEMORY_InitialiseMachine for the current machine type. */
+extern MEMORY_rdfunc MEMORY_hw_readmap[256];
+extern MEMORY_wrfunc MEMORY_hw_writemap[256];
+
 /* Reads a byte from the specified special address (not RAM or ROM). */
-UBYTE MEMORY_HwGetByte(UWORD addr, int safe);
+#define MEMORY_HwGetByte(addr, safe)	((*MEMORY_hw_readmap[(addr) >> 8])(addr, safe))
 
 /* Stores a byte at the specified special address (not RAM or ROM). */
-void MEMORY_HwPutByte(UWORD addr, UBYTE byte);
+#define MEMORY_HwPutByte(addr, byte)	((*MEMORY_hw_writemap[(addr) >> 8])(addr, byte))
 #endif /* PAGED_MEM */
 
 #endif /* MEMORY_H_ */
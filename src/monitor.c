@@ -1121,6 +1121,7 @@ static UWORD assembler(UWORD addr)
 #endif /* MONITOR_ASSEMBLER */
 
 #ifdef MONITOR_PROFILE
+int MONITOR_profile_enabled = FALSE;
 MONITOR_coverage_rec MONITOR_coverage[0x10000];
 unsigned long MONITOR_coverage_insns;
 unsigned long MONITOR_coverage_cycles;
@@ -1824,9 +1825,22 @@ static void get_terminal_size(int *cols, int *rows) {
 
 
 #ifdef MONITOR_PROFILE
+/* Switches profiling on/off or displays the most executed opcodes. */
 static void command_PROFILE(void)
 {
 	int i;
+	char *t = get_token();
+	if (t != NULL) {
+		if (Util_stricmp(t, "ON") == 0)
+			MONITOR_profile_enabled = TRUE;
+		else if (Util_stricmp(t, "OFF") == 0)
+			MONITOR_profile_enabled = FALSE;
+		else
+			printf("Invalid argument. Usage: PROFILE [ON or OFF]\n");
+		return;
+	}
+	if (!MONITOR_profile_enabled)
+		printf("Profiling is off. Use PROFILE ON to collect statistics.\n");
 	for (i = 0; i < 24; i++) {
 		int max, instr;
 		int j;
@@ -2045,6 +2059,8 @@ static void coverage(void)
 
 	if(!MONITOR_coverage_insns) {
 		printf("No instructions executed since last reset\n");
+		if (!MONITOR_profile_enabled)
+			printf("Profiling is off. Use PROFILE ON to collect statistics.\n");
 		return;
 	}
 
@@ -2176,6 +2192,8 @@ static void monitor_read_from_file(UWORD *addr)
 			else {
 				if (fread(&MEMORY_mem[*addr], 1, nbytes, f) == 0)
 					perror(filename);
+				else
+					MEMORY_MarkDirty(*addr, *addr + nbytes - 1);
 				fclose(f);
 			}
 		}
@@ -2915,7 +2933,8 @@ static void show_help(void)
 		"DLIST [startaddr]              - Show Display List\n");
 	printf(
 #ifdef MONITOR_PROFILE
-		"PROFILE                        - Display profiling statistics\n"
+		"PROFILE [ON or OFF]            - Display profiling statistics or turn\n"
+		"                                 profiling on/off (affects COV too)\n"
 		"COV [argument...]              - Coverage statistics (\"COV ?\" for help)\n");
 	printf(
 #endif
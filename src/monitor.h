@@ -70,6 +70,9 @@ extern int MONITOR_breakpoints_enabled;
 #endif /* MONITOR_BREAKPOINTS */
 
 #ifdef MONITOR_PROFILE
+/* Profiling slows down the emulation, so it is only done when enabled. */
+extern int MONITOR_profile_enabled;
+
 typedef struct {
 	unsigned long count; /* number of times executed since last reset */
 	unsigned long cycles; /* number of cycles executed since last reset */
@@ -117,7 +117,7 @@ int PBI_PROTO80_D1ffPutByte(UBYTE byte)
 {
 	int result = 0; /* handled */
 	if (PBI_PROTO80_enabled && byte == PROTO80_MASK) {
-		memcpy(MEMORY_mem + 0xd800, proto80rom, 0x800);
+		MEMORY_dCopyToMem(proto80rom, 0xd800, 0x800);
 		D(printf("PROTO80 rom activated\n"));
 	}
 	else result = PBI_NOT_HANDLED;
@@ -174,10 +174,6 @@ static int POKEY_siocheck(void)
 		&& (POKEY_AUDCTL[0] & 0x28) == 0x28;
 }
 
-#ifndef SOUND_GAIN /* sound gain can be pre-defined in the configure/Makefile */
-#define SOUND_GAIN 4
-#endif
-
 #ifndef SOUND
 #define POKEYSND_Update(addr, val, chip, gain)
 #endif
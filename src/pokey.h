@@ -97,6 +97,10 @@ void POKEY_StateRead(void);
 
 #define POKEY_MAXPOKEYS         2		/* max number of emulated chips */
 
+#ifndef SOUND_GAIN /* sound gain can be pre-defined in the configure/Makefile */
+#define SOUND_GAIN 4
+#endif
+
 /* channel/chip definitions */
 #define POKEY_CHAN1       0
 #define POKEY_CHAN2       1
@@ -38,6 +38,7 @@
 #endif
 #include "mzpokeysnd.h"
 #include "pokeysnd.h"
+#include "shmstream.h"
 #if defined(PBI_XLD) || defined (VOICEBOX)
 #include "votraxsnd.h"
 #endif
@@ -293,10 +294,8 @@ static void init_vol_only(void)
 }
 #endif /* VOL_ONLY_SOUND */
 
-int POKEYSND_DoInit(void)
+static int init_engine(void)
 {
-	File_Export_StopRecording();
-
 #ifdef VOL_ONLY_SOUND
 	init_vol_only();
 #endif /* VOL_ONLY_SOUND */
@@ -313,6 +312,74 @@ int POKEYSND_DoInit(void)
 				POKEYSND_num_pokeys, POKEYSND_snd_flags);
 }
 
+/* TRUE between POKEYSND_Detach and POKEYSND_Attach */
+static int detached = FALSE;
+/* TRUE after the first POKEYSND_Init */
+static int initialised = FALSE;
+
+static void disconnect_engine(void)
+{
+	POKEYSND_Process_ptr = null_pokey_process;
+	POKEYSND_Update_ptr = null_pokey_sound;
+#ifdef SERIO_SOUND
+	POKEYSND_UpdateSerio = null_serio_sound;
+#endif
+#ifdef CONSOLE_SOUND
+	POKEYSND_UpdateConsol_ptr = null_consol_sound;
+#endif
+#ifdef VOL_ONLY_SOUND
+	POKEYSND_UpdateVolOnly = null_vol_only_sound;
+#endif
+#ifdef SYNCHRONIZED_SOUND
+	POKEYSND_GenerateSync = null_generate_sync;
+#endif
+}
+
+int POKEYSND_DoInit(void)
+{
+	int result;
+	File_Export_StopRecording();
+	result = init_engine();
+	/* init_engine connects the engine */
+	if (detached)
+		disconnect_engine();
+	return result;
+}
+
+void POKEYSND_Detach(void)
+{
+	detached = TRUE;
+	disconnect_engine();
+}
+
+int POKEYSND_Attach(void)
+{
+	int chip;
+	int i;
+	int result;
+
+	detached = FALSE;
+	if (!initialised)
+		return 0; /* POKEYSND_Init will connect the engine */
+	result = init_engine();
+
+#ifdef SYNCHRONIZED_SOUND
+	POKEYSND_process_buffer_fill = 0;
+	prev_update_tick = ANTIC_CPU_CLOCK;
+#endif
+	/* The engine starts from silence; bring it up to date with the
+	   registers written while it was detached. */
+	for (chip = 0; chip < POKEYSND_num_pokeys; chip++) {
+		POKEYSND_Update_ptr(POKEY_OFFSET_AUDCTL, POKEY_AUDCTL[chip], (UBYTE) chip, SOUND_GAIN);
+		for (i = 0; i < 4; i++) {
+			POKEYSND_Update_ptr((UWORD) (POKEY_OFFSET_AUDF1 + i * 2), POKEY_AUDF[chip * 4 + i], (UBYTE) chip, SOUND_GAIN);
+			POKEYSND_Update_ptr((UWORD) (POKEY_OFFSET_AUDC1 + i * 2), POKEY_AUDC[chip * 4 + i], (UBYTE) chip, SOUND_GAIN);
+		}
+	}
+	POKEYSND_Update_ptr(POKEY_OFFSET_SKCTL, POKEY_SKCTL, 0, SOUND_GAIN);
+	return result;
+}
+
 int POKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
                      int flags
 #ifdef __PLUS
@@ -320,6 +387,7 @@ int POKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
 #endif
 )
 {
+	initialised = TRUE;
 	snd_freq17 = freq17;
 	POKEYSND_playback_freq = playback_freq;
 	POKEYSND_num_pokeys = num_pokeys;
@@ -363,6 +431,9 @@ void POKEYSND_Process(void *sndbuffer, int sndn)
 #endif
 #if !defined(__PLUS) && !defined(ASAP)
 	File_Export_WriteAudio((const unsigned char *)sndbuffer, sndn);
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	SHMSTREAM_WriteAudio((const unsigned char *)sndbuffer, sndn);
+#endif
 #endif
 }
 
@@ -385,6 +456,9 @@ int POKEYSND_UpdateProcessBuffer(void)
 #endif
 #if !defined(__PLUS) && !defined(ASAP)
 	File_Export_WriteAudio((const unsigned char *)POKEYSND_process_buffer, sndn);
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	SHMSTREAM_WriteAudio((const unsigned char *)POKEYSND_process_buffer, sndn);
+#endif
 #endif
 	return sndn;
 }
@@ -110,6 +110,15 @@ void POKEYSND_UpdateConsol(int set);
    must be a multiple of POKEYSND_num_pokeys. */
 void POKEYSND_Process(void *sndbuffer, int sndn);
 int POKEYSND_DoInit(void);
+/* Disconnects the sound engine: POKEY register writes no longer reach it and
+   POKEYSND_Process produces no samples. POKEY timers, IRQs and serial I/O
+   are not affected. The engine stays disconnected through POKEYSND_Init and
+   POKEYSND_DoInit until POKEYSND_Attach. */
+void POKEYSND_Detach(void);
+/* Reinitialises the sound engine after POKEYSND_Detach and loads the current
+   POKEY registers into it. Before the first POKEYSND_Init it only lets
+   POKEYSND_Init connect the engine. */
+int POKEYSND_Attach(void);
 void POKEYSND_SetMzQuality(int quality);
 void POKEYSND_SetVolume(int vol);
 
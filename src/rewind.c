@@ -0,0 +1,410 @@
+/*
+ * rewind.c - stepping the emulated machine back in time
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "akey.h"
+#include "atari.h"
+#include "input.h"
+#include "log.h"
+#include "rewind.h"
+#include "statesav.h"
+#include "util.h"
+
+int REWIND_buffer_size = 0;
+int REWIND_interval = 1;
+
+/* The newest captured state is kept in full in head_state. Every older state
+   is stored in the ring as the XOR of itself and the state captured after it,
+   with the runs of zero bytes squeezed out. Stepping back decodes the newest
+   entry into head_state; when the ring is full the oldest entries are
+   dropped.
+
+   An entry is laid out as: ULONG data length, ULONG length of the older
+   state, data, ULONG data length again (so the ring can be walked from both
+   ends). Entries wrap around the end of the ring. */
+static UBYTE *ring = NULL;
+static ULONG ring_size = 0;
+static ULONG ring_first = 0;	/* offset of the oldest entry */
+static ULONG ring_end = 0;	/* offset after the newest entry */
+static ULONG ring_used = 0;
+static int ring_entries = 0;
+
+/* State buffers. Bytes past the used length are kept zero, so states of
+   different lengths can be XORed with each other. */
+static UBYTE *head_state = NULL;	/* newest captured state */
+static ULONG head_len = 0;		/* 0 if no state has been captured */
+static UBYTE *new_state = NULL;		/* buffer for the next capture */
+static ULONG new_len = 0;
+static ULONG state_size = 0;		/* size of head_state and new_state */
+static UBYTE *packed = NULL;		/* encoded entry, 2 * state_size */
+
+/* Frames emulated since head_state was captured or restored */
+static int frames_ahead = 0;
+
+#define ENTRY_OVERHEAD (3 * sizeof(ULONG))
+/* Equal bytes needed to end a run of changed bytes */
+#define MIN_EQUAL_RUN 4
+/* Largest state buffer tried before giving up */
+#define MAX_STATE_SIZE (64 * 1024 * 1024)
+
+int REWIND_ReadConfig(char *string, char *ptr)
+{
+	if (strcmp(string, "REWIND_BUFFER_SIZE") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value < 0)
+			return FALSE;
+		REWIND_buffer_size = value;
+	}
+	else if (strcmp(string, "REWIND_INTERVAL") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value < 1)
+			return FALSE;
+		REWIND_interval = value;
+	}
+	else return FALSE;
+	return TRUE;
+}
+
+void REWIND_WriteConfig(FILE *fp)
+{
+	fprintf(fp, "REWIND_BUFFER_SIZE=%d\n", REWIND_buffer_size);
+	fprintf(fp, "REWIND_INTERVAL=%d\n", REWIND_interval);
+}
+
+int REWIND_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	int help_only = FALSE;
+
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+		int a_i = FALSE;			/* error, argument invalid! */
+
+		if (strcmp(argv[i], "-rewind") == 0) {
+			if (i_a) {
+				REWIND_buffer_size = Util_sscandec(argv[++i]);
+				if (REWIND_buffer_size < 0)
+					a_i = TRUE;
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-rewind-interval") == 0) {
+			if (i_a) {
+				REWIND_interval = Util_sscandec(argv[++i]);
+				if (REWIND_interval < 1)
+					a_i = TRUE;
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				help_only = TRUE;
+				Log_print("\t-rewind <kb>     Keep <kb> kilobytes of rewind history (0 = off)");
+				Log_print("\t-rewind-interval <n>");
+				Log_print("\t                 Capture the state for rewinding every <n> frames");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		} else if (a_i) {
+			Log_print("Invalid argument for '%s'", argv[--i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (!help_only)
+		REWIND_SetBuffer(REWIND_buffer_size, REWIND_interval);
+
+	return TRUE;
+}
+
+void REWIND_Exit(void)
+{
+	free(ring);
+	free(head_state);
+	free(new_state);
+	free(packed);
+	ring = NULL;
+	head_state = NULL;
+	new_state = NULL;
+	packed = NULL;
+	ring_size = 0;
+	state_size = 0;
+	head_len = 0;
+	new_len = 0;
+	ring_first = ring_end = ring_used = 0;
+	ring_entries = 0;
+}
+
+void REWIND_SetBuffer(int size, int interval)
+{
+	REWIND_Exit();
+	REWIND_buffer_size = size;
+	REWIND_interval = interval < 1 ? 1 : interval;
+	if (size > 0) {
+		ring_size = (ULONG) size * 1024;
+		ring = (UBYTE *) Util_malloc(ring_size);
+	}
+}
+
+void REWIND_Clear(void)
+{
+	if (head_len != 0) {
+		memset(head_state, 0, head_len);
+		head_len = 0;
+	}
+	ring_first = ring_end = ring_used = 0;
+	ring_entries = 0;
+	frames_ahead = 0;
+}
+
+/* Reallocates the state buffers, keeping their contents. */
+static void resize_states(ULONG size)
+{
+	head_state = (UBYTE *) Util_realloc(head_state, size);
+	new_state = (UBYTE *) Util_realloc(new_state, size);
+	memset(head_state + state_size, 0, size - state_size);
+	memset(new_state + state_size, 0, size - state_size);
+	packed = (UBYTE *) Util_realloc(packed, 2 * size);
+	state_size = size;
+}
+
+static void ring_put(const void *data, ULONG len)
+{
+	ULONG part = ring_size - ring_end;
+	if (part > len)
+		part = len;
+	memcpy(ring + ring_end, data, part);
+	memcpy(ring, (const UBYTE *) data + part, len - part);
+	ring_end = (ring_end + len) % ring_size;
+	ring_used += len;
+}
+
+static void ring_get(ULONG offset, void *data, ULONG len)
+{
+	ULONG part;
+	offset %= ring_size;
+	part = ring_size - offset;
+	if (part > len)
+		part = len;
+	memcpy(data, ring + offset, part);
+	memcpy((UBYTE *) data + part, ring, len - part);
+}
+
+static void drop_oldest(void)
+{
+	ULONG data_len;
+	ring_get(ring_first, &data_len, sizeof(ULONG));
+	ring_first = (ring_first + data_len + ENTRY_OVERHEAD) % ring_size;
+	ring_used -= data_len + ENTRY_OVERHEAD;
+	ring_entries--;
+}
+
+static UBYTE *put_count(UBYTE *p, ULONG value)
+{
+	while (value >= 0x80) {
+		*p++ = (UBYTE) (value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (UBYTE) value;
+	return p;
+}
+
+static const UBYTE *get_count(const UBYTE *p, ULONG *value)
+{
+	ULONG result = 0;
+	int shift = 0;
+	while (*p & 0x80) {
+		result |= (ULONG) (*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	*value = result | ((ULONG) *p++ << shift);
+	return p;
+}
+
+/* Encodes the XOR of the first len bytes of a and b into packed, as pairs of
+   (number of equal bytes, number of changed bytes) followed by the XORed
+   changed bytes. Returns the length of the encoded data. */
+static ULONG encode_delta(const UBYTE *a, const UBYTE *b, ULONG len)
+{
+	UBYTE *p = packed;
+	ULONG pos = 0;
+	while (pos < len) {
+		ULONG start = pos;
+		ULONG equal = 0;
+		while (pos + 8 <= len && memcmp(a + pos, b + pos, 8) == 0)
+			pos += 8;
+		while (pos < len && a[pos] == b[pos])
+			pos++;
+		if (pos == len)
+			break;
+		p = put_count(p, pos - start);
+		start = pos;
+		while (pos < len) {
+			if (a[pos] == b[pos]) {
+				if (++equal == MIN_EQUAL_RUN) {
+					pos -= MIN_EQUAL_RUN - 1;
+					break;
+				}
+			}
+			else
+				equal = 0;
+			pos++;
+		}
+		p = put_count(p, pos - start);
+		for (; start < pos; start++)
+			*p++ = a[start] ^ b[start];
+	}
+	return (ULONG) (p - packed);
+}
+
+/* XORs the changes encoded by encode_delta into state. */
+static void apply_delta(UBYTE *state, ULONG packed_len)
+{
+	const UBYTE *p = packed;
+	const UBYTE *end = packed + packed_len;
+	ULONG pos = 0;
+	while (p < end) {
+		ULONG equal;
+		ULONG changed;
+		p = get_count(p, &equal);
+		p = get_count(p, &changed);
+		pos += equal;
+		if (pos + changed > state_size)
+			break;
+		while (changed-- > 0)
+			state[pos++] ^= *p++;
+	}
+}
+
+static void push_entry(ULONG older_len, ULONG packed_len)
+{
+	ULONG total = packed_len + ENTRY_OVERHEAD;
+	if (total > ring_size) {
+		/* the history before this state is lost */
+		ring_first = ring_end = ring_used = 0;
+		ring_entries = 0;
+		return;
+	}
+	while (ring_size - ring_used < total)
+		drop_oldest();
+	ring_put(&packed_len, sizeof(ULONG));
+	ring_put(&older_len, sizeof(ULONG));
+	ring_put(packed, packed_len);
+	ring_put(&packed_len, sizeof(ULONG));
+	ring_entries++;
+}
+
+/* Replaces head_state with the state captured before it. */
+static void pop_entry(void)
+{
+	ULONG packed_len;
+	ULONG older_len;
+	ULONG start;
+	ring_get(ring_end + ring_size - sizeof(ULONG), &packed_len, sizeof(ULONG));
+	start = (ring_end + ring_size - (packed_len + ENTRY_OVERHEAD)) % ring_size;
+	ring_get(start + sizeof(ULONG), &older_len, sizeof(ULONG));
+	ring_get(start + 2 * sizeof(ULONG), packed, packed_len);
+	ring_end = start;
+	ring_used -= packed_len + ENTRY_OVERHEAD;
+	ring_entries--;
+	apply_delta(head_state, packed_len);
+	head_len = older_len;
+}
+
+static void capture(void)
+{
+	ULONG len;
+	UBYTE *swap;
+
+	if (state_size == 0)
+		resize_states(STATESAV_MAX_SIZE);
+	while (!StateSav_SaveAtariStateToMemory(new_state, state_size, &len)) {
+		if (len == 0 || state_size >= MAX_STATE_SIZE) {
+			Log_print("Rewind: cannot capture the emulator state, rewinding disabled");
+			REWIND_SetBuffer(0, REWIND_interval);
+			return;
+		}
+		resize_states(state_size * 2);
+	}
+	if (len < new_len)
+		memset(new_state + len, 0, new_len - len);
+	if (head_len != 0)
+		push_entry(head_len, encode_delta(head_state, new_state, len > head_len ? len : head_len));
+	swap = head_state;
+	head_state = new_state;
+	new_state = swap;
+	new_len = head_len;
+	head_len = len;
+	frames_ahead = 0;
+}
+
+void REWIND_Frame(void)
+{
+	if (ring == NULL)
+		return;
+	/* don't record the frames shown while the rewind key is held */
+	if (INPUT_key_code == AKEY_REWIND)
+		return;
+	if (head_len == 0 || ++frames_ahead >= REWIND_interval)
+		capture();
+}
+
+int REWIND_Back(int steps)
+{
+	int taken = 0;
+
+	if (steps <= 0 || head_len == 0)
+		return 0;
+	/* first return to the newest state if the machine has moved on from it */
+	if (frames_ahead > 0) {
+		frames_ahead = 0;
+		taken++;
+	}
+	while (taken < steps && ring_entries > 0) {
+		pop_entry();
+		taken++;
+	}
+	if (taken > 0 && !StateSav_ReadAtariStateFromMemory(head_state, head_len)) {
+		Log_print("Rewind: cannot restore the emulator state");
+		REWIND_Clear();
+		return 0;
+	}
+	return taken;
+}
+
+int REWIND_Available(void)
+{
+	if (head_len == 0)
+		return 0;
+	return ring_entries + (frames_ahead > 0);
+}
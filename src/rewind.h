@@ -0,0 +1,31 @@
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include <stdio.h>
+#include "atari.h"
+
+/* Size of the rewind history in kilobytes, 0 disables rewinding. */
+extern int REWIND_buffer_size;
+/* Number of frames between two captured states. */
+extern int REWIND_interval;
+
+int REWIND_ReadConfig(char *string, char *ptr);
+void REWIND_WriteConfig(FILE *fp);
+int REWIND_Initialise(int *argc, char *argv[]);
+void REWIND_Exit(void);
+
+/* Changes the history size (in kilobytes) and the capture interval.
+   The recorded history is dropped. */
+void REWIND_SetBuffer(int size, int interval);
+/* Drops the recorded history. */
+void REWIND_Clear(void);
+/* Called at the end of each frame; captures the machine state every
+   REWIND_interval frames. */
+void REWIND_Frame(void);
+/* Puts the machine back by up to steps captured states. Returns the number
+   of steps taken, 0 if there is no history. */
+int REWIND_Back(int steps);
+/* Returns the number of steps REWIND_Back can currently take. */
+int REWIND_Available(void);
+
+#endif /* REWIND_H_ */
@@ -89,6 +89,7 @@ static int KBD_BREAK = SDLK_F7;
 static int KBD_MON = SDLK_F8;
 static int KBD_EXIT = SDLK_F9;
 static int KBD_SSHOT = SDLK_F10;
+static int KBD_REWIND = SDLK_F11;
 static int KBD_TURBO = SDLK_F12;
 
 /* real joysticks */
@@ -258,6 +259,8 @@ int SDL_INPUT_ReadConfig(char *option, char *parameters)
 		return SDLKeyBind(&KBD_SSHOT, parameters);
 	else if (strcmp(option, "SDL_TURBO_KEY") == 0)
 		return SDLKeyBind(&KBD_TURBO, parameters);
+	else if (strcmp(option, "SDL_REWIND_KEY") == 0)
+		return SDLKeyBind(&KBD_REWIND, parameters);
 	else
 		return FALSE;
 }
@@ -292,6 +295,7 @@ void SDL_INPUT_WriteConfig(FILE *fp)
 	fprintf(fp, "SDL_EXIT_KEY=%d\n", KBD_EXIT);
 	fprintf(fp, "SDL_SSHOT_KEY=%d\n", KBD_SSHOT);
 	fprintf(fp, "SDL_TURBO_KEY=%d\n", KBD_TURBO);
+	fprintf(fp, "SDL_REWIND_KEY=%d\n", KBD_REWIND);
 	
 	write_real_js_configs(fp);
 }
@@ -767,6 +771,10 @@ int PLATFORM_Keyboard(void)
 		key_pressed = 0;
 		return AKEY_TURBO;
 	}
+	if (lastkey == KBD_REWIND) {
+		/* keep going back while the key is held */
+		return AKEY_REWIND;
+	}
 	if (UI_alt_function != -1) {
 		key_pressed = 0;
 		return AKEY_UI;
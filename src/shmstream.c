@@ -0,0 +1,255 @@
+/*
+ * shmstream.c - publishing frames and audio through shared memory
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _POSIX_C_SOURCE 200112L /* for ftruncate */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "colours.h"
+#include "log.h"
+#include "screen.h"
+#include "shmstream.h"
+#include "util.h"
+#ifdef SOUND
+#include "sound.h"
+#endif
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_FTRUNCATE) && defined(HAVE_UNISTD_H) && defined(HAVE_FCNTL_H)
+#define SHMSTREAM_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __GNUC__
+#define BARRIER() __sync_synchronize()
+#else
+#define BARRIER()
+#endif
+
+/* Enough for 65535 Hz 16-bit stereo at PAL frame rate, with room to spare
+   for frames that emulate a little more than their share of CPU cycles. */
+#define AUDIO_MAX 8192
+
+static char *filename = NULL;
+static int num_slots = 8;
+
+static SHMSTREAM_header_t *header = NULL;
+static size_t map_size;
+
+/* Audio generated since the last frame was published. */
+static UBYTE audio[AUDIO_MAX];
+static unsigned int audio_len = 0;
+
+int SHMSTREAM_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	int help_only = FALSE;
+
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+		int a_i = FALSE;			/* error, argument invalid! */
+
+		if (strcmp(argv[i], "-shmstream") == 0) {
+			if (i_a)
+				filename = argv[++i];
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-shmstream-slots") == 0) {
+			if (i_a) {
+				num_slots = Util_sscandec(argv[++i]);
+				if (num_slots < 2)
+					a_i = TRUE;
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				help_only = TRUE;
+				Log_print("\t-shmstream <file>");
+				Log_print("\t                 Publish frames and audio in shared memory file <file>");
+				Log_print("\t-shmstream-slots <n>");
+				Log_print("\t                 Keep the last <n> frames in the shared memory file");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		} else if (a_i) {
+			Log_print("Invalid argument for '%s'", argv[--i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (!help_only && filename != NULL)
+		return SHMSTREAM_Open(filename, num_slots);
+
+	return TRUE;
+}
+
+void SHMSTREAM_Exit(void)
+{
+	SHMSTREAM_Close();
+}
+
+#ifdef SHMSTREAM_SUPPORTED
+
+int SHMSTREAM_Open(const char *name, int slots)
+{
+	int fd;
+	int i;
+	unsigned int slot_size;
+	unsigned int screen_offset = (sizeof(SHMSTREAM_slot_t) + 63) & ~63;
+	unsigned int audio_offset = screen_offset + Screen_WIDTH * Screen_HEIGHT;
+	void *map;
+
+	SHMSTREAM_Close();
+
+	slot_size = (audio_offset + AUDIO_MAX + 4095) & ~4095;
+	map_size = 4096 + (size_t) slots * slot_size;
+	fd = open(name, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		Log_print("Cannot open shared memory file %s", name);
+		return FALSE;
+	}
+	if (ftruncate(fd, (off_t) map_size) != 0) {
+		Log_print("Cannot resize shared memory file %s", name);
+		close(fd);
+		return FALSE;
+	}
+	map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		Log_print("Cannot map shared memory file %s", name);
+		return FALSE;
+	}
+
+	header = (SHMSTREAM_header_t *) map;
+	header->magic = 0;
+	header->version = SHMSTREAM_VERSION;
+	header->num_slots = slots;
+	header->slot_size = slot_size;
+	header->slots_offset = 4096;
+	header->screen_offset = screen_offset;
+	header->audio_offset = audio_offset;
+	header->audio_max = AUDIO_MAX;
+	header->width = Screen_WIDTH;
+	header->height = Screen_HEIGHT;
+	header->write_seq = 0;
+	for (i = 0; i < slots; i++)
+		SHMSTREAM_Slot(header, i)->seq = 0;
+	BARRIER();
+	header->magic = SHMSTREAM_MAGIC;
+	audio_len = 0;
+	return TRUE;
+}
+
+void SHMSTREAM_Close(void)
+{
+	if (header != NULL) {
+		munmap(header, map_size);
+		header = NULL;
+	}
+}
+
+void SHMSTREAM_WriteAudio(const unsigned char *samples, int num_samples)
+{
+	unsigned int len;
+
+	if (header == NULL)
+		return;
+#ifdef SOUND
+	len = num_samples * Sound_out.sample_size;
+#else
+	len = num_samples;
+#endif
+	if (len > AUDIO_MAX - audio_len)
+		len = AUDIO_MAX - audio_len;
+	memcpy(audio + audio_len, samples, len);
+	audio_len += len;
+}
+
+void SHMSTREAM_Frame(int drawn)
+{
+	unsigned int seq;
+	SHMSTREAM_slot_t *slot;
+	int i;
+
+	if (header == NULL)
+		return;
+	seq = header->write_seq + 1;
+	slot = SHMSTREAM_Slot(header, seq);
+
+	slot->seq = 0;
+	BARRIER();
+	slot->frame = Atari800_nframes;
+	slot->flags = drawn ? SHMSTREAM_DRAWN : 0;
+	for (i = 0; i < 256; i++)
+		slot->palette[i] = (unsigned int) Colours_table[i];
+	memcpy((UBYTE *) slot + header->screen_offset, Screen_atari, Screen_WIDTH * Screen_HEIGHT);
+	memcpy((UBYTE *) slot + header->audio_offset, audio, audio_len);
+	slot->audio_len = audio_len;
+#ifdef SOUND
+	slot->audio_freq = Sound_enabled ? Sound_out.freq : 0;
+	slot->audio_channels = Sound_out.channels;
+	slot->audio_sample_size = Sound_out.sample_size;
+#else
+	slot->audio_freq = 0;
+	slot->audio_channels = 0;
+	slot->audio_sample_size = 0;
+#endif
+	BARRIER();
+	slot->seq = seq;
+	BARRIER();
+	header->write_seq = seq;
+	audio_len = 0;
+}
+
+#else /* SHMSTREAM_SUPPORTED */
+
+int SHMSTREAM_Open(const char *name, int slots)
+{
+	Log_print("Shared memory streaming is not supported on this platform");
+	return FALSE;
+}
+
+void SHMSTREAM_Close(void)
+{
+}
+
+void SHMSTREAM_WriteAudio(const unsigned char *samples, int num_samples)
+{
+}
+
+void SHMSTREAM_Frame(int drawn)
+{
+}
+
+#endif /* SHMSTREAM_SUPPORTED */
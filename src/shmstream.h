@@ -0,0 +1,76 @@
+#ifndef SHMSTREAM_H_
+#define SHMSTREAM_H_
+
+/* Publishing of every emulated frame, with its palette and audio, to other
+   processes through a ring of slots in a shared memory file (normally one
+   on /dev/shm).
+
+   The file starts with an SHMSTREAM_header_t. Slots of slot_size bytes
+   follow from slots_offset on; frame number n (counting from 1) goes to slot
+   n % num_slots. A slot starts with an SHMSTREAM_slot_t, the screen follows
+   at screen_offset (width * height palette indices, as in Screen_atari) and
+   the audio at audio_offset (audio_len bytes in the format given in the
+   slot).
+
+   The emulator never waits for readers. Before it writes a slot it sets the
+   slot's seq to 0, after writing it sets seq to the frame number and then
+   updates write_seq in the header. A reader that wants frame n waits until
+   write_seq >= n and checks that the slot's seq is n. It can then use the
+   data in place, but must check seq again afterwards: if seq has changed the
+   slot was overwritten meanwhile, and the frame is lost. A reader that falls
+   more than num_slots frames behind should skip ahead to write_seq.
+
+   All fields are in the byte order of the emulating machine. */
+
+#define SHMSTREAM_MAGIC 0x41385348 /* 'A8SH' */
+#define SHMSTREAM_VERSION 1
+
+/* SHMSTREAM_slot_t.flags: the screen was redrawn in this frame (otherwise
+   it holds the last drawn frame, e.g. when frames are skipped). */
+#define SHMSTREAM_DRAWN 1
+
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int num_slots;
+	unsigned int slot_size;
+	unsigned int slots_offset;
+	unsigned int screen_offset;
+	unsigned int audio_offset;
+	unsigned int audio_max;
+	unsigned int width;
+	unsigned int height;
+	volatile unsigned int write_seq;
+} SHMSTREAM_header_t;
+
+typedef struct {
+	volatile unsigned int seq;
+	unsigned int frame; /* Atari800_nframes at the end of the frame */
+	unsigned int flags;
+	unsigned int audio_len;
+	unsigned int audio_freq;
+	unsigned int audio_channels;
+	unsigned int audio_sample_size;
+	unsigned int palette[256]; /* 0xRRGGBB */
+} SHMSTREAM_slot_t;
+
+/* Returns the slot that holds frame N. */
+#define SHMSTREAM_Slot(header, n) ((SHMSTREAM_slot_t *) ((unsigned char *) (header) \
+	+ (header)->slots_offset + (size_t) ((n) % (header)->num_slots) * (header)->slot_size))
+
+/* Emulator side. */
+
+int SHMSTREAM_Initialise(int *argc, char *argv[]);
+void SHMSTREAM_Exit(void);
+
+/* Creates (or reuses) FILENAME with room for NUM_SLOTS frames and starts
+   publishing to it. Returns FALSE on error. */
+int SHMSTREAM_Open(const char *filename, int num_slots);
+void SHMSTREAM_Close(void);
+
+/* Adds NUM_SAMPLES of generated audio to the current frame. */
+void SHMSTREAM_WriteAudio(const unsigned char *samples, int num_samples);
+/* Called at the end of each frame; publishes the screen and the audio. */
+void SHMSTREAM_Frame(int drawn);
+
+#endif /* SHMSTREAM_H_ */
@@ -576,6 +576,56 @@ void SIO_DisableDrive(int diskno)
 	strcpy(SIO_filename[diskno - 1], "Off");
 }
 
+int SIO_CopyImages(FILE *copies[SIO_MAX_DRIVES])
+{
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++)
+		copies[i] = NULL;
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		UBYTE buffer[4096];
+		size_t len;
+		if (disk[i] == NULL)
+			continue;
+		copies[i] = tmpfile();
+		if (copies[i] == NULL)
+			break;
+		Util_rewind(disk[i]);
+		while ((len = fread(buffer, 1, sizeof(buffer), disk[i])) > 0)
+			if (fwrite(buffer, 1, len, copies[i]) != len)
+				break;
+		if (ferror(disk[i]) || ferror(copies[i]) || fflush(copies[i]) != 0)
+			break;
+		Util_rewind(copies[i]);
+	}
+	if (i < SIO_MAX_DRIVES) {
+		SIO_CloseImageCopies(copies);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void SIO_UseImageCopies(FILE *copies[SIO_MAX_DRIVES])
+{
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		/* the original stays open: closing it could move the file
+		   position that this process shares with its parent */
+		if (disk[i] != NULL)
+			disk[i] = copies[i];
+	}
+}
+
+void SIO_CloseImageCopies(FILE *copies[SIO_MAX_DRIVES])
+{
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		if (copies[i] != NULL) {
+			fclose(copies[i]);
+			copies[i] = NULL;
+		}
+	}
+}
+
 void SIO_SizeOfSector(UBYTE unit, int sector, int *sz, ULONG *ofs)
 {
 	int size;
@@ -31,6 +31,14 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly);
 void SIO_Dismount(int diskno);
 void SIO_DisableDrive(int diskno);
 int SIO_RotateDisks(void);
+
+/* For a forked process that must not share the disk images with its parent:
+   SIO_CopyImages copies the mounted images to temporary files, or returns
+   FALSE if it can't. After the fork, the child calls SIO_UseImageCopies to
+   read and write the copies instead, and the parent SIO_CloseImageCopies. */
+int SIO_CopyImages(FILE *copies[SIO_MAX_DRIVES]);
+void SIO_UseImageCopies(FILE *copies[SIO_MAX_DRIVES]);
+void SIO_CloseImageCopies(FILE *copies[SIO_MAX_DRIVES]);
 void SIO_Handler(void);
 
 UBYTE SIO_ChkSum(const UBYTE *buffer, int length);
@@ -24,6 +24,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "sound.h"
 
@@ -37,6 +38,8 @@
 
 int Sound_enabled = 1;
 
+int Sound_silent = FALSE;
+
 Sound_setup_t Sound_desired = {
 	44100,
 	2,
@@ -140,6 +143,8 @@ int Sound_Initialise(int *argc, char *argv[])
 			Sound_enabled = 1;
 		else if (strcmp(argv[i], "-nosound") == 0)
 			Sound_enabled = 0;
+		else if (strcmp(argv[i], "-silent") == 0)
+			Sound_SetSilent(TRUE);
 		else if (strcmp(argv[i], "-dsprate") == 0) {
 			if (i_a)
 				a_i = (Sound_desired.freq = Util_sscandec(argv[++i])) == -1;
@@ -180,6 +185,7 @@ int Sound_Initialise(int *argc, char *argv[])
 				help_only = TRUE;
 				Log_print("\t-sound               Enable sound");
 				Log_print("\t-nosound             Disable sound");
+				Log_print("\t-silent              Output silence without emulating POKEY sound");
 				Log_print("\t-dsprate <rate>      Set sound output frequency in Hz");
 				Log_print("\t-volume <0 .. 100>   Set sound output volume");
 				Log_print("\t-audio16             Set sound output format to 16-bit");
@@ -307,6 +313,23 @@ void Sound_Continue(void)
 	}
 }
 
+void Sound_SetSilent(int silent)
+{
+	if (silent == Sound_silent)
+		return;
+	Sound_silent = silent;
+	if (silent)
+		POKEYSND_Detach();
+	else {
+		POKEYSND_Attach();
+#ifdef SYNCHRONIZED_SOUND
+		/* Drop the samples left over from before POKEYSND_Detach. */
+		if (Sound_enabled)
+			Sound_SetLatency(Sound_latency);
+#endif /* SYNCHRONIZED_SOUND */
+	}
+}
+
 /* Fills buffer BUFFER with SIZE bytes of audio samples. */
 static void FillBuffer(UBYTE *buffer, unsigned int size)
 {
@@ -315,7 +338,13 @@ static void FillBuffer(UBYTE *buffer, unsigned int size)
 	static UBYTE last_frame[MAX_FRAME_SIZE];
 	unsigned int bytes_per_frame = Sound_out.channels * Sound_out.sample_size;
 	unsigned int to_write = sync_write_pos - sync_read_pos;
+#endif /* SYNCHRONIZED_SOUND */
 
+	if (Sound_silent) {
+		memset(buffer, Sound_out.sample_size == 2 ? 0 : POKEYSND_SAMP_MID, size);
+		return;
+	}
+#ifdef SYNCHRONIZED_SOUND
 	if (to_write > 0) {
 		if (to_write > size)
 			to_write = size;
@@ -484,7 +513,8 @@ void Sound_Update(void)
 	if (!Sound_enabled || paused)
 		return;
 #ifdef SYNCHRONIZED_SOUND
-	UpdateSyncBuffer();
+	if (!Sound_silent)
+		UpdateSyncBuffer();
 #endif /* SYNCHRONIZED_SOUND */
 #ifndef SOUND_CALLBACK
 	WriteOut();
@@ -58,6 +58,15 @@ extern Sound_setup_t Sound_out;
    Sound_Setup to enable sound, and Sound_Exit to disable it. */
 extern int Sound_enabled;
 
+/* Indicates whether the output is kept silent with the POKEY sound engine
+   switched off, which saves its per-frame cost. Don't change it directly -
+   use Sound_SetSilent. */
+extern int Sound_silent;
+
+/* Switches silent mode on or off. When it is switched off the sound engine
+   is reset and resumes from the current POKEY registers. */
+void Sound_SetSilent(int silent);
+
 /* Enables hardware audio output with parameters based on those stored in
    Sound_desired. Stores the parameters of the actual opened output in
    Sound_out. The actual parameters may differ from the desired ones.
@@ -85,39 +85,57 @@ static size_t mem_write(const void *buf, size_t len, gzFile stream);
 #define GZREAD(X, Y, Z)  mem_read(Y, Z, X)
 #define GZWRITE(X, Y, Z) mem_write(Y, Z, X)
 #undef GZERROR
-#elif defined(HAVE_LIBZ) /* above MEMCOMPR, below HAVE_LIBZ */
-#define GZOPEN(X, Y)     gzopen(X, Y)
-#define GZCLOSE(X)       gzclose(X)
-#define GZREAD(X, Y, Z)  gzread(X, Y, Z)
-#define GZWRITE(X, Y, Z) gzwrite(X, (const voidp) Y, Z)
+#else /* defined(MEMCOMPR) || defined(LIBATARI800) */
+/* TRUE while StateSav_SaveAtariStateToMemory or StateSav_ReadAtariStateFromMemory
+   redirects the state file to a memory buffer */
+static int mem_state = FALSE;
+static size_t mem_read(void *buf, size_t len, void *stream);
+static size_t mem_write(const void *buf, size_t len, void *stream);
+#ifdef HAVE_LIBZ
+#define GZOPEN(X, Y)     (mem_state ? (gzFile) plainmembuf : gzopen(X, Y))
+#define GZCLOSE(X)       (mem_state ? 0 : gzclose(X))
+#define GZREAD(X, Y, Z)  (mem_state ? (int) mem_read(Y, Z, X) : gzread(X, Y, Z))
+#define GZWRITE(X, Y, Z) (mem_state ? (int) mem_write(Y, Z, X) : gzwrite(X, (const voidp) Y, Z))
 #define GZERROR(X, Y)    gzerror(X, Y)
 #else
-#define GZOPEN(X, Y)     fopen(X, Y)
-#define GZCLOSE(X)       fclose(X)
-#define GZREAD(X, Y, Z)  fread(Y, Z, 1, X)
-#define GZWRITE(X, Y, Z) fwrite(Y, Z, 1, X)
+#define GZOPEN(X, Y)     (mem_state ? (FILE *) plainmembuf : fopen(X, Y))
+#define GZCLOSE(X)       (mem_state ? 0 : fclose(X))
+#define GZREAD(X, Y, Z)  (mem_state ? mem_read(Y, Z, X) : fread(Y, Z, 1, X))
+#define GZWRITE(X, Y, Z) (mem_state ? mem_write(Y, Z, X) : fwrite(Y, Z, 1, X))
 #undef GZERROR
 #define gzFile  FILE *
 #define Z_OK    0
-#endif
+#endif /* HAVE_LIBZ */
+#endif /* defined(MEMCOMPR) || defined(LIBATARI800) */
+
+/* Buffer used by the in-memory state saves */
+static char * plainmembuf;
+static unsigned int plainmemoff;
+static unsigned int unclen;
 
 static gzFile StateFile = NULL;
 static int nFileError = Z_OK;
+/* TRUE while saving to a buffer whose caller retries with a bigger one */
+static int quiet_errors = FALSE;
 
 static void GetGZErrorText(void)
 {
+	if (quiet_errors)
+		return;
 #ifdef GZERROR
-	const char *error = GZERROR(StateFile, &nFileError);
-	if (nFileError == Z_ERRNO) {
+	if (!mem_state) {
+		const char *error = GZERROR(StateFile, &nFileError);
+		if (nFileError == Z_ERRNO) {
 #ifdef HAVE_STRERROR
-		Log_print("The following general file I/O error occurred:");
-		Log_print(strerror(errno));
+			Log_print("The following general file I/O error occurred:");
+			Log_print(strerror(errno));
 #else
-		Log_print("A file I/O error occurred");
+			Log_print("A file I/O error occurred");
 #endif
-		return;
+			return;
+		}
+		Log_print("ZLIB returned the following error: %s", error);
 	}
-	Log_print("ZLIB returned the following error: %s", error);
 #endif /* GZERROR */
 	Log_print("State file I/O failed.");
 }
@@ -543,13 +561,56 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 }
 
 
+int StateSav_SaveAtariStateToMemory(UBYTE *buffer, ULONG size, ULONG *len)
+{
+#if defined(MEMCOMPR)
+	*len = 0;
+	return FALSE;
+#elif defined(LIBATARI800)
+	statesav_tags_t tags;
+	int result;
+	quiet_errors = TRUE;
+	result = LIBATARI800_StateSaveSized(buffer, size, &tags, FALSE);
+	quiet_errors = FALSE;
+	*len = tags.size;
+	return result;
+#else
+	int result;
+	plainmembuf = (char *) buffer;
+	plainmemoff = 0;
+	unclen = size;
+	mem_state = TRUE;
+	quiet_errors = TRUE;
+	result = StateSav_SaveAtariState(NULL, NULL, FALSE);
+	quiet_errors = FALSE;
+	mem_state = FALSE;
+	*len = plainmemoff;
+	return result;
+#endif
+}
+
+int StateSav_ReadAtariStateFromMemory(UBYTE *buffer, ULONG len)
+{
+#if defined(MEMCOMPR)
+	return FALSE;
+#elif defined(LIBATARI800)
+	return LIBATARI800_StateLoadSized(buffer, len);
+#else
+	int result;
+	plainmembuf = (char *) buffer;
+	plainmemoff = 0;
+	unclen = len;
+	mem_state = TRUE;
+	result = StateSav_ReadAtariState(NULL, NULL);
+	mem_state = FALSE;
+	return result;
+#endif
+}
+
+
 /* Common definitions for in-memory state save used for DREAMCAST and libatari800
  */
 #if defined(MEMCOMPR) || defined(LIBATARI800)
-static char * plainmembuf;
-static unsigned int plainmemoff;
-static unsigned int unclen;
-
 /* hack to compress in memory before writing
  * - for DREAMCAST only
  * - 2 reasons for this:
@@ -653,7 +714,7 @@ static gzFile mem_open(const char *name, const char *mode)
 {
 	plainmembuf = (char *)LIBATARI800_StateSav_buffer;
 	plainmemoff = 0; /*HDR_LEN;*/
-	unclen = STATESAV_MAX_SIZE;
+	unclen = LIBATARI800_StateSav_size;
 	return (gzFile) plainmembuf;
 }
 
@@ -668,10 +729,15 @@ ULONG StateSav_Tell()
 	return (ULONG)plainmemoff;
 }
 #endif /* #ifdef LIBATARI800 */
+#endif /* defined(MEMCOMPR) || defined(LIBATARI800) */
 
 
 /* replacement for GZREAD */
+#if defined(MEMCOMPR) || defined(LIBATARI800)
 static size_t mem_read(void *buf, size_t len, gzFile stream)
+#else
+static size_t mem_read(void *buf, size_t len, void *stream)
+#endif
 {
 	if (plainmemoff + len > unclen) return 0;  /* shouldn't happen */
 	memcpy(buf, plainmembuf + plainmemoff, len);
@@ -680,16 +746,24 @@ static size_t mem_read(void *buf, size_t len, gzFile stream)
 }
 
 /* replacement for GZWRITE */
+#if defined(MEMCOMPR) || defined(LIBATARI800)
 static size_t mem_write(const void *buf, size_t len, gzFile stream)
+#else
+static size_t mem_write(const void *buf, size_t len, void *stream)
+#endif
 {
-	if (plainmemoff + len > unclen) return 0;  /* shouldn't happen */
+	if (plainmemoff + len > unclen) {
+#ifndef MEMCOMPR
+		/* stop saving instead of leaving a hole in the buffer */
+		nFileError = -1;
+#endif
+		return 0;  /* shouldn't happen */
+	}
 	memcpy(plainmembuf + plainmemoff, buf, len);
 	plainmemoff += len;
 	return len;
 }
 
-#endif /* defined(MEMCOMPR) || defined(LIBATARI800) */
-
 /*
 vim:ts=4:sw=4:
 */
@@ -7,6 +7,13 @@
 int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose);
 int StateSav_ReadAtariState(const char *filename, const char *mode);
 
+/* Save the state into a buffer of the given size and store the number of
+   bytes used in *len. Returns FALSE if the buffer is too small, or with
+   *len set to 0 if this port cannot save the state to memory. */
+int StateSav_SaveAtariStateToMemory(UBYTE *buffer, ULONG size, ULONG *len);
+/* Read a state saved by StateSav_SaveAtariStateToMemory. */
+int StateSav_ReadAtariStateFromMemory(UBYTE *buffer, ULONG len);
+
 void StateSav_SaveUBYTE(const UBYTE *data, int num);
 void StateSav_SaveUWORD(const UWORD *data, int num);
 void StateSav_SaveINT(const int *data, int num);